@@ -38,7 +38,12 @@
 #include "Strip.h"
 #include "StripDialog.h"
 #include "StripDataSource.h"
+#include "StripExport.h"
+#include "StripCompress.h"
+#include "StripRecord.h"
+#include "StripResample.h"
 #include "StripHistory.h"
+#include "StripWaveform.h"
 #include "StripGraph.h"
 #include "StripDAQ.h"
 #include "StripMisc.h"
@@ -218,6 +223,7 @@ typedef enum
 {
   DFSDLG_TGL_ASCII = 0,
   DFSDLG_TGL_CSV,
+  DFSDLG_TGL_COLUMNS,
 #ifdef USE_SDDS
   DFSDLG_TGL_SDDS,
 #endif
@@ -229,11 +235,31 @@ char    *DfsDlgTglStr[DFSDLG_TGL_COUNT] =
 {
   "ASCII",
   "Comma Separated Values",
+  "Binary columns",
 #ifdef USE_SDDS
   "SDDS binary"
 #endif
 };
 
+/* rows of the text dumps: as sampled, or on a time grid
+ * (in the order of StripResampleMethod) */
+#define DFSDLG_GRID_COUNT       3
+
+char    *DfsDlgGridStr[DFSDLG_GRID_COUNT] =
+{
+  "Samples",
+  "Grid, sample and hold",
+  "Grid, linear"
+};
+
+/* compression of the dump file (in the order of StripCompressType) */
+char    *DfsDlgCompressStr[STRIP_COMPRESS_COUNT] =
+{
+  "None",
+  "gzip (.gz)",
+  "zstd (.zst)"
+};
+
 typedef struct _StripInfo
 {
   /* == X Stuff == */
@@ -246,6 +272,9 @@ typedef struct _StripInfo
   Widget                popup_menu, message_box;
   Widget                fs_dlg;
   Widget                fs_tgl[DFSDLG_TGL_COUNT];
+  Widget                fs_grid_tgl[DFSDLG_GRID_COUNT];
+  Widget                fs_grid_step;
+  Widget                fs_compress_tgl[STRIP_COMPRESS_COUNT];
   char                  app_name[128];
 
   /* == file descriptor management ==  */
@@ -257,7 +286,9 @@ typedef struct _StripInfo
   StripCurveInfo        curves[STRIP_MAX_CURVES];
   StripDataSource       data;
   StripHistory          history;
+  StripRecord           record;
   StripGraph            graph;
+  StripWaveform         waveform;
   StripDAQ              daq;
   unsigned              status;
   PrintInfo             print_info;
@@ -305,6 +336,8 @@ static void     Strip_watchevent        (StripInfo *, unsigned);
 static void     Strip_ignoreevent       (StripInfo *, unsigned);
 
 static void     Strip_dispatch          (StripInfo *);
+static void     Strip_historyrefresh    (void *);
+static void     Strip_historyrescale    (void *);
 
 #if 0
 /* KE: unused */
@@ -353,6 +386,14 @@ static void     PrinterDialog_cb        (Widget, XtPointer, XtPointer);
 
 static void     fsdlg_popup             (StripInfo *, fsdlg_functype);
 static void     fsdlg_cb                (Widget, XtPointer, XtPointer);
+static void     fsdlg_compress_cb       (Widget, XtPointer, XtPointer);
+
+static int      export_ascii            (StripDataSource, FILE *, char *);
+static int      export_csv              (StripDataSource, FILE *, char *);
+static int      export_columns          (StripDataSource, FILE *, char *);
+#ifdef USE_SDDS
+static int      export_sdds             (StripDataSource, FILE *, char *);
+#endif
 
 int auto_scaleTriger=-1;
 static Pixmap auto_scalePixmap[2];
@@ -478,6 +519,8 @@ Strip   Strip_init      (int    *argc,
   if ((si = (StripInfo *)malloc (sizeof (StripInfo))) != NULL)
   {
     si->history = StripHistory_init ((Strip)si); /* Albert */
+    si->record = 0;
+    si->waveform = 0;
     /* initialize the X-toolkit */
     XtSetLanguageProc (0, 0, 0);
     XtToolkitInitialize();
@@ -1119,7 +1162,14 @@ Strip   Strip_init      (int    *argc,
     /* si->history = StripHistory_init ((Strip)si); */
     si->data = StripDataSource_init (si->history);
     StripDataSource_setattr
-      (si->data, SDS_NUMSAMPLES, (size_t)si->config->Time.num_samples, 0);
+      (si->data,
+       SDS_NUMSAMPLES,          (size_t)si->config->Time.num_samples,
+       SDS_REFRESH_FUNC,        Strip_historyrefresh,
+       SDS_RESCALE_FUNC,        Strip_historyrescale,
+       SDS_REFRESH_DATA,        si,
+       0);
+    if ((si->record = StripRecord_init ()))
+      StripDataSource_setattr (si->data, SDS_RECORD, si->record, 0);
 
     StripGraph_setattr (si->graph, STRIPGRAPH_DATA_SOURCE, si->data, 0);
 
@@ -1143,6 +1193,7 @@ Strip   Strip_init      (int    *argc,
       si->curves[i].details                     = NULL;
       si->curves[i].func_data                   = NULL;
       si->curves[i].get_value                   = NULL;
+      si->curves[i].get_waveform                = NULL;
       si->curves[i].connect_request.tv_sec      = 0;
       si->curves[i].id                          = NULL;
       si->curves[i].status                      = 0;
@@ -1233,6 +1284,8 @@ void    Strip_delete    (Strip the_strip)
 
   if (si->graph) StripGraph_delete (si->graph);
   if (si->data) StripDataSource_delete (si->data);
+  if (si->record) StripRecord_delete (si->record);
+  if (si->waveform) StripWaveform_delete (si->waveform);
   if (si->history) StripHistory_delete (si->history);
   if (si->dialog) StripDialog_delete (si->dialog);
   if (si->config) StripConfig_delete (si->config);
@@ -1658,6 +1711,46 @@ void    Strip_setwaiting        (Strip the_strip, StripCurve the_curve)
 }
 
 
+/*
+ * Strip_ingesting
+ */
+int     Strip_ingesting (Strip the_strip)
+{
+  StripInfo             *si = (StripInfo *)the_strip;
+
+  return (si->record != 0);
+}
+
+
+/*
+ * Strip_ingest
+ */
+void    Strip_ingest    (Strip                  the_strip,
+                         StripCurve             the_curve,
+                         struct timeval         *times,
+                         struct timeval         *stamps,
+                         double                 *values,
+                         short                  *status,
+                         int                    n)
+{
+  StripInfo             *si = (StripInfo *)the_strip;
+
+  StripDataSource_ingest
+    (si->data, the_curve, times, stamps, values, status, n);
+}
+
+
+/*
+ * Strip_ingested
+ */
+void    Strip_ingested  (Strip the_strip, struct timeval *t)
+{
+  StripInfo             *si = (StripInfo *)the_strip;
+
+  StripDataSource_ingested (si->data, t);
+}
+
+
 /*
  * Strip_clear
  */
@@ -1781,52 +1874,128 @@ static int changeMinMax( Strip the_strip)
 
 /*
  * Strip_dump
+ *
+ *      The data for the graph's range is written from a snapshot, by an
+ *      export thread, so sampling goes on meanwhile.
  */
 int     Strip_dumpdata  (Strip the_strip, char *fname)
 {
   StripInfo             *si = (StripInfo *)the_strip;
-  FILE                  *f;
-  int                   ret_val = 0;
-  int                   i = 0;
-
-  if ((ret_val = ((f = fopen (fname, "w")) != NULL)))
+  StripDataSource       snap;
+  StripExportFunc       func = export_ascii;
+  struct timeval        begin, end;
+  double                step = 0;
+  char                  *str;
+  char                  path[STRIP_PATH_MAX+1];
+  int                   i = 0, k, grid = STRIP_RESAMPLE_OFF;
+  StripCompressType     compress = STRIP_COMPRESS_NONE;
+
+  if (DFSDLG_TGL_COUNT > 1)
+    for (i = 0; i < DFSDLG_TGL_COUNT; i++)
+      if (XmToggleButtonGetState(si->fs_tgl[i])) break;
+
+  if (DFSDLG_TGL_COUNT > 1)
   {
-    if (DFSDLG_TGL_COUNT > 1)
+    switch (i)
     {
-      for (i = 0; i < DFSDLG_TGL_COUNT; i++)
-        if (XmToggleButtonGetState(si->fs_tgl[i])) break;
-	switch (i)
-	{
-	case DFSDLG_TGL_ASCII:
-	  ret_val = StripGraph_dumpdata (si->graph, f);
-	  break;
-	case DFSDLG_TGL_CSV:
-	  ret_val = StripGraph_dumpdata_csv (si->graph, f);
-	  break;
+    case DFSDLG_TGL_CSV:
+      func = export_csv;
+      break;
+    case DFSDLG_TGL_COLUMNS:
+      func = export_columns;
+      break;
 #ifdef USE_SDDS
-	case DFSDLG_TGL_SDDS:
-	  ret_val = StripGraph_dumpdata_sdds (si->graph, fname);
-	  break;
+    case DFSDLG_TGL_SDDS:
+      func = export_sdds;
+      break;
 #endif
-	}
     }
-    else
-      ret_val = StripGraph_dumpdata (si->graph, f);
-    if (!ret_val)
-      MessageBox_popup
-        (si->shell, &si->message_box, XmDIALOG_ERROR, "File I/O", "OK",
-	    "Unable to dump data");
-    fclose (f);
   }
-  else
+
+  /* compression, as chosen or as the name's extension calls for, with
+   * the extension added if it is missing (SDDS writes the file itself) */
+#ifdef USE_SDDS
+  if (i != DFSDLG_TGL_SDDS)
+#endif
+  {
+    if (si->fs_dlg)
+      for (k = 0; k < STRIP_COMPRESS_COUNT; k++)
+        if (XmToggleButtonGetState (si->fs_compress_tgl[k])) compress = k;
+    if (compress == STRIP_COMPRESS_NONE) compress = StripCompress_type (fname);
+    else if (StripCompress_type (fname) != compress)
+    {
+      str = StripCompress_suffix (compress);
+      if (strlen (fname) + strlen (str) > STRIP_PATH_MAX)
+      {
+        MessageBox_popup
+          (si->shell, &si->message_box, XmDIALOG_ERROR, "File I/O", "OK",
+           "File name is too long.\nname: %s", fname);
+        return 0;
+      }
+      sprintf (path, "%s%s", fname, str);
+      fname = path;
+    }
+  }
+
+  StripGraph_getattr (si->graph, STRIPGRAPH_BEGIN_TIME, &begin, 0);
+  StripGraph_getattr (si->graph, STRIPGRAPH_END_TIME, &end, 0);
+  if (!(snap = StripDataSource_snapshot (si->data, &begin, &end)))
+  {
     MessageBox_popup
       (si->shell, &si->message_box, XmDIALOG_ERROR, "File I/O", "OK",
-	  "Unable to open file for writing.\nname: %s\nerror: %s",
-	  fname, strerror (errno));
-  return ret_val;
+	  "Unable to dump data");
+    return 0;
+  }
+
+  /* the time grid, defaulting to the sample interval */
+  if (si->fs_dlg)
+  {
+    for (k = 0; k < DFSDLG_GRID_COUNT; k++)
+      if (XmToggleButtonGetState (si->fs_grid_tgl[k])) grid = k;
+    str = XmTextFieldGetString (si->fs_grid_step);
+    step = atof (str);
+    XtFree (str);
+  }
+  if (step <= 0) step = si->config->Time.sample_interval;
+  StripDataSource_setattr
+    (snap, SDS_DUMP_GRID, grid, SDS_DUMP_GRID_STEP, step, 0);
+
+  return StripExport_start
+    (the_strip, si->shell, snap, fname,
+     (i == DFSDLG_TGL_COLUMNS)? "wb" : "w", compress, func);
+}
+
+
+/* export_ascii, export_csv, export_columns, export_sdds
+ *
+ *      The export thread's functions for the dump formats.
+ */
+static int      export_ascii    (StripDataSource sds, FILE *f, char *BOGUS(n))
+{
+  return StripDataSource_dump (sds, f, 0);
 }
 
 
+static int      export_csv      (StripDataSource sds, FILE *f, char *BOGUS(n))
+{
+  return StripDataSource_dump_csv (sds, f, 0);
+}
+
+
+static int      export_columns  (StripDataSource sds, FILE *f, char *BOGUS(n))
+{
+  return StripDataSource_dump_columns (sds, f, 0);
+}
+
+
+#ifdef USE_SDDS
+static int      export_sdds     (StripDataSource sds, FILE *BOGUS(f), char *n)
+{
+  return StripDataSource_dump_sdds (sds, n);
+}
+#endif
+
+
 /*
  * Strip_writeconfig
  */
@@ -1890,6 +2059,7 @@ static void     Strip_forgetcurve       (StripInfo      *si,
   StripConfig_reset_details (si->config, sci->details);
   sci->details = 0;
   sci->get_value = 0;
+  sci->get_waveform = 0;
   sci->func_data = 0;
 }
 
@@ -2342,6 +2512,8 @@ static void     Strip_eventmgr          (XtPointer arg, XtIntervalId *BOGUS(id))
 	case STRIPEVENT_SAMPLE:
 	  /* StripDataSource_sample (si->data); Albert*/
 	  StripDataSource_sample (si->data,(char *)si->graph); /* Albert */
+	  if (si->waveform)
+	    StripWaveform_update (si->waveform, si->curves, STRIP_MAX_CURVES);
 	  break;
 	  
 	case STRIPEVENT_REFRESH:
@@ -2421,6 +2593,43 @@ static void     Strip_eventmgr          (XtPointer arg, XtIntervalId *BOGUS(id))
 }
 
 
+/*
+ * Strip_historyrefresh
+ *
+ *      More history data has arrived: plot it.
+ */
+static void     Strip_historyrefresh    (void *arg)
+{
+  StripInfo     *si = (StripInfo *)arg;
+
+  StripGraph_draw (si->graph, SGCOMPMASK_DATA, (Region *)0);
+}
+
+
+/*
+ * Strip_historyrescale
+ *
+ *      The history which the autoscale asked for has arrived: work out
+ *      the limits again, and plot it.
+ */
+static void     Strip_historyrescale    (void *arg)
+{
+  StripInfo     *si = (StripInfo *)arg;
+
+  if ((auto_scaleTriger == 1) &&
+      StripAuto_min_max (si->data, (char *)si->graph))
+  {
+    StripGraph_setstat (si->graph, SGSTAT_GRAPH_REFRESH);
+    StripGraph_setstat (si->graph, SGSTAT_LEGEND_REFRESH);
+    StripGraph_draw
+      (si->graph,
+       SGCOMPMASK_DATA | SGCOMPMASK_LEGEND | SGCOMPMASK_YAXIS,
+       (Region *)0);
+  }
+  else StripGraph_draw (si->graph, SGCOMPMASK_DATA, (Region *)0);
+}
+
+
 /*
  * Strip_watchevent
  */
@@ -3317,6 +3526,7 @@ typedef enum
   POPUPMENU_PRINT,
   POPUPMENU_SNAPSHOT,
   POPUPMENU_DUMP,
+  POPUPMENU_WAVEFORMS,
   POPUPMENU_RETRY,
   POPUPMENU_DISMISS,
   POPUPMENU_QUIT,
@@ -3335,6 +3545,7 @@ char    *PopupMenuItemStr[POPUPMENU_ITEMCOUNT] =
   "Print",
   "Snapshot",
   "Dump Data...",
+  "Waveforms...",
   "Retry Connections",
   "Dismiss",
   "Quit",
@@ -3351,6 +3562,7 @@ char    PopupMenuItemMnemonic[POPUPMENU_ITEMCOUNT] =
   'P',
   'S',
   'D',
+  'W',
   'R',
   'm',
   'Q'
@@ -3369,6 +3581,7 @@ char    *PopupMenuItemAccelerator[POPUPMENU_ITEMCOUNT] =
   " ",
   " ",
   " ",
+  " ",
   "Ctrl<Key>c"
 };
 
@@ -3385,6 +3598,7 @@ char    *PopupMenuItemAccelStr[POPUPMENU_ITEMCOUNT] =
   " ",
   " ",
   " ",
+  " ",
   "Ctrl+C"
 };
 
@@ -3616,6 +3830,12 @@ static void     PopupMenu_cb    (Widget w, XtPointer client, XtPointer BOGUS(1))
     fsdlg_popup ((Strip)si, (fsdlg_functype)Strip_dumpdata);
     break;
         
+  case POPUPMENU_WAVEFORMS:
+    if (!si->waveform)
+      si->waveform = StripWaveform_init (si->shell, si->config);
+    if (si->waveform) StripWaveform_popup (si->waveform);
+    break;
+        
   case POPUPMENU_RETRY:
     StripDAQ_retry_connections(si->daq, si->display);
     break;
@@ -3770,10 +3990,11 @@ static void     PrinterDialog_cb        (Widget         w,
 
 static void     fsdlg_popup     (StripInfo *si, fsdlg_functype func)
 {
-  Widget        w,frame;
+  Widget        w,frame,box;
   int           i;
   XmString      xstr;
   char          *ftype;
+  char          buf[64];
 
   if (!si->fs_dlg)
   {
@@ -3783,11 +4004,17 @@ static void     fsdlg_popup     (StripInfo *si, fsdlg_functype func)
     XtAddCallback (si->fs_dlg, XmNokCallback, fsdlg_cb, si);
     XtAddCallback (si->fs_dlg, XmNcancelCallback, fsdlg_cb, NULL);
 
+    box = XtVaCreateManagedWidget
+      ("box",
+	  xmRowColumnWidgetClass,            si->fs_dlg,
+	  XmNorientation,                    XmHORIZONTAL,
+	  NULL);
+
     if (DFSDLG_TGL_COUNT > 1)
     {
       frame = XtVaCreateManagedWidget
         ("frame",
-	    xmFrameWidgetClass,              si->fs_dlg,
+	    xmFrameWidgetClass,              box,
 	    NULL);
       XtVaCreateManagedWidget
         ("File Type",
@@ -3818,6 +4045,87 @@ static void     fsdlg_popup     (StripInfo *si, fsdlg_functype func)
 	    if (strcmp(DfsDlgTglStr[i],ftype) == 0)
 		XmToggleButtonSetState(si->fs_tgl[i],True,True);
     }
+
+    /* compression, which keeps the file name's extension in step */
+    frame = XtVaCreateManagedWidget
+      ("frame",
+	  xmFrameWidgetClass,                box,
+	  NULL);
+    XtVaCreateManagedWidget
+      ("Compression",
+	  xmLabelWidgetClass,                frame,
+	  XmNchildType,                      XmFRAME_TITLE_CHILD,
+	  NULL);
+    w = XtVaCreateManagedWidget
+      ("rowcol",
+	  xmRowColumnWidgetClass,            frame,
+	  XmNchildType,                      XmFRAME_WORKAREA_CHILD,
+	  XmNradioBehavior,                  True,
+	  NULL);
+    for (i = 0; i < STRIP_COMPRESS_COUNT; i++)
+    {
+      xstr = XmStringCreateLocalized (DfsDlgCompressStr[i]);
+      si->fs_compress_tgl[i] = XtVaCreateManagedWidget
+        ("togglebutton",
+	    xmToggleButtonWidgetClass,       w,
+	    XmNlabelString,                  xstr,
+	    XmNsensitive,                    StripCompress_available (i),
+	    NULL);
+      XmStringFree (xstr);
+      XtAddCallback
+        (si->fs_compress_tgl[i], XmNvalueChangedCallback,
+         fsdlg_compress_cb, si);
+    }
+    XmToggleButtonSetState
+      (si->fs_compress_tgl[STRIP_COMPRESS_NONE], True, False);
+
+    /* rows of the text dumps */
+    frame = XtVaCreateManagedWidget
+      ("frame",
+	  xmFrameWidgetClass,                box,
+	  NULL);
+    XtVaCreateManagedWidget
+      ("Rows",
+	  xmLabelWidgetClass,                frame,
+	  XmNchildType,                      XmFRAME_TITLE_CHILD,
+	  NULL);
+    box = XtVaCreateManagedWidget
+      ("rowcol",
+	  xmRowColumnWidgetClass,            frame,
+	  XmNchildType,                      XmFRAME_WORKAREA_CHILD,
+	  NULL);
+    w = XtVaCreateManagedWidget
+      ("rowcol",
+	  xmRowColumnWidgetClass,            box,
+	  XmNradioBehavior,                  True,
+	  NULL);
+    for (i = 0; i < DFSDLG_GRID_COUNT; i++)
+    {
+      xstr = XmStringCreateLocalized (DfsDlgGridStr[i]);
+      si->fs_grid_tgl[i] = XtVaCreateManagedWidget
+        ("togglebutton",
+	    xmToggleButtonWidgetClass,       w,
+	    XmNlabelString,                  xstr,
+	    NULL);
+      XmStringFree (xstr);
+    }
+    XmToggleButtonSetState (si->fs_grid_tgl[0], True, True);
+    w = XtVaCreateManagedWidget
+      ("rowcol",
+	  xmRowColumnWidgetClass,            box,
+	  XmNorientation,                    XmHORIZONTAL,
+	  NULL);
+    XtVaCreateManagedWidget
+      ("Grid step [s]",
+	  xmLabelWidgetClass,                w,
+	  NULL);
+    si->fs_grid_step = XtVaCreateManagedWidget
+      ("gridStep",
+	  xmTextFieldWidgetClass,            w,
+	  XmNcolumns,                        8,
+	  NULL);
+    sprintf (buf, "%g", si->config->Time.sample_interval);
+    XmTextFieldSetString (si->fs_grid_step, buf);
   }
   XtVaSetValues (si->fs_dlg, XmNuserData, func, NULL);
   XtManageChild (si->fs_dlg);
@@ -3850,6 +4158,36 @@ static void     fsdlg_cb        (Widget w, XtPointer data, XtPointer call)
 }
 
 
+/* fsdlg_compress_cb
+ *
+ *      Replaces the compression extension of the selected file name.
+ */
+static void     fsdlg_compress_cb       (Widget w, XtPointer data, XtPointer call)
+{
+  XmToggleButtonCallbackStruct *cbs = (XmToggleButtonCallbackStruct *)call;
+  StripInfo             *si = (StripInfo *)data;
+  Widget                text;
+  char                  *str, *name;
+  size_t                n;
+  int                   i;
+
+  if (!cbs->set) return;
+  for (i = 0; i < STRIP_COMPRESS_COUNT; i++)
+    if (si->fs_compress_tgl[i] == w) break;
+  if (i >= STRIP_COMPRESS_COUNT) return;
+
+  text = XmFileSelectionBoxGetChild (si->fs_dlg, XmDIALOG_TEXT);
+  str = XmTextGetString (text);
+  n = strlen (str) - strlen (StripCompress_suffix (StripCompress_type (str)));
+  name = XtMalloc (n + strlen (StripCompress_suffix (i)) + 1);
+  sprintf (name, "%.*s%s", (int)n, str, StripCompress_suffix (i));
+  XmTextSetString (text, name);
+  XmTextSetInsertionPosition (text, strlen (name));
+  XtFree (name);
+  XtFree (str);
+}
+
+
 /* Albert: */
 #define DEBUG 0
 
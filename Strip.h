@@ -195,6 +195,41 @@ void    Strip_setdescconnected      (Strip, StripCurve);
 void    Strip_setwaiting        (Strip, StripCurve);
 
 
+/*
+ * Strip_ingesting
+ *
+ *      True if anything takes every update of a curve (the continuous
+ *      recording), so that it is worth passing them on to Strip_ingest,
+ *      rather than just the latest value for sampling.
+ */
+int     Strip_ingesting (Strip);
+
+
+/*
+ * Strip_ingest
+ *
+ *      Passes on n updates of the curve which arrived between samples,
+ *      with the local times they were received, the times stamped by
+ *      their source, and DATASTAT_ status, to be recorded.
+ */
+void    Strip_ingest    (Strip,
+                         StripCurve,
+                         struct timeval *,      /* received */
+                         struct timeval *,      /* stamps */
+                         double *,              /* values */
+                         short *,               /* status */
+                         int);                  /* n */
+
+
+/*
+ * Strip_ingested
+ *
+ *      Tells that all updates received before the given time have been
+ *      passed on to Strip_ingest.
+ */
+void    Strip_ingested  (Strip, struct timeval *);
+
+
 /*
  * Strip_disconnectcurve
  *
@@ -13,14 +13,61 @@
 #define DEBUG_ASSERT 0
 #define PRINT_DESC_ERRORS
 
-/* Keep in mind the interface does not respond for this time and that
-   most of the search requests are at the beginning of the sequence */
+/* Seconds for which each extra search for an unconnected channel is
+   kept open.  Most of the search requests are at the beginning of the
+   sequence */
 #define RETRY_TIMEOUT 1.0
 
+/* seconds between polls of Channel Access, or of the update rings */
+#define POLL_TIMEOUT 0.1
+
 #include "StripDAQ.h"
+#include "StripDataSource.h"
+#include "StripDescCache.h"
 
 #include <cadef.h>
 #include <db_access.h>
+#include <alarm.h>
+#include <epicsTime.h>
+#include <epicsVersion.h>
+#include <ctype.h>
+
+/* The preemptive mode needs epicsAtomic, which came with 3.15.  Each
+ * curve's monitor pushes its updates onto a ring with a single producer
+ * (the CA thread of the channel's circuit) and a single consumer (the Xt
+ * thread), so neither side takes a lock.  All other callbacks are queued
+ * and called again from the Xt thread, which created the CA context and
+ * so may issue CA calls.
+ */
+#if (EPICS_VERSION > 3) || ((EPICS_VERSION == 3) && (EPICS_REVISION >= 15))
+#define STRIP_CA_PREEMPTIVE
+#include <epicsAtomic.h>
+#include <epicsMutex.h>
+#include <epicsThread.h>
+
+typedef struct _CAEvent
+{
+  struct _CAEvent               *next;
+  chid                          chan_id;
+  void                          (*conn_func) (struct connection_handler_args);
+  void                          (*event_func) (struct event_handler_args);
+  struct connection_handler_args conn;
+  struct event_handler_args     event;          /* dbr follows the struct */
+} CAEvent;
+
+#define CA_PREEMPTIVE(sca)      ((sca)->preemptive)
+#else
+#define CA_PREEMPTIVE(sca)      0
+#endif
+
+/* what an array curve plots against time: "PV[3]", "PV[mean]", "PV[max]" */
+typedef enum
+{
+  CA_ARRAY_NONE = 0,            /* a scalar PV */
+  CA_ARRAY_ELEMENT,
+  CA_ARRAY_MEAN,
+  CA_ARRAY_MAX
+} CAArrayMode;
 
 typedef struct _StripDAQInfo
 {
@@ -31,10 +78,57 @@ typedef struct _StripDAQInfo
     evid                        event_id;
 #ifndef PEND_DESC
     chid                        desc_chan_id;
+    double                      desc_until;     /* give up searching */
 #endif    
     double                      value;
     struct _StripDAQInfo        *this;
+    unsigned long               lost, lost_told;        /* updates */
+#ifdef STRIP_CA_PREEMPTIVE
+    /* updates from the CA thread, severity replaced by status once read,
+     * stamped by the IOC and received on the local clock */
+    struct timeval              *ring_t, *ring_r;
+    double                      *ring_v;
+    short                       *ring_s;
+    size_t                      head, tail;
+    /* with nobody to take every update, just the latest value, under a
+     * count which is odd while it is being written */
+    size_t                      latest_seq, latest_read;
+    double                      latest_v;
+#endif
+    /* array PVs: a ring of snapshots, stride elements apart, filled by
+     * the monitor; the latest one read stays put for display */
+    CAArrayMode                 array, array_req;
+    long                        element;
+    long                        stride;
+    double                      *snap_v;
+    long                        snap_n[STRIP_CA_SNAPSHOTS];
+    struct timeval              snap_t[STRIP_CA_SNAPSHOTS];
+    struct timeval              snap_r[STRIP_CA_SNAPSHOTS];
+    short                       snap_s[STRIP_CA_SNAPSHOTS];
+    size_t                      snap_head, snap_tail, snap_done;
+    /* reconnection: while the channel is down, a second channel for the
+     * same name is opened every backoff seconds to restart the search */
+    chid                        retry_chan_id;
+    double                      down_since, retry_at, retry_end, backoff;
+    int                         retries;
+    /* seconds from the connect request to the first value */
+    double                      requested, first_value;
+    int                         batch;
   } chan_data[STRIP_MAX_CURVES];
+  /* the searches of all the curves connected from one Xt callback, such
+   * as a config load, are flushed together once it returns */
+  int           flush_pending;
+  int           batch, batch_n, batch_left, batch_queued;
+  struct _ChannelData   *batch_slowest;
+  StripDescCache        desc_cache;
+#ifdef STRIP_CA_PREEMPTIVE
+  int           preemptive;
+  int           ingest;                 /* every update is wanted */
+  struct timeval polled;                /* updates before it are all in */
+  epicsThreadId xt_thread;
+  epicsMutexId  lock;                   /* of the event queue */
+  CAEvent       *events, *events_last;
+#endif
 } StripDAQInfo;
 
 
@@ -45,11 +139,46 @@ static void work_callback (XtPointer, int *, XtInputId *);
 static void connect_callback (struct connection_handler_args);
 static void info_callback (struct event_handler_args);
 static void data_callback (struct event_handler_args);
+static void retry_callback (struct connection_handler_args);
+static void retry_run (StripDAQInfo *);
+static void retry_reset (struct _ChannelData *, double);
+static void retry_stop (struct _ChannelData *);
+static double now_sec (void);
+static void flush_soon (StripDAQInfo *);
+static void flush_callback (XtPointer, XtIntervalId *);
+static void first_value (struct _ChannelData *);
 static double get_value (void *);
+static int get_waveform (void *, double **);
+static void array_spec (char *, char *, struct _ChannelData *);
+static int wave_alloc (struct _ChannelData *, long);
+static void wave_push (struct _ChannelData *, struct event_handler_args *);
+static void wave_drain (struct _ChannelData *);
+static double wave_reduce (struct _ChannelData *, double *, long);
+static void stamp_time (struct dbr_time_double *, struct timeval *);
+static size_t ring_get (size_t *);
+static void ring_add (size_t *, size_t);
+#ifdef STRIP_CA_PREEMPTIVE
+static int preemptive_init (StripDAQInfo *);
+static void ring_push (struct _ChannelData *, struct dbr_time_double *);
+static void ring_drain (struct _ChannelData *);
+static void latest_push (struct _ChannelData *, double);
+static int latest_get (struct _ChannelData *, double *);
+static int defer_connect (StripDAQInfo *,
+                          void (*) (struct connection_handler_args),
+                          struct connection_handler_args *);
+static int defer_event (StripDAQInfo *,
+                        void (*) (struct event_handler_args),
+                        struct event_handler_args *);
+static void defer_queue (StripDAQInfo *, CAEvent *);
+static void defer_run (StripDAQInfo *);
+static void defer_purge (StripDAQInfo *, chid);
+#endif
 #ifdef PEND_DESCRIPTION
-static void getDescriptionRecord (char *name,char *description);
+static void getDescriptionRecord (StripDAQInfo *, char *name,
+                                  char *description);
 #else
 static void requestDescRecord (StripCurve curve);
+static void desc_clear (struct _ChannelData *);
 static void desc_connect_callback (struct connection_handler_args);
 static void desc_info_callback (struct event_handler_args args);
 #endif
@@ -67,6 +196,11 @@ StripDAQ StripDAQ_initialize (Strip strip)
   if ((sca = (StripDAQInfo *)calloc (sizeof (StripDAQInfo), 1)) != NULL)
   {
     sca->strip = strip;
+#ifdef STRIP_CA_PREEMPTIVE
+    if (preemptive_init (sca))
+      status = ca_context_create (ca_enable_preemptive_callback);
+    else
+#endif
     status = ca_task_initialize ();
     if (status != ECA_NORMAL)
     {
@@ -75,13 +209,17 @@ StripDAQ StripDAQ_initialize (Strip strip)
       sca = NULL;
     }
     else {
-      Strip_addtimeout (strip, 0.1, timeout_callback, strip);
+      Strip_addtimeout (strip, POLL_TIMEOUT, timeout_callback, sca);
+#ifdef STRIP_CA_PREEMPTIVE
+      if (!sca->preemptive)
+#endif
       ca_add_fd_registration (addfd_callback, sca);
       for (i = 0; i < STRIP_MAX_CURVES; i++)
       {
         sca->chan_data[i].this = sca;
         sca->chan_data[i].chan_id = NULL;
       }
+      sca->desc_cache = StripDescCache_init ();
     }
   }
 
@@ -94,7 +232,10 @@ StripDAQ StripDAQ_initialize (Strip strip)
  */
 void StripDAQ_terminate (StripDAQ the_sca)
 {
+  StripDAQInfo  *sca = (StripDAQInfo *)the_sca;
+
   ca_task_exit ();
+  if (sca) StripDescCache_delete (sca->desc_cache);
 }
 
 
@@ -109,6 +250,7 @@ int StripDAQ_request_connect (StripCurve curve, void *the_sca)
   StripDAQInfo  *sca = (StripDAQInfo *)the_sca;
   int           i;
   int           ret_val;
+  char          pv[STRIP_MAX_NAME_CHAR+1];
 #ifdef PEND_DESCRIPTION
   char *description=NULL; /* Albert */
 #endif
@@ -120,14 +262,22 @@ int StripDAQ_request_connect (StripCurve curve, void *the_sca)
   if ((ret_val = (i < STRIP_MAX_CURVES)))
   {
     StripCurve_setattr (curve, STRIPCURVE_FUNCDATA, &sca->chan_data[i], 0);
-#ifndef PEND_DESCRIPTION
-    /* first search for the description field so it is likely to
-       connect first */
-    requestDescRecord(curve);
+#ifdef STRIP_CA_PREEMPTIVE
+    sca->chan_data[i].head = sca->chan_data[i].tail = 0;
+    sca->chan_data[i].latest_seq = sca->chan_data[i].latest_read = 0;
+#endif
+    sca->chan_data[i].lost = sca->chan_data[i].lost_told = 0;
+    sca->chan_data[i].array = CA_ARRAY_NONE;
+    array_spec
+      ((char *)StripCurve_getattr_val (curve, STRIPCURVE_NAME), pv,
+       &sca->chan_data[i]);
+#ifndef PEND_DESC
+    /* the description is searched for once the curve has a value */
+    sca->chan_data[i].desc_chan_id = NULL;
 #endif
     /* search for the process variable */
     ret_val = ca_search_and_connect
-      ((char *)StripCurve_getattr_val (curve, STRIPCURVE_NAME),
+      (pv,
 	  &sca->chan_data[i].chan_id,
 	  connect_callback,
 	  curve);
@@ -139,21 +289,35 @@ int StripDAQ_request_connect (StripCurve curve, void *the_sca)
 	    (char *)StripCurve_getattr_val (curve, STRIPCURVE_NAME));
       ret_val = 0;
     }
-    else ret_val = 1;
+    else
+    {
+      /* a channel which has never connected isn't down: the library
+       * searches for it by itself, so extra searches only start after
+       * the longest backoff, for names which nobody serves yet */
+      retry_reset (&sca->chan_data[i], now_sec ());
+      sca->chan_data[i].backoff = STRIP_CA_RETRY_MAX;
+      sca->chan_data[i].retry_at =
+        sca->chan_data[i].down_since + STRIP_CA_RETRY_MAX;
+      sca->chan_data[i].requested = sca->chan_data[i].down_since;
+      sca->chan_data[i].first_value = -1;
+      sca->chan_data[i].batch = sca->batch + 1;
+      sca->batch_queued++;
+      ret_val = 1;
+    }
   }
 
 #ifdef PEND_DESCRIPTION
   /* KE: Should be inside the if above */
   /* get the description field using ca_pend_io */
   description=malloc(STRIP_MAX_NAME_CHAR); /* Albert */
-  getDescriptionRecord(
+  getDescriptionRecord(sca,
     (char *)StripCurve_getattr_val (curve, STRIPCURVE_NAME),
     description);
   StripCurve_setattr (curve, STRIPCURVE_COMMENT, description, 0);
   free(description);
 #endif
 
-  ca_flush_io();
+  flush_soon (sca);
   
   return ret_val;
 }
@@ -169,6 +333,9 @@ int StripDAQ_request_disconnect (StripCurve curve, void *the_sca)
 {
   struct _ChannelData   *cd;
   int                   ret_val = 1;
+#ifdef STRIP_CA_PREEMPTIVE
+  chid                  chan_id, desc_chan_id = NULL;
+#endif
 
   cd = (struct _ChannelData *) StripCurve_getattr_val
     (curve, STRIPCURVE_FUNCDATA);
@@ -176,11 +343,31 @@ int StripDAQ_request_disconnect (StripCurve curve, void *the_sca)
   /* this will happen if a non-CA curve is submitted for disconnect */
   if (!cd) return 1;
 
+#ifdef STRIP_CA_PREEMPTIVE
+  chan_id = cd->chan_id;
+#ifndef PEND_DESC
+  desc_chan_id = cd->desc_chan_id;
+#endif
+#endif
+
 #if DEBUG_DISCONNECT
   fprintf(stderr,"StripDAQ_request_disconnect: %s\n",
     ca_name(cd->chan_id));
 #endif
 
+  retry_stop (cd);
+  cd->down_since = cd->retry_at = 0;
+  if ((cd->first_value < 0) && (cd->batch == cd->this->batch))
+  {
+    cd->this->batch_n--;
+    cd->this->batch_left--;
+  }
+  /* or it is still waiting for the flush which starts its batch */
+  else if ((cd->first_value < 0) && (cd->batch == cd->this->batch + 1))
+    cd->this->batch_queued--;
+  cd->first_value = 0;
+  if (cd->this->batch_slowest == cd) cd->this->batch_slowest = NULL;
+
   if (cd->event_id != NULL)
   {
     if ((ret_val = ca_clear_event (cd->event_id)) != ECA_NORMAL)
@@ -243,6 +430,19 @@ int StripDAQ_request_disconnect (StripCurve curve, void *the_sca)
 #endif
   
   ca_flush_io();
+
+#ifdef STRIP_CA_PREEMPTIVE
+  /* no more callbacks can come for the cleared channels */
+  if (cd->this->preemptive)
+  {
+    if (chan_id && !cd->chan_id) defer_purge (cd->this, chan_id);
+#ifndef PEND_DESC
+    if (desc_chan_id && !cd->desc_chan_id)
+      defer_purge (cd->this, desc_chan_id);
+#endif
+    cd->head = cd->tail = 0;
+  }
+#endif
 #if DEBUG_DISCONNECT
   fprintf(stderr,"StripDAQ_request_disconnect: end\n");
 #endif
@@ -252,28 +452,25 @@ int StripDAQ_request_disconnect (StripCurve curve, void *the_sca)
 /*
  * StripDAQ_retry_connections
  *
- *      Tries to reconnect to currently unconnected PVs.
+ *      Searches again, now, for every unconnected PV, and starts their
+ *      backoff over.  The searches go on in the background.
  */
 int StripDAQ_retry_connections (StripDAQ the_sca, Display *display)
 {
   StripDAQInfo *sca = (StripDAQInfo *)the_sca;
-  int ret_val = 0;
+  struct _ChannelData *cd;
+  double now = now_sec ();
   int found = 0;
   int i;
-  const char *pvname = NULL;
-  chid retryChid;
-  int status;
   
-  /* Check if all channels are connected */
   for (i = 0; i < STRIP_MAX_CURVES; i++)
   {
-    if (sca->chan_data[i].chan_id &&
-	ca_state(sca->chan_data[i].chan_id) != cs_conn)
+    cd = &sca->chan_data[i];
+    if (cd->chan_id && (ca_state (cd->chan_id) != cs_conn) && cd->retry_at)
     {
-	pvname=ca_name(sca->chan_data[i].chan_id);
-	if(!pvname) continue;
-	found=1;
-	break;
+      cd->backoff = STRIP_CA_RETRY_MIN;
+      cd->retry_at = now;
+      found = 1;
     }
   }
   if(!found)
@@ -281,43 +478,9 @@ int StripDAQ_retry_connections (StripDAQ the_sca, Display *display)
     XBell (display,50);
     return -1;
   }
-  
-  /* Search */
-    status=ca_search_and_connect(pvname,&retryChid,NULL,NULL);
-    if(status != ECA_NORMAL)
-    {
-	fprintf(stderr,"StripDAQ_retry_connections: ca_search failed "
-	  "for %s: %s\n",
-	  pvname, ca_message(status));
-	ret_val=-1;
-    }
-    
-  /* Wait.  The searches will only continue for this time.  Keep the
-   * time short as the interface is frozen, and most of the searches
-   * occur at the start of the sequence.  Testing indicated:
-   *
-   * RETRY_TIMEOUT Searches
-   *      30          15
-   *       5          10
-   *       3           9
-   *       2           9
-   *       1           8
-   *
-   * but this may vary owing to tuning and may change with new releases.
-   */
-    ca_pend_io(RETRY_TIMEOUT);
-    
-  /* Clear the channel */
-    status = ca_clear_channel(retryChid);
-    if(status != ECA_NORMAL)
-    {
-	fprintf(stderr,"StripDAQ_retry_connections: ca_clear_channel failed "
-	  "for %s: %s\n",
-	  pvname, ca_message(status));
-	ret_val=-1;
-    }
 
-    return ret_val;
+  retry_run (sca);
+  return 0;
 }
 
 /*
@@ -358,10 +521,38 @@ static void work_callback (XtPointer      BOGUS(1),
 
 /*
  * timeout_callback
+ *
+ *      Polls Channel Access or, in the preemptive mode, takes the
+ *      updates and events which it has delivered meanwhile.
  */
 static void timeout_callback (XtPointer ptr, XtIntervalId *pId)
 {
-  Strip strip = (Strip) ptr;
+  StripDAQInfo *sca = (StripDAQInfo *) ptr;
+  int i;
+#ifdef STRIP_CA_PREEMPTIVE
+  struct timeval now;
+
+  if (sca->preemptive)
+  {
+    /* updates first, as they came before any later state change */
+    get_current_time (&now);
+    for (i = 0; i < STRIP_MAX_CURVES; i++)
+      if (!sca->chan_data[i].chan_id) continue;
+      else if (sca->chan_data[i].array) wave_drain (&sca->chan_data[i]);
+      else ring_drain (&sca->chan_data[i]);
+
+    /* one received just as its channel was drained is queued by now */
+    if (sca->ingest)
+    {
+      if (sca->polled.tv_sec) Strip_ingested (sca->strip, &sca->polled);
+      sca->polled = now;
+    }
+    defer_run (sca);
+    retry_run (sca);
+    Strip_addtimeout (sca->strip, POLL_TIMEOUT, timeout_callback, sca);
+    return;
+  }
+#endif
 #if 0
   /* KE: ca_pend_event will block the program unnecessarily for
      STRIP_CA_PEND_TIMEOUT, whether there is anything to do or
@@ -371,7 +562,11 @@ static void timeout_callback (XtPointer ptr, XtIntervalId *pId)
 #else
   ca_poll();
 #endif  
-  Strip_addtimeout ( strip, 0.1, timeout_callback, strip );
+  for (i = 0; i < STRIP_MAX_CURVES; i++)
+    if (sca->chan_data[i].chan_id && sca->chan_data[i].array)
+      wave_drain (&sca->chan_data[i]);
+  retry_run (sca);
+  Strip_addtimeout (sca->strip, POLL_TIMEOUT, timeout_callback, sca);
 }
 
 /*
@@ -382,10 +577,15 @@ static void connect_callback (struct connection_handler_args args)
   StripCurve            curve;
   struct _ChannelData   *cd;
   int                   status;
+  double                now;
 
   curve = (StripCurve)(ca_puser (args.chid));
   cd = (struct _ChannelData *)StripCurve_getattr_val
     (curve, STRIPCURVE_FUNCDATA);
+#ifdef STRIP_CA_PREEMPTIVE
+  if (defer_connect (cd->this, connect_callback, &args)) return;
+#endif
+  now = now_sec ();
 
   switch (ca_state (args.chid))
   {
@@ -408,13 +608,21 @@ static void connect_callback (struct connection_handler_args args)
 	  "  cd->chan_id=%x cd->event_id=%x\n",
 	  cd->chan_id, cd->event_id);
 #endif
+    retry_reset (cd, now);
     Strip_setwaiting (cd->this->strip, curve);
     break;
     
   case cs_conn:
+    retry_stop (cd);
     /* now connected, so get the control info if this is first time */
     if (cd->event_id == 0)
     {
+	if (cd->retries > 0)
+	  fprintf (stderr,
+	    "%s StripDAQ connect_callback: connected to %s after %.1f s, "
+	    "%d extra searches\n",
+	    timeStamp(),ca_name(args.chid)?ca_name(args.chid):"Name Unknown",
+	    now - cd->down_since, cd->retries);
 	status = ca_get_callback
 	  (DBR_CTRL_DOUBLE, cd->chan_id, info_callback, curve);
 	if (status != ECA_NORMAL)
@@ -425,9 +633,12 @@ static void connect_callback (struct connection_handler_args args)
 	}
     } else {
 	fprintf (stderr,
-	  "%s StripDAQ connect_callback: IOC reconnected for %s\n",
-	  timeStamp(),ca_name(args.chid)?ca_name(args.chid):"Name Unknown");
+	  "%s StripDAQ connect_callback: IOC reconnected for %s "
+	  "after %.1f s, %d extra searches\n",
+	  timeStamp(),ca_name(args.chid)?ca_name(args.chid):"Name Unknown",
+	  now - cd->down_since, cd->retries);
     }
+    cd->down_since = cd->retry_at = 0;
     break;
     
   case cs_closed:
@@ -452,10 +663,14 @@ static void info_callback (struct event_handler_args args)
   struct dbr_ctrl_double        *ctrl;
   int                           status;
   double                        low, hi;
+  long                          count;
 
   curve = (StripCurve)(ca_puser (args.chid));
   cd = (struct _ChannelData *)StripCurve_getattr_val
     (curve, STRIPCURVE_FUNCDATA);
+#ifdef STRIP_CA_PREEMPTIVE
+  if (defer_event (cd->this, info_callback, &args)) return;
+#endif
 
   if (args.status != ECA_NORMAL)
   {
@@ -505,8 +720,21 @@ static void info_callback (struct event_handler_args args)
     if (!StripCurve_getstat (curve, STRIPCURVE_MAX_SET))
       StripCurve_setattr (curve, STRIPCURVE_MAX, hi, 0);
 
-    status = ca_add_event
-      (DBR_STS_DOUBLE, cd->chan_id, data_callback, curve, &cd->event_id);
+    /* arrays are monitored whole, with their native element count */
+    count = ca_element_count (cd->chan_id);
+    if ((count > 1) && !wave_alloc (cd, count)) count = 1;
+    cd->array = (count > 1)? cd->array_req : CA_ARRAY_NONE;
+
+    if (cd->array)
+    {
+      StripCurve_setattr (curve, STRIPCURVE_WAVEFUNC, get_waveform, 0);
+      status = ca_add_array_event
+        (DBR_TIME_DOUBLE, count, cd->chan_id, data_callback, curve,
+         0.0, 0.0, 0.0, &cd->event_id);
+    }
+    else status = ca_add_event
+      (CA_PREEMPTIVE (cd->this)? DBR_TIME_DOUBLE : DBR_STS_DOUBLE,
+       cd->chan_id, data_callback, curve, &cd->event_id);
     if (status != ECA_NORMAL)
     {
       SEVCHK
@@ -531,6 +759,17 @@ static void data_callback (struct event_handler_args args)
   curve = (StripCurve)ca_puser (args.chid);
   cd = (struct _ChannelData *)StripCurve_getattr_val
     (curve, STRIPCURVE_FUNCDATA);
+#ifdef STRIP_CA_PREEMPTIVE
+  if (cd->this->preemptive && (args.status == ECA_NORMAL))
+  {
+    if (cd->array) wave_push (cd, &args);
+    else if (cd->this->ingest)
+      ring_push (cd, (struct dbr_time_double *)args.dbr);
+    else latest_push (cd, ((struct dbr_time_double *)args.dbr)->value);
+    return;
+  }
+  if (defer_event (cd->this, data_callback, &args)) return;
+#endif
 
   if (args.status != ECA_NORMAL)
   {
@@ -549,13 +788,198 @@ static void data_callback (struct event_handler_args args)
       StripCurve_setattr
         (curve, STRIPCURVE_SAMPLEFUNC, get_value, 0);
       Strip_setconnected (cd->this->strip, curve);
+      first_value (cd);
+    }
+    if (cd->array) wave_push (cd, &args);
+    else
+    {
+      sts = (struct dbr_sts_double *)args.dbr;
+      cd->value = sts->value;
     }
-    sts = (struct dbr_sts_double *)args.dbr;
-    cd->value = sts->value;
   }
 }
 
 
+/*
+ * retry_callback
+ *
+ *      Closes an extra search channel once it has found its server; the
+ *      channel it was opened for will then connect soon.
+ */
+static void retry_callback (struct connection_handler_args args)
+{
+  struct _ChannelData   *cd = (struct _ChannelData *)ca_puser (args.chid);
+
+#ifdef STRIP_CA_PREEMPTIVE
+  if (defer_connect (cd->this, retry_callback, &args)) return;
+#endif
+  if ((args.chid == cd->retry_chan_id) && (args.op == CA_OP_CONN_UP))
+  {
+    retry_stop (cd);
+    ca_flush_io ();
+  }
+}
+
+
+/*
+ * retry_run
+ *
+ *      Closes the extra searches which have run their time, and opens
+ *      new ones for the channels which are due.  The delay before the
+ *      next search doubles each time, up to STRIP_CA_RETRY_MAX.
+ */
+static void retry_run (StripDAQInfo *sca)
+{
+  struct _ChannelData   *cd;
+  double                now = now_sec ();
+  int                   i, status, flush = 0;
+
+  for (i = 0; i < STRIP_MAX_CURVES; i++)
+  {
+    cd = &sca->chan_data[i];
+    if (!cd->chan_id) continue;
+
+#if !defined (PEND_DESC) && !defined (PEND_DESCRIPTION)
+    if (cd->desc_chan_id && (now >= cd->desc_until) &&
+        (ca_state (cd->desc_chan_id) != cs_conn))
+    {
+      desc_clear (cd);
+      flush = 1;
+    }
+#endif
+    if (cd->retry_chan_id && (now >= cd->retry_end))
+    {
+      retry_stop (cd);
+      flush = 1;
+    }
+    if (cd->retry_chan_id || !cd->retry_at || (now < cd->retry_at) ||
+        (ca_state (cd->chan_id) == cs_conn))
+      continue;
+
+    status = ca_search_and_connect
+      (ca_name (cd->chan_id), &cd->retry_chan_id, retry_callback, cd);
+    if (status != ECA_NORMAL)
+    {
+      SEVCHK (status, "StripDAQ retry_run: error in ca_search");
+      cd->retry_chan_id = NULL;
+    }
+    else flush = 1;
+
+    cd->retries++;
+    cd->retry_end = now + RETRY_TIMEOUT;
+    cd->retry_at = now + cd->backoff;
+    cd->backoff = min (2 * cd->backoff, STRIP_CA_RETRY_MAX);
+  }
+
+  if (flush) ca_flush_io ();
+}
+
+
+/*
+ * retry_reset
+ *
+ *      Notes that the channel went down at the given time, and starts
+ *      its backoff.  The library searches right away by itself, so the
+ *      first extra search comes only after STRIP_CA_RETRY_MIN.
+ */
+static void retry_reset (struct _ChannelData *cd, double now)
+{
+  retry_stop (cd);
+  cd->down_since = now;
+  cd->backoff = STRIP_CA_RETRY_MIN;
+  cd->retry_at = now + cd->backoff;
+  cd->retries = 0;
+}
+
+
+/*
+ * retry_stop
+ */
+static void retry_stop (struct _ChannelData *cd)
+{
+  chid  chan_id = cd->retry_chan_id;
+
+  if (!chan_id) return;
+  cd->retry_chan_id = NULL;
+  if (ca_clear_channel (chan_id) != ECA_NORMAL)
+    fprintf (stderr, "StripDAQ retry_stop: error in ca_clear_channel\n");
+#ifdef STRIP_CA_PREEMPTIVE
+  if (cd->this->preemptive) defer_purge (cd->this, chan_id);
+#endif
+}
+
+
+static double now_sec (void)
+{
+  struct timeval        t;
+
+  get_current_time (&t);
+  return time2dbl (&t);
+}
+
+
+/*
+ * flush_soon
+ *
+ *      Flushes the requests queued meanwhile once the current Xt
+ *      callback has returned.
+ */
+static void flush_soon (StripDAQInfo *sca)
+{
+  if (sca->flush_pending) return;
+  Strip_addtimeout (sca->strip, 0, flush_callback, sca);
+  sca->flush_pending = 1;
+}
+
+
+/*
+ * flush_callback
+ *
+ *      Sends the searches queued since the last flush, which make up the
+ *      new batch.
+ */
+static void flush_callback (XtPointer ptr, XtIntervalId *BOGUS(1))
+{
+  StripDAQInfo *sca = (StripDAQInfo *) ptr;
+
+  sca->flush_pending = 0;
+  sca->batch++;
+  sca->batch_n = sca->batch_left = sca->batch_queued;
+  sca->batch_queued = 0;
+  sca->batch_slowest = NULL;
+  ca_flush_io();
+}
+
+
+/*
+ * first_value
+ *
+ *      Notes the time to the first value of a newly connected channel,
+ *      and reports its batch once all of it has values.  Its curve now
+ *      shows in the legend, so the description is looked up.
+ */
+static void first_value (struct _ChannelData *cd)
+{
+  StripDAQInfo *sca = cd->this;
+
+  if (cd->first_value >= 0) return;
+  cd->first_value = now_sec () - cd->requested;
+#ifndef PEND_DESCRIPTION
+  requestDescRecord ((StripCurve)ca_puser (cd->chan_id));
+#endif
+  if (cd->batch != sca->batch) return;
+
+  if (!sca->batch_slowest ||
+      (cd->first_value > sca->batch_slowest->first_value))
+    sca->batch_slowest = cd;
+  if ((--sca->batch_left == 0) && (sca->batch_n > 1))
+    fprintf (stderr,
+      "%s StripDAQ: first values of %d channels after %.2f s (%s)\n",
+      timeStamp(), sca->batch_n, sca->batch_slowest->first_value,
+      ca_name (sca->batch_slowest->chan_id));
+}
+
+
 /*
  * get_value
  *
@@ -565,28 +989,550 @@ static double get_value (void *data)
 {
   struct _ChannelData   *cd = (struct _ChannelData *)data;
 
+  if (cd->array) wave_drain (cd);
   return cd->value;
 }
 
 
+/*
+ * get_waveform
+ *
+ *      Gives the latest snapshot of an array curve.  Its slot is not
+ *      written until a newer one has been read.
+ */
+static int get_waveform (void *data, double **values)
+{
+  struct _ChannelData   *cd = (struct _ChannelData *)data;
+  size_t                i;
+
+  if (!cd->array) return 0;
+  wave_drain (cd);
+  if (cd->snap_done == 0) return 0;
+
+  i = (cd->snap_done - 1) & (STRIP_CA_SNAPSHOTS - 1);
+  *values = cd->snap_v + i * cd->stride;
+  return (int)cd->snap_n[i];
+}
+
+
+/*
+ * array_spec
+ *
+ *      Splits a curve name into the PV name and, for "[n]", "[mean]" or
+ *      "[max]" at its end, what an array PV is to plot against time
+ *      (element 0 by default).
+ */
+static void array_spec (char *name, char *pv, struct _ChannelData *cd)
+{
+  char  *p;
+
+  strncpy (pv, name, STRIP_MAX_NAME_CHAR);
+  pv[STRIP_MAX_NAME_CHAR] = '\0';
+  cd->array_req = CA_ARRAY_ELEMENT;
+  cd->element = 0;
+
+  if (!(p = strrchr (pv, '[')) || (pv[strlen (pv) - 1] != ']')) return;
+  if (strcmp (p, "[mean]") == 0) cd->array_req = CA_ARRAY_MEAN;
+  else if (strcmp (p, "[max]") == 0) cd->array_req = CA_ARRAY_MAX;
+  else if (isdigit ((unsigned char)p[1])) cd->element = atol (p + 1);
+  else return;
+  *p = '\0';
+}
+
+
+/*
+ * wave_alloc
+ *
+ *      Makes room for snapshots of count elements, which is only done
+ *      when the channel (re)connects, never per update.
+ */
+static int wave_alloc (struct _ChannelData *cd, long count)
+{
+  if (count > cd->stride)
+  {
+    if (cd->snap_v) free (cd->snap_v);
+    cd->stride = 0;
+    if (!(cd->snap_v = (double *)malloc
+          (STRIP_CA_SNAPSHOTS * count * sizeof (double))))
+    {
+      fprintf
+        (stderr, "StripDAQ: can't allocate memory for %ld elements of %s\n",
+         count, ca_name (cd->chan_id));
+      return 0;
+    }
+    cd->stride = count;
+  }
+  cd->snap_head = cd->snap_tail = cd->snap_done = 0;
+  return 1;
+}
+
+
+/*
+ * wave_push
+ *
+ *      Copies an array update into the next free snapshot.  A CA thread
+ *      finding the ring full drops the update; the Xt thread drains it
+ *      instead, as it is the only reader.  Either way, the slot which
+ *      get_waveform last returned is kept.
+ */
+static void wave_push (struct _ChannelData *cd, struct event_handler_args *args)
+{
+  struct dbr_time_double        *dbr = (struct dbr_time_double *)args->dbr;
+  size_t                        h = cd->snap_head, i;
+  long                          n = min (args->count, cd->stride);
+
+  if (h - ring_get (&cd->snap_tail) >= STRIP_CA_SNAPSHOTS)
+  {
+    if (CA_PREEMPTIVE (cd->this))
+    {
+      cd->lost++;
+      return;
+    }
+    wave_drain (cd);
+  }
+
+  i = h & (STRIP_CA_SNAPSHOTS - 1);
+  memcpy (cd->snap_v + i * cd->stride, &dbr->value, n * sizeof (double));
+  cd->snap_n[i] = n;
+  cd->snap_s[i] = dbr->severity;
+  stamp_time (dbr, &cd->snap_t[i]);
+  get_current_time (&cd->snap_r[i]);
+
+  ring_add (&cd->snap_head, 1);
+}
+
+
+/*
+ * wave_drain
+ *
+ *      Reduces the new snapshots to the values plotted against time,
+ *      passing them on in the preemptive mode, and releases all but the
+ *      latest.
+ */
+static void wave_drain (struct _ChannelData *cd)
+{
+  StripCurve            curve;
+  struct timeval        t[STRIP_CA_SNAPSHOTS], r[STRIP_CA_SNAPSHOTS];
+  double                v[STRIP_CA_SNAPSHOTS];
+  short                 s[STRIP_CA_SNAPSHOTS];
+  size_t                h = ring_get (&cd->snap_head), j, i;
+  int                   n = 0;
+
+  if (cd->lost != cd->lost_told)
+  {
+    fprintf
+      (stderr, "%s StripDAQ: %lu updates lost for %s\n", timeStamp(),
+       cd->lost - cd->lost_told, ca_name (cd->chan_id));
+    cd->lost_told = cd->lost;
+  }
+  if (cd->snap_done < cd->snap_tail) cd->snap_done = cd->snap_tail;
+  if (cd->snap_done == h) return;
+
+  curve = (StripCurve)ca_puser (cd->chan_id);
+  if (StripCurve_getstat (curve, STRIPCURVE_WAITING))
+  {
+    StripCurve_setattr (curve, STRIPCURVE_SAMPLEFUNC, get_value, 0);
+    Strip_setconnected (cd->this->strip, curve);
+    first_value (cd);
+  }
+
+  for (j = cd->snap_done; j < h; j++, n++)
+  {
+    i = j & (STRIP_CA_SNAPSHOTS - 1);
+    v[n] = wave_reduce (cd, cd->snap_v + i * cd->stride, cd->snap_n[i]);
+    t[n] = cd->snap_t[i];
+    r[n] = cd->snap_r[i];
+    s[n] = (cd->snap_s[i] < INVALID_ALARM)? DATASTAT_PLOTABLE : 0;
+  }
+  cd->snap_done = h;
+  cd->value = v[n - 1];
+
+  if (CA_PREEMPTIVE (cd->this))
+    Strip_ingest (cd->this->strip, curve, r, t, v, s, n);
+
+  ring_add (&cd->snap_tail, h - 1 - cd->snap_tail);
+}
+
+
+static double wave_reduce (struct _ChannelData *cd, double *x, long n)
+{
+  double        r;
+  long          i;
+
+  if (n <= 0) return cd->value;
+
+  switch (cd->array)
+  {
+  case CA_ARRAY_MEAN:
+    for (i = 0, r = 0; i < n; i++) r += x[i];
+    return r / n;
+  case CA_ARRAY_MAX:
+    for (i = 1, r = x[0]; i < n; i++) if (x[i] > r) r = x[i];
+    return r;
+  default:
+    return x[min (cd->element, n - 1)];
+  }
+}
+
+
+/*
+ * stamp_time
+ *
+ *      The time of an update: its time stamp, or now if it has none.
+ */
+static void stamp_time (struct dbr_time_double *dbr, struct timeval *tv)
+{
+  if (dbr->stamp.secPastEpoch)
+  {
+    tv->tv_sec = dbr->stamp.secPastEpoch + POSIX_TIME_AT_EPICS_EPOCH;
+    tv->tv_usec = dbr->stamp.nsec / 1000;
+  }
+  else get_current_time (tv);
+}
+
+
+/*
+ * ring_get, ring_add
+ *
+ *      Read and advance the indices of the update rings.  The reads are
+ *      followed by a barrier and the additions are full barriers, so
+ *      that data written before an index moves is seen after it.
+ */
+static size_t ring_get (size_t *p)
+{
+#ifdef STRIP_CA_PREEMPTIVE
+  size_t        v = epicsAtomicGetSizeT (p);
+
+  epicsAtomicReadMemoryBarrier ();
+  return v;
+#else
+  return *p;
+#endif
+}
+
+
+static void ring_add (size_t *p, size_t n)
+{
+#ifdef STRIP_CA_PREEMPTIVE
+  epicsAtomicAddSizeT (p, n);
+#else
+  *p += n;
+#endif
+}
+
+
+#ifdef STRIP_CA_PREEMPTIVE
+/*
+ * preemptive_init
+ *
+ *      Sets up the preemptive mode if it is asked for, returning true
+ *      if so.
+ */
+static int preemptive_init (StripDAQInfo *sca)
+{
+  struct _ChannelData   *cd;
+  char                  *env;
+  int                   i;
+
+  env = getenv (STRIP_CA_PREEMPTIVE_ENV);
+  if (!env || !strchr ("yY1", env[0])) return 0;
+
+  for (i = 0; i < STRIP_MAX_CURVES; i++)
+  {
+    cd = &sca->chan_data[i];
+    cd->ring_t = (struct timeval *)malloc
+      (STRIP_CA_RING_SIZE * sizeof (struct timeval));
+    cd->ring_r = (struct timeval *)malloc
+      (STRIP_CA_RING_SIZE * sizeof (struct timeval));
+    cd->ring_v = (double *)malloc (STRIP_CA_RING_SIZE * sizeof (double));
+    cd->ring_s = (short *)malloc (STRIP_CA_RING_SIZE * sizeof (short));
+    if (!cd->ring_t || !cd->ring_r || !cd->ring_v || !cd->ring_s) break;
+  }
+  if ((i < STRIP_MAX_CURVES) || !(sca->lock = epicsMutexCreate ()))
+  {
+    fprintf (stderr, "StripDAQ: can't allocate memory for preemptive mode\n");
+    for (i = 0; i < STRIP_MAX_CURVES; i++)
+    {
+      cd = &sca->chan_data[i];
+      if (cd->ring_t) free (cd->ring_t);
+      if (cd->ring_r) free (cd->ring_r);
+      if (cd->ring_v) free (cd->ring_v);
+      if (cd->ring_s) free (cd->ring_s);
+      cd->ring_t = NULL;
+      cd->ring_r = NULL;
+      cd->ring_v = NULL;
+      cd->ring_s = NULL;
+    }
+    return 0;
+  }
+
+  sca->xt_thread = epicsThreadGetIdSelf ();
+  sca->preemptive = 1;
+  sca->ingest = Strip_ingesting (sca->strip);
+  return 1;
+}
+
+
+/*
+ * ring_push
+ *
+ *      Called from the CA thread.  An update which finds the ring full is
+ *      lost, and counted.
+ */
+static void ring_push (struct _ChannelData *cd, struct dbr_time_double *dbr)
+{
+  size_t        h = cd->head, i;
+
+  if (h - ring_get (&cd->tail) >= STRIP_CA_RING_SIZE)
+  {
+    cd->lost++;
+    return;
+  }
+
+  i = h & (STRIP_CA_RING_SIZE - 1);
+  stamp_time (dbr, &cd->ring_t[i]);
+  get_current_time (&cd->ring_r[i]);
+  cd->ring_v[i] = dbr->value;
+  cd->ring_s[i] = dbr->severity;
+
+  ring_add (&cd->head, 1);
+}
+
+
+/*
+ * ring_drain
+ *
+ *      Hands the queued updates to the Strip in runs, and keeps the
+ *      latest value for sampling.  If the Strip doesn't want them, there
+ *      is only the latest value.
+ */
+static void ring_drain (struct _ChannelData *cd)
+{
+  StripCurve    curve;
+  size_t        t = cd->tail, h = ring_get (&cd->head), i, n, k;
+  double        v;
+  int           latest = !cd->this->ingest && latest_get (cd, &v);
+
+  if (cd->lost != cd->lost_told)
+  {
+    fprintf
+      (stderr, "%s StripDAQ: %lu updates lost for %s\n", timeStamp(),
+       cd->lost - cd->lost_told, ca_name (cd->chan_id));
+    cd->lost_told = cd->lost;
+  }
+  if ((h == t) && !latest) return;
+
+  curve = (StripCurve)ca_puser (cd->chan_id);
+  if (StripCurve_getstat (curve, STRIPCURVE_WAITING))
+  {
+    StripCurve_setattr (curve, STRIPCURVE_SAMPLEFUNC, get_value, 0);
+    Strip_setconnected (cd->this->strip, curve);
+    first_value (cd);
+  }
+  if (latest) cd->value = v;
+
+  while (t != h)
+  {
+    i = t & (STRIP_CA_RING_SIZE - 1);
+    n = min (h - t, STRIP_CA_RING_SIZE - i);
+    for (k = i; k < i + n; k++)
+      cd->ring_s[k] = (cd->ring_s[k] < INVALID_ALARM)? DATASTAT_PLOTABLE : 0;
+    Strip_ingest
+      (cd->this->strip, curve,
+       cd->ring_r + i, cd->ring_t + i, cd->ring_v + i, cd->ring_s + i,
+       (int)n);
+    cd->value = cd->ring_v[i + n - 1];
+    t += n;
+  }
+
+  ring_add (&cd->tail, h - cd->tail);
+}
+
+
+/*
+ * latest_push
+ *
+ *      Called from the CA thread instead of ring_push when only the
+ *      latest value is wanted, so that no update is ever dropped for
+ *      a full ring.
+ */
+static void latest_push (struct _ChannelData *cd, double v)
+{
+  ring_add (&cd->latest_seq, 1);
+  epicsAtomicWriteMemoryBarrier ();
+  cd->latest_v = v;
+  epicsAtomicWriteMemoryBarrier ();
+  ring_add (&cd->latest_seq, 1);
+}
+
+
+/*
+ * latest_get
+ *
+ *      Reads the latest value, returning false if there is none since
+ *      the last call.
+ */
+static int latest_get (struct _ChannelData *cd, double *v)
+{
+  size_t        seq;
+
+  do
+  {
+    seq = ring_get (&cd->latest_seq);
+    *v = cd->latest_v;
+    epicsAtomicReadMemoryBarrier ();
+  }
+  while ((seq & 1) || (seq != ring_get (&cd->latest_seq)));
+
+  if (seq == cd->latest_read) return 0;
+  cd->latest_read = seq;
+  return 1;
+}
+
+
+/*
+ * defer_connect, defer_event
+ *
+ *      Outside the Xt thread, queue the callback to be called again from
+ *      it, with a copy of the data, and return true.
+ */
+static int defer_connect (StripDAQInfo                          *sca,
+                          void (*func) (struct connection_handler_args),
+                          struct connection_handler_args        *args)
+{
+  CAEvent       *ev;
+
+  if (!sca->preemptive || (epicsThreadGetIdSelf () == sca->xt_thread))
+    return 0;
+
+  if (!(ev = (CAEvent *)calloc (1, sizeof (CAEvent))))
+  {
+    fprintf (stderr, "StripDAQ: can't allocate memory, event lost\n");
+    return 1;
+  }
+  ev->chan_id = args->chid;
+  ev->conn_func = func;
+  ev->conn = *args;
+  defer_queue (sca, ev);
+  return 1;
+}
+
+
+static int defer_event (StripDAQInfo                    *sca,
+                        void (*func) (struct event_handler_args),
+                        struct event_handler_args       *args)
+{
+  CAEvent       *ev;
+  size_t        size = 0;
+
+  if (!sca->preemptive || (epicsThreadGetIdSelf () == sca->xt_thread))
+    return 0;
+
+  if (args->dbr) size = dbr_size_n (args->type, args->count);
+  if (!(ev = (CAEvent *)calloc (1, sizeof (CAEvent) + size)))
+  {
+    fprintf (stderr, "StripDAQ: can't allocate memory, event lost\n");
+    return 1;
+  }
+  ev->chan_id = args->chid;
+  ev->event_func = func;
+  ev->event = *args;
+  if (size)
+  {
+    memcpy (ev + 1, args->dbr, size);
+    ev->event.dbr = ev + 1;
+  }
+  defer_queue (sca, ev);
+  return 1;
+}
+
+
+static void defer_queue (StripDAQInfo *sca, CAEvent *ev)
+{
+  epicsMutexLock (sca->lock);
+  if (sca->events_last) sca->events_last->next = ev;
+  else sca->events = ev;
+  sca->events_last = ev;
+  epicsMutexUnlock (sca->lock);
+}
+
+
+/*
+ * defer_run
+ *
+ *      Calls the queued callbacks, one at a time, since each may clear
+ *      channels and so purge events after it.
+ */
+static void defer_run (StripDAQInfo *sca)
+{
+  CAEvent       *ev;
+
+  for (;;)
+  {
+    epicsMutexLock (sca->lock);
+    if ((ev = sca->events) != NULL)
+    {
+      sca->events = ev->next;
+      if (!sca->events) sca->events_last = NULL;
+    }
+    epicsMutexUnlock (sca->lock);
+
+    if (!ev) break;
+    if (ev->conn_func) ev->conn_func (ev->conn);
+    else ev->event_func (ev->event);
+    free (ev);
+  }
+}
+
+
+/*
+ * defer_purge
+ *
+ *      Drops the queued events of a channel which has been cleared.
+ */
+static void defer_purge (StripDAQInfo *sca, chid chan_id)
+{
+  CAEvent       **p, *ev;
+
+  epicsMutexLock (sca->lock);
+  sca->events_last = NULL;
+  for (p = &sca->events; (ev = *p) != NULL; )
+    if (ev->chan_id == chan_id)
+    {
+      *p = ev->next;
+      free (ev);
+    }
+    else
+    {
+      sca->events_last = ev;
+      p = &ev->next;
+    }
+  epicsMutexUnlock (sca->lock);
+}
+#endif  /* STRIP_CA_PREEMPTIVE */
+
+
 #ifdef PEND_DESCRIPTION
 /*
  * getDescriptionRecord
  *
  *      Searches and waits for the description
  */
-static void getDescriptionRecord (char *name, char *description)
+static void getDescriptionRecord (StripDAQInfo *sca, char *name,
+                                  char *description)
 {
   int status;
   chid id;
   static char desc_name[64];
-  char *ptr;
+  char *ptr, *cached;
   
   /* construct the name */
   memset(desc_name,0,64);
   strcpy(desc_name,name);
   ptr=strchr(desc_name,'.');
   if(ptr) *ptr='\0';
+  ptr=strchr(desc_name,'[');
+  if(ptr) *ptr='\0';
   strcat(desc_name,".DESC");
 
   /* Check validity and initialize to blank */
@@ -597,6 +1543,12 @@ static void getDescriptionRecord (char *name, char *description)
 #endif    
   }
   *description ='\0';
+
+  if ((cached = StripDescCache_get (sca->desc_cache, desc_name)))
+  {
+    strcpy (description, cached);
+    return;
+  }
   
   status = ca_search(desc_name, &id);
   if (status != ECA_NORMAL) {
@@ -641,6 +1593,7 @@ static void getDescriptionRecord (char *name, char *description)
       return;     
     }
 
+  StripDescCache_put (sca->desc_cache, desc_name, description);
 }
 #endif  /* #ifdef PEND_DESCRIPTION */
 
@@ -657,17 +1610,29 @@ static void requestDescRecord (StripCurve curve)
   char *name = (char *)StripCurve_getattr_val (curve, STRIPCURVE_NAME);
   struct _ChannelData *cd = (struct _ChannelData *)StripCurve_getattr_val
     (curve, STRIPCURVE_FUNCDATA);
-  char *ptr;
+  char *ptr, *cached;
+
+  if (cd->desc_chan_id) return;
 
   /* construct the name */
   memset(desc_name,0,64);
   strcpy(desc_name,name);
   ptr=strchr(desc_name,'.');
   if(ptr) *ptr='\0';
+  ptr=strchr(desc_name,'[');
+  if(ptr) *ptr='\0';
   strcat(desc_name,".DESC");
 
+  /* known from an earlier session */
+  if ((cached = StripDescCache_get (cd->this->desc_cache, desc_name)))
+  {
+    StripCurve_setattr (curve, STRIPCURVE_COMMENT, cached, 0);
+    Strip_setdescconnected (cd->this->strip, curve);
+    return;
+  }
+
   /* search */
-  cd->desc_chan_id = NULL;
+  cd->desc_until = now_sec () + STRIP_CA_DESC_TIMEOUT;
 #if DEBUG_ASSERT
     printf("requestDescRecord: ca_search_and_connect: %s\n",
 	desc_name?desc_name:"NULL");
@@ -679,7 +1644,9 @@ static void requestDescRecord (StripCurve curve)
     SEVCHK(status,"     Search for description field failed\n");
     fprintf(stderr,"%s: Search for description field failed\n", desc_name);
 #endif    
+    cd->desc_chan_id = NULL;
   }
+  else flush_soon (cd->this);
 }
 
 /*
@@ -694,6 +1661,9 @@ static void desc_connect_callback (struct connection_handler_args args)
   curve = (StripCurve)(ca_puser (args.chid));
   cd = (struct _ChannelData *)StripCurve_getattr_val
     (curve, STRIPCURVE_FUNCDATA);
+#ifdef STRIP_CA_PREEMPTIVE
+  if (defer_connect (cd->this, desc_connect_callback, &args)) return;
+#endif
   
   switch (ca_state (args.chid))
   {
@@ -747,11 +1717,13 @@ static void desc_info_callback (struct event_handler_args args)
   StripCurve                    curve;
   struct _ChannelData           *cd;
   char                          *desc;
-  int                           status;
 
   curve = (StripCurve)(ca_puser (args.chid));
   cd = (struct _ChannelData *)StripCurve_getattr_val
     (curve, STRIPCURVE_FUNCDATA);
+#ifdef STRIP_CA_PREEMPTIVE
+  if (defer_event (cd->this, desc_info_callback, &args)) return;
+#endif
 
   if (args.status != ECA_NORMAL)
   {
@@ -771,28 +1743,44 @@ static void desc_info_callback (struct event_handler_args args)
     /* get the description */
     desc = (char *)args.dbr;
     StripCurve_setattr (curve, STRIPCURVE_COMMENT, desc, 0);
+    StripDescCache_put
+      (cd->this->desc_cache, (char *)ca_name (args.chid), desc);
 
     /* set the description to be connected */
     Strip_setdescconnected (cd->this->strip, curve);
+  }
+
+  /* clear the description channel, we are through */
+  desc_clear (cd);
+}
+
 
-    /* clear the description channel, we are through */
+/*
+ * desc_clear
+ */
+static void desc_clear (struct _ChannelData *cd)
+{
+  int                           status;
+
+  if (!cd->desc_chan_id) return;
 #if DEBUG_ASSERT
-    printf("desc_info_callback: ca_clear_channel: %s\n",
-	ca_name(cd->desc_chan_id)?ca_name(cd->desc_chan_id):"NULL");
+  printf("desc_clear: ca_clear_channel: %s\n",
+    ca_name(cd->desc_chan_id)?ca_name(cd->desc_chan_id):"NULL");
 #endif
-    if ((status = ca_clear_channel (cd->desc_chan_id)) != ECA_NORMAL)
-    {
-      SEVCHK (status, "desc_info_callback: error in ca_clear_channel");
-    }
-    else
-    {
-      cd->desc_chan_id = NULL;
-    }
-#if DEBUG_ASSERT
-    printf("  Done\n");
+  if ((status = ca_clear_channel (cd->desc_chan_id)) != ECA_NORMAL)
+  {
+    SEVCHK (status, "desc_clear: error in ca_clear_channel");
+  }
+  else
+  {
+#ifdef STRIP_CA_PREEMPTIVE
+    if (cd->this->preemptive) defer_purge (cd->this, cd->desc_chan_id);
 #endif
-
+    cd->desc_chan_id = NULL;
   }
+#if DEBUG_ASSERT
+  printf("  Done\n");
+#endif
 }
 #endif  /* #ifndef PEND_DESCRIPTION */
 
@@ -0,0 +1,355 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* The compressor thread reads the pipe until the writer closes it, even
+ * after an error, so that the writer never blocks on a full pipe.
+ */
+
+#include "StripCompress.h"
+#include "StripDefines.h"
+
+#include <string.h>
+#include <errno.h>
+
+#ifndef WIN32
+#define STRIP_COMPRESS_THREAD
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <zlib.h>
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+#endif
+
+#define COMPRESS_BLOCK  65536           /* bytes */
+
+typedef struct _StripCompressInfo
+{
+  StripCompressType     type;
+  int                   level;
+  int                   fd;             /* read end of the pipe */
+  FILE                  *out;
+  int                   ok;
+#ifdef STRIP_COMPRESS_THREAD
+  pthread_t             thread;
+#endif
+}
+StripCompressInfo;
+
+static char     *suffixes[STRIP_COMPRESS_COUNT] = { "", ".gz", ".zst" };
+
+#ifdef STRIP_COMPRESS_THREAD
+static void     *compress_thread        (void *);
+static void     compress_gzip           (StripCompressInfo *,
+                                         unsigned char *, unsigned char *);
+#ifdef USE_ZSTD
+static void     compress_zstd           (StripCompressInfo *,
+                                         unsigned char *, unsigned char *);
+#endif
+static long     compress_read           (StripCompressInfo *, unsigned char *);
+static void     compress_write          (StripCompressInfo *,
+                                         unsigned char *, size_t);
+#endif
+
+
+/* StripCompress_available
+ */
+int             StripCompress_available (StripCompressType type)
+{
+  switch (type)
+  {
+    case STRIP_COMPRESS_NONE:
+      return 1;
+#ifdef STRIP_COMPRESS_THREAD
+    case STRIP_COMPRESS_GZIP:
+      return 1;
+#ifdef USE_ZSTD
+    case STRIP_COMPRESS_ZSTD:
+      return 1;
+#endif
+#endif
+    default:
+      return 0;
+  }
+}
+
+
+/* StripCompress_suffix
+ */
+char            *StripCompress_suffix   (StripCompressType type)
+{
+  if ((type < 0) || (type >= STRIP_COMPRESS_COUNT)) return "";
+  return suffixes[type];
+}
+
+
+/* StripCompress_type
+ */
+StripCompressType       StripCompress_type      (char *fname)
+{
+  size_t        n = strlen (fname), k;
+  int           i;
+
+  for (i = STRIP_COMPRESS_NONE + 1; i < STRIP_COMPRESS_COUNT; i++)
+  {
+    k = strlen (suffixes[i]);
+    if ((n > k) && (strcmp (fname + n - k, suffixes[i]) == 0))
+      return (StripCompressType)i;
+  }
+  return STRIP_COMPRESS_NONE;
+}
+
+
+/* StripCompress_open
+ */
+FILE            *StripCompress_open     (char                   *fname,
+                                         char                   *mode,
+                                         StripCompressType      type,
+                                         StripCompress          *handle)
+{
+#ifdef STRIP_COMPRESS_THREAD
+  StripCompressInfo     *sc;
+  FILE                  *f;
+  char                  *env;
+  int                   fds[2];
+#endif
+
+  *handle = 0;
+  if (type == STRIP_COMPRESS_NONE) return fopen (fname, mode);
+  if (!StripCompress_available (type))
+  {
+    errno = EINVAL;
+    return 0;
+  }
+
+#ifdef STRIP_COMPRESS_THREAD
+  if (!(sc = (StripCompressInfo *)calloc (1, sizeof (StripCompressInfo))))
+    return 0;
+  sc->type = type;
+  sc->ok = 1;
+  sc->level = STRIP_DUMP_COMPRESS_LEVEL;
+  if ((env = getenv (STRIP_DUMP_COMPRESS_LEVEL_ENV)) && (atoi (env) > 0))
+    sc->level = atoi (env);
+
+  if (!(sc->out = fopen (fname, "wb")))
+  {
+    free (sc);
+    return 0;
+  }
+  if (pipe (fds) != 0)
+  {
+    fclose (sc->out);
+    free (sc);
+    return 0;
+  }
+  sc->fd = fds[0];
+
+  /* a child spawned meanwhile (the browser, say) mustn't keep the write
+   * end open, or the compressor would never see the end of the data */
+  fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl (fds[1], F_SETFD, FD_CLOEXEC);
+
+  if (!(f = fdopen (fds[1], "w")) ||
+      (pthread_create (&sc->thread, 0, compress_thread, sc) != 0))
+  {
+    if (f) fclose (f);
+    else close (fds[1]);
+    close (fds[0]);
+    fclose (sc->out);
+    free (sc);
+    errno = EAGAIN;
+    return 0;
+  }
+  setvbuf (f, 0, _IOFBF, COMPRESS_BLOCK);
+
+  *handle = (StripCompress)sc;
+  return f;
+#else
+  return 0;
+#endif
+}
+
+
+/* StripCompress_close
+ */
+int             StripCompress_close     (StripCompress the_sc, FILE *f)
+{
+  int                   ok = 1;
+#ifdef STRIP_COMPRESS_THREAD
+  StripCompressInfo     *sc = (StripCompressInfo *)the_sc;
+#endif
+
+  if (fclose (f) != 0) ok = 0;
+
+#ifdef STRIP_COMPRESS_THREAD
+  if (!sc) return ok;
+  pthread_join (sc->thread, 0);
+  close (sc->fd);
+  if (fclose (sc->out) != 0) ok = 0;
+  ok = ok && sc->ok;
+  free (sc);
+#endif
+  return ok;
+}
+
+
+#ifdef STRIP_COMPRESS_THREAD
+
+static void     *compress_thread        (void *arg)
+{
+  StripCompressInfo     *sc = (StripCompressInfo *)arg;
+  unsigned char         *in, *out;
+
+  in = (unsigned char *)malloc (COMPRESS_BLOCK);
+  out = (unsigned char *)malloc (COMPRESS_BLOCK);
+  if (!in || !out)
+  {
+    sc->ok = 0;
+    if (in)
+      while (compress_read (sc, in) > 0);
+  }
+#ifdef USE_ZSTD
+  else if (sc->type == STRIP_COMPRESS_ZSTD) compress_zstd (sc, in, out);
+#endif
+  else compress_gzip (sc, in, out);
+
+  if (in) free (in);
+  if (out) free (out);
+  return 0;
+}
+
+
+/* compress_gzip
+ */
+static void     compress_gzip           (StripCompressInfo      *sc,
+                                         unsigned char          *in,
+                                         unsigned char          *out)
+{
+  z_stream      zs;
+  long          n;
+  int           flush, level = (sc->level > 9)? 9 : sc->level;
+
+  memset (&zs, 0, sizeof (zs));
+  if (deflateInit2
+      (&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+  {
+    sc->ok = 0;
+    while (compress_read (sc, in) > 0);
+    return;
+  }
+
+  do
+  {
+    n = compress_read (sc, in);
+    flush = (n > 0)? Z_NO_FLUSH : Z_FINISH;
+    zs.next_in = in;
+    zs.avail_in = (n > 0)? (uInt)n : 0;
+    do
+    {
+      zs.next_out = out;
+      zs.avail_out = COMPRESS_BLOCK;
+      deflate (&zs, flush);
+      compress_write (sc, out, COMPRESS_BLOCK - zs.avail_out);
+    }
+    while (zs.avail_out == 0);
+  }
+  while (flush != Z_FINISH);
+
+  deflateEnd (&zs);
+}
+
+
+#ifdef USE_ZSTD
+/* compress_zstd
+ */
+static void     compress_zstd           (StripCompressInfo      *sc,
+                                         unsigned char          *in,
+                                         unsigned char          *out)
+{
+  ZSTD_CCtx             *cctx;
+  ZSTD_inBuffer         ib;
+  ZSTD_outBuffer        ob;
+  ZSTD_EndDirective     mode;
+  size_t                left;
+  long                  n;
+
+  if (!(cctx = ZSTD_createCCtx ()))
+  {
+    sc->ok = 0;
+    while (compress_read (sc, in) > 0);
+    return;
+  }
+  ZSTD_CCtx_setParameter (cctx, ZSTD_c_compressionLevel, sc->level);
+
+  do
+  {
+    n = compress_read (sc, in);
+    mode = (n > 0)? ZSTD_e_continue : ZSTD_e_end;
+    ib.src = in;
+    ib.size = (n > 0)? (size_t)n : 0;
+    ib.pos = 0;
+    do
+    {
+      ob.dst = out;
+      ob.size = COMPRESS_BLOCK;
+      ob.pos = 0;
+      left = ZSTD_compressStream2 (cctx, &ob, &ib, mode);
+      if (ZSTD_isError (left))
+      {
+        sc->ok = 0;
+        break;
+      }
+      compress_write (sc, out, ob.pos);
+    }
+    while ((mode == ZSTD_e_end)? (left > 0) : (ib.pos < ib.size));
+  }
+  while (n > 0);
+
+  if (!sc->ok) while (compress_read (sc, in) > 0);
+  ZSTD_freeCCtx (cctx);
+}
+#endif
+
+
+/* compress_read
+ *
+ *      Reads a block from the pipe, returning its length, 0 at the end,
+ *      or -1 on error.
+ */
+static long     compress_read           (StripCompressInfo *sc, unsigned char *p)
+{
+  long  n;
+
+  do n = (long)read (sc->fd, p, COMPRESS_BLOCK);
+  while ((n < 0) && (errno == EINTR));
+  if (n < 0) sc->ok = 0;
+  return n;
+}
+
+
+static void     compress_write          (StripCompressInfo      *sc,
+                                         unsigned char          *p,
+                                         size_t                 n)
+{
+  if (sc->ok && (n > 0) && (fwrite (p, 1, n, sc->out) != n)) sc->ok = 0;
+}
+
+#endif  /* STRIP_COMPRESS_THREAD */
+
+/* **************************** Emacs Editing Sequences ***************** */
+/* Local Variables: */
+/* tab-width: 6 */
+/* c-basic-offset: 2 */
+/* c-comment-only-line-offset: 0 */
+/* c-indent-comments-syntactically-p: t */
+/* c-label-minimum-indentation: 1 */
+/* End: */
@@ -0,0 +1,77 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#ifndef _StripCompress
+#define _StripCompress
+
+#include "StripMisc.h"
+
+/* StripCompress
+ *
+ *      Compressed output files.  The writer gets a stdio stream as
+ *      usual, which feeds a pipe; a thread of its own reads the pipe
+ *      and writes the compressed data to the file, so that formatting
+ *      and compression overlap.  gzip is always there, zstd only when
+ *      built with USE_ZSTD.  The level is STRIP_DUMP_COMPRESS_LEVEL.
+ */
+typedef enum
+{
+  STRIP_COMPRESS_NONE = 0,
+  STRIP_COMPRESS_GZIP,
+  STRIP_COMPRESS_ZSTD,
+  STRIP_COMPRESS_COUNT
+}
+StripCompressType;
+
+typedef void *  StripCompress;
+
+
+/* StripCompress_available
+ *
+ *      True if the method is supported by this build.
+ */
+int             StripCompress_available (StripCompressType);
+
+
+/* StripCompress_suffix
+ *
+ *      The file name extension of the method ("" for none).
+ */
+char            *StripCompress_suffix   (StripCompressType);
+
+
+/* StripCompress_type
+ *
+ *      The method which the file name's extension calls for.
+ */
+StripCompressType       StripCompress_type      (char *);
+
+
+/* StripCompress_open
+ *
+ *      Opens the file for writing, returning the stream to write to and
+ *      the handle for closing it, or 0 with errno set.  Without
+ *      compression, this is just fopen() with the given mode.
+ */
+FILE            *StripCompress_open     (char *,                /* name */
+                                         char *,                /* mode */
+                                         StripCompressType,
+                                         StripCompress *);
+
+
+/* StripCompress_close
+ *
+ *      Closes the stream, and waits for the compressed data to be
+ *      written.  Returns false if anything went wrong.
+ */
+int             StripCompress_close     (StripCompress, FILE *);
+
+#endif  /* _StripCompress */
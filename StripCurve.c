@@ -25,6 +25,7 @@ StripCurve      StripCurve_init (StripConfig *scfg)
     sc->details                 = 0;
     sc->func_data               = 0;
     sc->get_value               = 0;
+    sc->get_waveform            = 0;
     sc->status                  = 0;
   }
 
@@ -148,6 +149,10 @@ int             StripCurve_setattr      (StripCurve the_sc, ...)
 	  sc->get_value = va_arg (ap, StripCurveSampleFunc);
 	  break;
 	  
+	case STRIPCURVE_WAVEFUNC:
+	  sc->get_waveform = va_arg (ap, StripCurveWaveFunc);
+	  break;
+	  
       }
     }
     else break;
@@ -210,6 +215,9 @@ int             StripCurve_getattr      (StripCurve the_sc, ...)
 	case STRIPCURVE_SAMPLEFUNC:
 	  *(va_arg (ap, StripCurveSampleFunc *)) = sc->get_value;
 	  break;
+	case STRIPCURVE_WAVEFUNC:
+	  *(va_arg (ap, StripCurveWaveFunc *)) = sc->get_waveform;
+	  break;
       }
     else break;
   }
@@ -257,6 +265,8 @@ void    *StripCurve_getattr_val (StripCurve the_sc, StripCurveAttribute attrib)
     return (void *)sc->func_data;
   case STRIPCURVE_SAMPLEFUNC:
     return (void *)sc->get_value;
+  case STRIPCURVE_WAVEFUNC:
+    return (void *)sc->get_waveform;
   default:
     return NULL;
   }
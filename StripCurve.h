@@ -42,6 +42,10 @@ typedef void *          StripCurve;
 
 typedef double          (*StripCurveSampleFunc)         (void *);
 
+/* gives the latest waveform of an array curve and returns its length,
+ * or 0 if there is none; the values stay valid until the Xt loop runs */
+typedef int             (*StripCurveWaveFunc)           (void *, double **);
+
 /* ======= Attributes ======= */
 typedef enum
 {
@@ -58,6 +62,7 @@ typedef enum
   STRIPCURVE_COLOR,             /* (cColor *)                           r  */
   STRIPCURVE_FUNCDATA,          /* (void *)                             rw */
   STRIPCURVE_SAMPLEFUNC,        /* (StripCurveSampleFunc)               rw */
+  STRIPCURVE_WAVEFUNC,          /* (StripCurveWaveFunc) array curves    rw */
   STRIPCURVE_LAST_ATTRIBUTE
 }
 StripCurveAttribute;
@@ -144,6 +149,7 @@ typedef struct
   struct timeval        connect_request;
   void                  *func_data;
   StripCurveSampleFunc  get_value;      /* must pass func_data when calling */
+  StripCurveWaveFunc    get_waveform;   /* likewise, or 0 for scalars */
   unsigned              status;
 }
 StripCurveInfo;
@@ -55,7 +55,8 @@ int StripDAQ_request_disconnect (StripCurve, void *);
 /*
  * StripDAQ_retry_connections
  *
- *      Tries to reconnect to currently unconnected PVs.
+ *      Searches again, without waiting, for all currently unconnected
+ *      PVs.  Returns -1 (and beeps) if there are none.
  */
 int StripDAQ_retry_connections (StripDAQ the_sca, Display *display);
 
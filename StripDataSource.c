@@ -71,10 +71,13 @@
 
 #include "StripDataSource.h"
 #include "StripDefines.h"
+#include "StripFormat.h"
+#include "StripResample.h"
 #include "StripMisc.h"
 #include "StripGraph.h" /* Albert */
 
 #include <X11/cursorfont.h>
+#include <float.h>
 extern Widget history_topShell;
 extern int auto_scaleTriger;
 extern long radioChange;
@@ -94,10 +97,30 @@ static Cursor cursor = 0;
 #define SDS_DUMP_NUMWIDTH       23 /* Albert -- was 20 */
 #define SDS_DUMP_BADVALUESTR    "BadVal"
 
+#define SDS_COLS_MAGIC          "STRIPCOL"
+#define SDS_COLS_VERSION        1
+#define SDS_COLS_HEADER         64      /* bytes */
+#define SDS_COLS_ENTRY          128     /* bytes per curve in the directory */
+#define SDS_COLS_BLOCK          8192    /* samples per fwrite */
+#define SDS_PAD8(n)             (((n) + 7) & ~((size_t)7))
+#define SDS_GRID_BATCH          65536   /* grid points per curve in memory */
+
 #define SDS_BUFFERED_DATA       (1 << 0)
 #define SDS_HISTORY_DATA        (1 << 1)
 #define SDS_BOTH_DATA           (SDS_BUFFERED_DATA | SDS_HISTORY_DATA)
 
+/* history data may be used while a progressive fetch is still going on,
+ * or when it stopped short */
+#define HISTORY_USABLE(r) \
+(((r)->fetch_stat == FETCH_DONE) || \
+ (((r)->fetch_stat == FETCH_PENDING) && ((r)->n_points > 0)) || \
+ (((r)->fetch_stat == FETCH_PARTIAL) && ((r)->n_points > 0)))
+
+/* a finished fetch, whose [t0, t1] is the span it covers */
+#define HISTORY_COVERED(r) \
+(((r)->fetch_stat == FETCH_DONE) || ((r)->fetch_stat == FETCH_NODATA) || \
+ ((r)->fetch_stat == FETCH_PARTIAL))
+
 
 #define DUMP_SDDS_TIME_COL           "Time"
 #define DUMP_SDDS_TIME_COL_UNITS     "seconds"
@@ -112,6 +135,7 @@ typedef struct          _TimeBuffer
   struct timeval        *base;
   struct timeval        *ptr;
   size_t                count;
+  StripHistoryChunk     *chunk; /* history chunk, or 0 for the ring buffer */
 } TimeBuffer;
 
 typedef struct          _ValueBuffer
@@ -128,6 +152,48 @@ typedef struct          _StatusBuffer
   size_t                count;
 } StatusBuffer;
 
+/* DumpMerge
+ *
+ *      k-way merge of the curves' history results by time, for the data
+ *      dumps.  Each curve has a cursor into its chunk list, and the heap
+ *      holds the curves with samples left, ordered by the time of their
+ *      next sample, so a row costs O(log k) per sample instead of a scan
+ *      of all the data.  The dumps fetch and merge the range a window
+ *      (STRIP_DUMP_WINDOW) at a time, so that only one window of history
+ *      data is in memory at once; the latest values carry over from one
+ *      window to the next.
+ */
+typedef struct          _DumpCursor
+{
+  StripHistoryChunk     *chunk;         /* next sample, or 0 */
+  int                   i;
+  int                   have;           /* value, status are set */
+  double                value;          /* latest sample so far */
+  StatusType            status;
+  int                   hit;            /* it was at the current row */
+} DumpCursor;
+
+typedef struct          _DumpMerge
+{
+  DumpCursor            c[STRIP_MAX_CURVES];
+  int                   heap[STRIP_MAX_CURVES];
+  int                   n;
+  int                   asof;           /* else exact time matches */
+  struct timeval        t;              /* current row */
+} DumpMerge;
+
+/* GridSource
+ *
+ *      Where a curve's samples go on for the time grid dumps: its history
+ *      up to the start of the ring buffer data, then the ring buffer.
+ */
+typedef struct          _GridSource
+{
+  StripHistoryChunk     *chunk;         /* next history sample, or 0 */
+  size_t                i;
+  size_t                r;              /* ring buffer samples used */
+} GridSource;
+
 typedef enum _SegmentifyDirection
 {
   SDS_INCREASING, SDS_DECREASING
@@ -163,14 +229,73 @@ static long     find_date_idx   (struct timeval         *t,
   size_t                 idx_latest,
   int                    mode);
 
+static long     find_hist_idx   (struct timeval         *t,
+  StripHistoryResult     *result,
+  int                    mode);
+
+static void     hist_seek       (StripHistoryResult     *,
+  size_t,
+  TimeBuffer *,
+  ValueBuffer *,
+  StatusBuffer *);
+
+static void     hist_use_chunk  (StripHistoryChunk      *,
+  TimeBuffer *,
+  ValueBuffer *,
+  StatusBuffer *);
+
+static void     history_callback        (StripHistoryResult *, void *);
+static void     history_notify  (StripDataSourceInfo *);
+static void     extend_callback (StripHistoryResult *, void *);
+static void     extend_fetch    (StripDataSourceInfo *, CurveData *, int,
+                                 struct timeval *, struct timeval *);
+static void     extend_finish   (StripDataSourceInfo *, CurveData *, int);
+static void     extend_release  (StripDataSourceInfo *, CurveData *);
+static int      history_extend  (StripDataSourceInfo    *,
+                                 CurveData              *,
+                                 struct timeval         *,
+                                 struct timeval         *);
+static void     hist_point      (StripHistoryResult     *,
+  size_t,
+  DataPoint *);
+
 static int      pack_array      (void **, size_t,
   int, int, int,
   int, int *, int *);
 
 static int      verify_render_buffer    (RenderBuffer   *, int);
 
-static int printData(struct timeval *t,CurveData *c,char *v); /*Albert */
-static int findNextTime(struct timeval *tv,struct timeval *res,StripDataSourceInfo *s) ; /*Albert */
+static int      ring_min_max    (StripDataSourceInfo *, CurveData *,
+                                 int, int, double *, double *);
+
+static void     dump_begin      (StripDataSourceInfo *, StripGraph,
+                                 struct timeval *, struct timeval *);
+static void     dump_end        (StripGraph);
+static void     dump_progress   (StripDataSourceInfo *, struct timeval *,
+                                 struct timeval *, struct timeval *);
+static void     dump_history    (StripDataSourceInfo *, StripFormat *,
+                                 struct timeval *, struct timeval *,
+                                 char *, char *);
+static int      dump_window     (struct timeval *, struct timeval *,
+                                 struct timeval *);
+static void     dump_fetch      (StripDataSourceInfo *, StripHistoryResult *,
+                                 struct timeval *, struct timeval *);
+static void     dump_release    (StripDataSourceInfo *, StripHistoryResult *);
+static void     dump_merge_init (DumpMerge *, StripHistoryResult *,
+                                 struct timeval *);
+static int      dump_merge_next (DumpMerge *, struct timeval *, int);
+static void     dump_sift_down  (DumpMerge *, int);
+static int      dump_grid       (StripDataSourceInfo *, StripFormat *,
+                                 struct timeval *, struct timeval *,
+                                 char *, char *);
+static int      grid_feed       (StripDataSourceInfo *, int, GridSource *,
+                                 StripResample *, struct timeval *, int,
+                                 long, double *, char *);
+static void     cols_put        (unsigned char *, double, int);
+static int      cols_write      (FILE *, StripDataSourceInfo *,
+                                 StripHistoryResult *, CurveData *,
+                                 long, long, long, long, int);
+static int      cols_copy       (FILE *, FILE *);
 
 /*
  * StripDataSource_init
@@ -195,6 +320,17 @@ StripDataSource_init    (StripHistory history)
     sds->idx_t1         = 0;
     sds->bin_size       = 0;
     sds->n_bins         = 0;
+    sds->refresh_func   = 0;
+    sds->refresh_data   = 0;
+    sds->rescale_func   = 0;
+    sds->rescale_pending = 0;
+    sds->snapshot       = 0;
+    sds->progress       = 0;
+    sds->cancel         = 0;
+    sds->record         = 0;
+    sds->ingesting      = 0;
+    sds->grid           = STRIP_RESAMPLE_OFF;
+    sds->grid_step      = 0;
 
     /* clear the buffers */
     memset (sds->buffers, 0, STRIP_MAX_CURVES * sizeof(CurveData));
@@ -220,8 +356,15 @@ StripDataSource_delete  (StripDataSource the_sds)
       free (sds->buffers[i].val);
     if (sds->buffers[i].stat)
       free (sds->buffers[i].stat);
+    StripMinMax_delete (sds->buffers[i].summary);
+    if (sds->snapshot && sds->buffers[i].curve)
+    {
+      free (sds->buffers[i].curve->details);
+      free (sds->buffers[i].curve);
+    }
   }
 
+  if (sds->snapshot && sds->times) free (sds->times);
   free (sds);
 }
 
@@ -260,6 +403,34 @@ StripDataSource_setattr (StripDataSource the_sds, ...)
 	    sds->buf_size);
 #endif
 	  break;
+
+	case SDS_REFRESH_FUNC:
+	  sds->refresh_func = va_arg (ap, void (*)(void *));
+	  break;
+
+	case SDS_REFRESH_DATA:
+	  sds->refresh_data = va_arg (ap, void *);
+	  break;
+
+	case SDS_RESCALE_FUNC:
+	  sds->rescale_func = va_arg (ap, void (*)(void *));
+	  break;
+
+	case SDS_DUMP_CANCEL:
+	  sds->cancel = va_arg (ap, int);
+	  break;
+
+	case SDS_RECORD:
+	  sds->record = va_arg (ap, StripRecord);
+	  break;
+
+	case SDS_DUMP_GRID:
+	  sds->grid = (StripResampleMethod)va_arg (ap, int);
+	  break;
+
+	case SDS_DUMP_GRID_STEP:
+	  sds->grid_step = va_arg (ap, double);
+	  break;
       }
   }
 
@@ -300,6 +471,38 @@ StripDataSource_getattr (StripDataSource the_sds, ...)
 	  *(va_arg (ap, struct timeval *)) = sds->times[index];
 	  break;
 
+	case SDS_REFRESH_FUNC:
+	  *(va_arg (ap, void (**)(void *))) = sds->refresh_func;
+	  break;
+
+	case SDS_REFRESH_DATA:
+	  *(va_arg (ap, void **)) = sds->refresh_data;
+	  break;
+
+	case SDS_RESCALE_FUNC:
+	  *(va_arg (ap, void (**)(void *))) = sds->rescale_func;
+	  break;
+
+	case SDS_DUMP_PROGRESS:
+	  *(va_arg (ap, double *)) = sds->progress;
+	  break;
+
+	case SDS_DUMP_CANCEL:
+	  *(va_arg (ap, int *)) = sds->cancel;
+	  break;
+
+	case SDS_RECORD:
+	  *(va_arg (ap, StripRecord *)) = sds->record;
+	  break;
+
+	case SDS_DUMP_GRID:
+	  *(va_arg (ap, int *)) = (int)sds->grid;
+	  break;
+
+	case SDS_DUMP_GRID_STEP:
+	  *(va_arg (ap, double *)) = sds->grid_step;
+	  break;
+
       }
   }
 
@@ -334,11 +537,14 @@ StripDataSource_addcurve        (StripDataSource        the_sds,
     {
       sds->buffers[i].curve = (StripCurveInfo *)the_curve;
       memset (sds->buffers[i].endpoints, 0, 2*sizeof(DataPoint));
+      sds->buffers[i].ingested = False;
       
       /* use the id field of the strip curve to reference the buffer */
       ((StripCurveInfo *)the_curve)->id = &sds->buffers[i];
 	
       sds->buffers[i].history.fetch_stat = FETCH_IDLE;
+      sds->buffers[i].extend[0].fetch_stat = FETCH_IDLE;
+      sds->buffers[i].extend[1].fetch_stat = FETCH_IDLE;
       ret = 1;
     }
     else
@@ -384,7 +590,7 @@ if(sds->cur_idx > 1) {
  
     if(cd->history.n_points > 0) {
 	for(n=0;n<cd->history.n_points;n++)
-	  printf("%s",ctime(&cd->history.times[n].tv_sec));
+	  printf("%s",ctime(&cd->history.first->times[n].tv_sec));
     }   
 
     /* History problem  */
@@ -401,7 +607,11 @@ void  StripDataSource_refresh (StripDataSource        the_sds)
 
 /* Albert */
   for(i=0;i<STRIP_MAX_CURVES;i++)
+  {
+    StripHistory_cancel (sds->history, &sds->buffers[i].history);
     sds->buffers[i].history.fetch_stat = FETCH_IDLE;
+    extend_release (sds, &sds->buffers[i]);
+  }
 }
 
 
@@ -427,6 +637,9 @@ StripDataSource_min_max (StripDataSourceInfo *sds, struct timeval h0,
   double alpha;
   
   int local_precision;
+#ifdef STRIP_HISTORY
+  struct timeval h_hi;
+#endif
   
   for (m = 0; m < STRIP_MAX_CURVES; m++)
   {
@@ -439,82 +652,64 @@ StripDataSource_min_max (StripDataSourceInfo *sds, struct timeval h0,
 	  (&h0, sds->times, sds->count, sds->buf_size, sds->cur_idx, SDS_GTE);
       last=find_date_idx
 	  (&h_end, sds->times, sds->count, sds->buf_size, sds->cur_idx, SDS_LTE);
+
+      min = DBL_MAX;
+      max = -DBL_MAX;
 	
       if ((first > -1) && (last > -1) )
 	{
-	  some_data=1;
-	  min=cd->val[first]; 
-	  max=cd->val[first];
-	  if (first <= last)
+	  if (!StripMinMax_valid (cd->summary, cd->val, (int)sds->buf_size))
 	  {
-	    for(i=first; i <= last; i++) 
-	    {
-		if(cd->val[i] < min) min=cd->val[i]; 
-		if(cd->val[i] > max) max=cd->val[i]; 
-	    }
+	    StripMinMax_delete (cd->summary);
+	    cd->summary = StripMinMax_build
+	      (cd->val, cd->stat, (int)sds->buf_size);
 	  }
+	  if (first <= last)
+	    some_data |= ring_min_max (sds, cd, first, last, &min, &max);
 	  else
 	  {
-#if 0
-	    /* perror Albert problem */
-	    for(i=first; i <= last; i--)
-	    {
-		printf("\n\n!!!!%f;\n",cd->val[i]); 
-		if(cd->val[i]<min) min=cd->val[i]; 
-		if(cd->val[i]>max) max=cd->val[i]; 
-	    }
-#else
-	    /* First part is first to end */
-	    for(i=first; i < (int)sds->buf_size; i++)
-	    {
-		if(cd->val[i] < min) min=cd->val[i]; 
-		if(cd->val[i] > max) max=cd->val[i]; 
-	    }
-	    /* Second part is 0 to last */
-	    for(i=0; i <= last; i++)
-	    {
-		if(cd->val[i] < min) min=cd->val[i]; 
-		if(cd->val[i] > max) max=cd->val[i]; 
-	    }
-#endif	  
+	    /* First part is first to end, second part is 0 to last */
+	    some_data |= ring_min_max
+	      (sds, cd, first, (int)sds->buf_size - 1, &min, &max);
+	    some_data |= ring_min_max (sds, cd, 0, last, &min, &max);
 	  }
 	}
 #ifdef STRIP_HISTORY
-	if(!cursor) cursor = XCreateFontCursor(XtDisplay(history_topShell),XC_watch);
-	XDefineCursor(XtDisplay(history_topShell),
-	  XtWindow(history_topShell), cursor);
-	XFlush(XtDisplay(history_topShell));
-
-      StripHistory_fetch
-	  (sds->history, cd->curve->details->name, &h0, &h_end,
-	    &cd->history, 0, 0);
-
-	XUndefineCursor(XtDisplay(history_topShell),
-	  XtWindow(history_topShell));
+      /* the ring buffer holds the curve from its oldest sample in range
+       * on, so the archive is needed only before that */
+      h_hi = h_end;
+      if ((first > -1) &&
+	  (compare_times (&sds->times[first], &h_hi) < 0))
+	h_hi = sds->times[first];
+      if ((cd->first != SIZE_MAX) &&
+	  (compare_times (&sds->times[cd->first], &h_hi) < 0) &&
+	  (compare_times (&sds->times[cd->first], &h0) > 0))
+	h_hi = sds->times[cd->first];
+
+      /* normally init_range has fetched the range already (or is still
+       * fetching it), so only ask the archive for what is missing.  The
+       * fetch doesn't block: the limits are worked out again once it
+       * is in (see history_notify) */
+      if ((compare_times (&h0, &h_hi) < 0) &&
+	  ((cd->history.fetch_stat == FETCH_IDLE) ||
+	   (compare_times (&cd->history.t0, &h0) > 0) ||
+	   (compare_times (&cd->history.t1, &h_hi) < 0)))
+      {
+	if (!history_extend (sds, cd, &h0, &h_hi))
+	  StripHistory_fetch
+	    (sds->history, cd->curve->details->name, &h0, &h_hi,
+	      &cd->history, history_callback, sds);
+	sds->rescale_pending = 1;
+      }
 
-	if((cd->history.n_points>0)&&(cd->history.fetch_stat==FETCH_DONE))
+      if((cd->history.n_points>0) && HISTORY_USABLE (&cd->history))
 	{
-	  first = find_date_idx
-	    (&h0, cd->history.times, cd->history.n_points,
-		cd->history.n_points, cd->history.n_points - 1, SDS_GTE);
-	  last = find_date_idx
-	    (&h_end, cd->history.times, cd->history.n_points,
-		cd->history.n_points, cd->history.n_points - 1, SDS_LTE);
+	  first = find_hist_idx (&h0, &cd->history, SDS_GTE);
+	  last = find_hist_idx (&h_end, &cd->history, SDS_LTE);
 	  
 	  if ((first > -1) && (last > -1) && (first<=last ) )
-	  {
-	    if (some_data == 0) 
-	    {
-		min=cd->history.data[first];
-		max=cd->history.data[first];
-		some_data =1;
-	    }
-	    for(i=first;i<= last; i++)  
-	    {
-		if (cd->history.data[i]< min) min=cd->history.data[i]; 
-		if (cd->history.data[i]> max) max=cd->history.data[i]; 
-	    }
-	  }
+	    some_data |= StripHistoryResult_min_max
+	      (&cd->history, (size_t)first, (size_t)last, &min, &max);
 	}
 
 #endif /* STRIP_HISTORY */
@@ -589,11 +784,14 @@ StripDataSource_removecurve     (StripDataSource the_sds, StripCurve the_curve)
   if ((cd = CURVE_DATA(the_curve)) != NULL)
   {
     StripHistoryResult_release (sds->history, &cd->history);
+    extend_release (sds, cd);
     cd->curve = NULL;
     free (cd->val);
     free (cd->stat);
     cd->val = NULL;
     cd->stat = NULL;
+    StripMinMax_delete (cd->summary);
+    cd->summary = 0;
     ((StripCurveInfo *)the_curve)->id = NULL;
   }
 
@@ -698,9 +896,65 @@ StripDataSource_sample  (StripDataSource the_sds, char *sgP)
           sds->buffers[i].first = (sds->buffers[i].first + 1) % sds->buf_size;
       }
       else sds->buffers[i].stat[sds->cur_idx] &= ~DATASTAT_PLOTABLE;
+
+      StripMinMax_update
+        (sds->buffers[i].summary, sds->buffers[i].val,
+         sds->buffers[i].stat, (int)sds->cur_idx);
     }
   }
+
+  if (sds->record && !need_time)
+  {
+    for (i = 0; i < STRIP_MAX_CURVES; i++)
+      if (((c = sds->buffers[i].curve) != NULL) && !sds->buffers[i].ingested)
+        StripRecord_value
+          (sds->record, i, c->details->name, &sds->times[sds->cur_idx],
+           sds->buffers[i].val[sds->cur_idx],
+           sds->buffers[i].stat[sds->cur_idx]);
+    if (!sds->ingesting)
+      StripRecord_flush (sds->record, &sds->times[sds->cur_idx]);
+  }
+}
+
+/*
+ * StripDataSource_ingest
+ */
+void
+StripDataSource_ingest  (StripDataSource        the_sds,
+                         StripCurve             the_curve,
+                         struct timeval         *times,
+                         struct timeval         *stamps,
+                         double                 *values,
+                         StatusType             *status,
+                         int                    n)
+{
+  StripDataSourceInfo   *sds = (StripDataSourceInfo *)the_sds;
+  CurveData             *cd;
+  int                   i;
+
+  if (!(cd = CURVE_DATA(the_curve))) return;
+  cd->ingested = True;
+  if (!sds->record) return;
+
+  for (i = 0; i < n; i++)
+    StripRecord_update
+      (sds->record, (int)(cd - sds->buffers), cd->curve->details->name,
+       &times[i], &stamps[i], values[i], status[i]);
+}
+
+/*
+ * StripDataSource_ingested
+ */
+void
+StripDataSource_ingested        (StripDataSource        the_sds,
+                                 struct timeval         *t)
+{
+  StripDataSourceInfo   *sds = (StripDataSourceInfo *)the_sds;
+
+  sds->ingesting = 1;
+  StripRecord_flush (sds->record, t);
 }
+
 /*
   Line 844
   some HACK here if delta time for History request < 2% from range interval
@@ -866,9 +1120,11 @@ StripDataSource_init_range      (StripDataSource        the_sds,
 	    XtWindow(history_topShell), cursor);
 	  XFlush(XtDisplay(history_topShell));
 
-        StripHistory_fetch
-          (sds->history, cd->curve->details->name, &h0, h_end,
-		&cd->history, 0, 0);
+        if (!history_extend (sds, cd, &h0, h_end))
+          StripHistory_fetch
+            (sds->history, cd->curve->details->name, &h0, h_end,
+		  &cd->history, history_callback, sds);
+
 	  XUndefineCursor(XtDisplay(history_topShell),
 	    XtWindow(history_topShell));
       }
@@ -876,14 +1132,10 @@ StripDataSource_init_range      (StripDataSource        the_sds,
       /* if we have history data, we now need to find the
        * begin and end locations for the current history range */
       if ((compare_times (&h0, h_end) < 0) &&
-	  (cd->history.fetch_stat == FETCH_DONE))
+	  HISTORY_USABLE (&cd->history))
       {
-        cd->hidx_t0 = find_date_idx
-          (&h0, cd->history.times, cd->history.n_points,
-		cd->history.n_points, cd->history.n_points - 1, SDS_GTE);
-        cd->hidx_t1 = find_date_idx
-          (h_end, cd->history.times, cd->history.n_points,
-		cd->history.n_points, cd->history.n_points - 1, SDS_LTE);
+        cd->hidx_t0 = find_hist_idx (&h0, &cd->history, SDS_GTE);
+        cd->hidx_t1 = find_hist_idx (h_end, &cd->history, SDS_LTE);
 
         have_data |= ((cd->hidx_t0 >= 0) && (cd->hidx_t1 >= cd->hidx_t0));
       }
@@ -932,6 +1184,7 @@ StripDataSource_render  (StripDataSource        the_sds,
       
     ring_times.base = sds->times; 
     ring_times.count = sds->buf_size;
+    ring_times.chunk = 0;
     ring_values.base = cd->val;
     ring_values.count = sds->buf_size;
     ring_status.base = cd->stat;
@@ -939,16 +1192,14 @@ StripDataSource_render  (StripDataSource        the_sds,
   }
 
   /* history buffer pointers & initializations */
-  if (cd->history.fetch_stat == FETCH_DONE)
+  if (HISTORY_USABLE (&cd->history) &&
+      (cd->hidx_t0 <= cd->hidx_t1) &&
+      (cd->hidx_t1 < (size_t)cd->history.n_points))
   {
     data_state |= SDS_HISTORY_DATA;
     
-    hist_times.base = cd->history.times;
-    hist_times.count = cd->history.n_points;
-    hist_values.base = cd->history.data;
-    hist_values.count = cd->history.n_points;
-    hist_status.base = cd->history.status;
-    hist_status.count = cd->history.n_points;
+    hist_point (&cd->history, cd->hidx_t0, &hist_first);
+    hist_point (&cd->history, cd->hidx_t1, &hist_last);
   }
 
   if (!(data_state & SDS_BOTH_DATA))    /* no data at all? */
@@ -992,12 +1243,10 @@ StripDataSource_render  (StripDataSource        the_sds,
     /* any history data before currently rendered? */
     if (data_state & SDS_HISTORY_DATA)
     {
-      if (compare_times
-	  (&hist_times.base[cd->hidx_t0], &cd->endpoints[0].t) < 0)
+      if (compare_times (&hist_first.t, &cd->endpoints[0].t) < 0)
       {
-        hist_times.ptr = hist_times.base + cd->hidx_t0;
-        hist_values.ptr = hist_values.base + cd->hidx_t0;
-        hist_status.ptr = hist_status.base + cd->hidx_t0;
+        hist_seek
+          (&cd->history, cd->hidx_t0, &hist_times, &hist_values, &hist_status);
 
         segmentify
           (sds, &render_buffer, SDS_INCREASING,
@@ -1009,23 +1258,15 @@ StripDataSource_render  (StripDataSource        the_sds,
         /* new beginning endpoint */
         cd->endpoints[0] = hist_first;
       }
-      else
-      {
-        hist_first.t = hist_times.base[cd->hidx_t0];
-        hist_first.v = hist_values.base[cd->hidx_t0];
-        hist_first.s = hist_status.base[cd->hidx_t0];
-      }
     }
 
     /* any history data following currently rendered? */
     if (data_state & SDS_HISTORY_DATA)
     {
-      if (compare_times
-	  (&hist_times.base[cd->hidx_t1], &cd->endpoints[1].t) > 0)
+      if (compare_times (&hist_last.t, &cd->endpoints[1].t) > 0)
       {
-        hist_times.ptr = hist_times.base + cd->hidx_t1;
-        hist_values.ptr = hist_values.base + cd->hidx_t1;
-        hist_status.ptr = hist_status.base + cd->hidx_t1;
+        hist_seek
+          (&cd->history, cd->hidx_t1, &hist_times, &hist_values, &hist_status);
         
         segmentify
           (sds, &render_buffer, SDS_DECREASING,
@@ -1037,12 +1278,6 @@ StripDataSource_render  (StripDataSource        the_sds,
         /* new finishing endpoint */
         cd->endpoints[1] = hist_last;
       }
-      else
-      {
-        hist_last.t = hist_times.base[cd->hidx_t1];
-        hist_last.v = hist_values.base[cd->hidx_t1];
-        hist_last.s = hist_status.base[cd->hidx_t1];
-      }
     }
      
     /* any data in the ring buffer following currently rendered? */
@@ -1138,15 +1373,13 @@ StripDataSource_render  (StripDataSource        the_sds,
     /* ====== history data ====== */
     if (data_state & SDS_HISTORY_DATA)
     {
-      hist_times.ptr = hist_times.base + cd->hidx_t0;
-      hist_values.ptr = hist_values.base + cd->hidx_t0;
-      hist_status.ptr = hist_status.base + cd->hidx_t0;
+      hist_seek
+        (&cd->history, cd->hidx_t0, &hist_times, &hist_values, &hist_status);
 
       if (data_state & SDS_BUFFERED_DATA)
       {
         /* any history data ahead of currently rendered buffer data? */
-        if (compare_times
-	    (&hist_times.base[cd->hidx_t0], &cd->endpoints[0].t) < 0)
+        if (compare_times (&hist_first.t, &cd->endpoints[0].t) < 0)
         {
           segmentify
             (sds, &render_buffer, SDS_INCREASING,
@@ -1164,7 +1397,7 @@ StripDataSource_render  (StripDataSource        the_sds,
         segmentify
           (sds, &render_buffer, SDS_INCREASING,
 		&hist_times, &hist_values, &hist_status,
-		cd->hidx_t1 - cd->hidx_t0 + 1, &hist_times.base[cd->hidx_t1],
+		cd->hidx_t1 - cd->hidx_t0 + 1, &hist_last.t,
 		0, 0,
 		&cd->endpoints[0], &cd->endpoints[1],        /* new endpoints */
 		x_transform, x_data, y_transform, y_data);
@@ -1257,6 +1490,11 @@ segmentify      (StripDataSourceInfo    *sds,
         stat = status->ptr++;
         n_processed++;
 
+        /* step onto the next history chunk */
+        if ((times->ptr >= times->base + times->count) &&
+            times->chunk && times->chunk->next)
+          hist_use_chunk (times->chunk->next, times, values, status);
+
         /* check buffers for wrap around */
         if (times->ptr >= times->base + times->count)
           times->ptr -= times->count;
@@ -1273,6 +1511,16 @@ segmentify      (StripDataSourceInfo    *sds,
         stat = status->ptr--;
         n_processed++;
 
+        /* step back onto the previous history chunk */
+        if ((times->ptr < times->base) &&
+            times->chunk && times->chunk->prev)
+        {
+          hist_use_chunk (times->chunk->prev, times, values, status);
+          times->ptr += times->count - 1;
+          values->ptr += values->count - 1;
+          status->ptr += status->count - 1;
+        }
+
         /* check buffers for wrap around */
         if (times->ptr < times->base)
           times->ptr += times->count;
@@ -1633,6 +1881,85 @@ StripDataSource_dump_sdds    (StripDataSource        the_sds,
 #endif /* SDDS */
 
 
+/*
+ * StripDataSource_snapshot
+ */
+StripDataSource
+StripDataSource_snapshot        (StripDataSource        the_sds,
+  struct timeval         *begin,
+  struct timeval         *end)
+{
+  StripDataSourceInfo   *sds = (StripDataSourceInfo *)the_sds;
+  StripDataSourceInfo   *snap;
+  StripCurveInfo        *curve;
+  long                  first = -1, last = -1, n = 0, i, k;
+  int                   j, ok;
+
+  if (!(snap = (StripDataSourceInfo *)StripDataSource_init (sds->history)))
+    return 0;
+  snap->snapshot = 1;
+  snap->req_t0 = *begin;
+  snap->req_t1 = *end;
+
+  if (sds->count > 0)
+  {
+    first = find_date_idx
+      (begin, sds->times, sds->count, sds->buf_size, sds->cur_idx, SDS_GTE);
+    last = find_date_idx
+      (end, sds->times, sds->count, sds->buf_size, sds->cur_idx, SDS_LTE);
+  }
+  if ((first >= 0) && (last >= 0) &&
+      (compare_times (&sds->times[first], &sds->times[last]) <= 0))
+    n = (first <= last)?
+      last - first + 1 : (long)sds->buf_size - first + last + 1;
+
+  /* the samples are laid out from index 0, and the buffer is never full */
+  snap->buf_size = n + 1;
+  snap->count = n;
+  snap->cur_idx = (n > 0)? n - 1 : 0;
+  snap->idx_t0 = 0;
+  snap->idx_t1 = snap->cur_idx;
+  ok = ((snap->times = (struct timeval *)calloc
+         (snap->buf_size, sizeof (struct timeval))) != 0);
+  for (i = 0, k = first; ok && (i < n); i++, k = (k + 1) % sds->buf_size)
+    snap->times[i] = sds->times[k];
+
+  for (j = 0; ok && (j < STRIP_MAX_CURVES); j++)
+  {
+    if (!sds->buffers[j].curve) continue;
+
+    curve = (StripCurveInfo *)calloc (1, sizeof (StripCurveInfo));
+    snap->buffers[j].curve = curve;
+    snap->buffers[j].val = (double *)malloc (snap->buf_size * sizeof (double));
+    snap->buffers[j].stat = (StatusType *)malloc
+      (snap->buf_size * sizeof (StatusType));
+    if (!curve || !snap->buffers[j].val || !snap->buffers[j].stat ||
+        !(curve->details = (StripCurveDetail *)malloc
+          (sizeof (StripCurveDetail))))
+    {
+      ok = 0;
+      break;
+    }
+    *curve->details = *sds->buffers[j].curve->details;
+
+    for (i = 0, k = first; i < n; i++, k = (k + 1) % sds->buf_size)
+    {
+      snap->buffers[j].val[i] = sds->buffers[j].val[k];
+      snap->buffers[j].stat[i] = sds->buffers[j].stat[k];
+    }
+  }
+
+  if (!ok)
+  {
+    fprintf (stderr, "StripDataSource_snapshot: can't allocate memory\n");
+    StripDataSource_delete ((StripDataSource)snap);
+    return 0;
+  }
+
+  return (StripDataSource)snap;
+}
+
+
 /*
  * StripDataSource_dump
  */
@@ -1641,13 +1968,10 @@ StripDataSource_dump    (StripDataSource        the_sds,
   FILE                   *outfile,char * cgi) /* Albert */
 {
   StripDataSourceInfo   *sds = (StripDataSourceInfo *)the_sds;
-  char                  buf[SDS_DUMP_FIELDWIDTH+1];
-  int                   i, j;
+  StripFormat           sf;
+  int                   i, j, ok = 1;
   struct timeval Start,End;
-  struct timeval StartCopy,EndCopy;
-  CurveData *cd;
 
-  struct timeval *timeP=0;
   StripGraph sg = (StripGraph) cgi; /* Albert */
 
   /* if range is not initialized, return failure  Albert not nessary for hist
@@ -1657,28 +1981,11 @@ StripDataSource_dump    (StripDataSource        the_sds,
   for (i = 0; i < STRIP_MAX_CURVES; i++) if (sds->buffers[i].curve) break;
   if (i >= STRIP_MAX_CURVES) { if(DEBUG1)perror("No one curvers");return 0; }
 
-  StripGraph_getattr (sg, STRIPGRAPH_BEGIN_TIME, &Start, 0);
-  StripGraph_getattr (sg, STRIPGRAPH_END_TIME,   &End,   0);
-
-  memcpy(&StartCopy,&Start,sizeof(struct timeval));
-  memcpy(  &EndCopy,&End,  sizeof(struct timeval));
+  dump_begin (sds, sg, &Start, &End);
 
   if(DEBUG1)printf("Start=%s",ctime((const time_t *)&(Start.tv_sec)));
   if(DEBUG1)printf("End=%s",ctime((const time_t *)&(End.tv_sec)));
 
-  if(!cursor) cursor = XCreateFontCursor(XtDisplay(history_topShell),XC_watch);
-  XDefineCursor(XtDisplay(history_topShell),
-    XtWindow(history_topShell), cursor);
-  XFlush(XtDisplay(history_topShell));
-
-  for (i = 0; i < STRIP_MAX_CURVES; i++) {
-    if (!sds->buffers[i].curve) continue; 
-    cd = &sds->buffers[i];
-    StripHistory_fetch
-      (sds->history, cd->curve->details->name, &StartCopy, &EndCopy,
-	  &cd->history, 0, 0);
-  }
-
   /* this is very straightforward:
    * (a) for every curve, print out its name across the top
    * (b) for every time on the range
@@ -1694,40 +2001,20 @@ StripDataSource_dump    (StripDataSource        the_sds,
   fprintf (outfile, "\n");
   
   /* (b) */
-  timeP=&StartCopy;
-
-  while(findNextTime(timeP,timeP,sds) ==0) 
-  {
-    if(compare_times(timeP,&Start)<0) continue;
-    if(compare_times(timeP,&End)>0) break;
-
-    /* (b-1) */
-    memset(buf,0,SDS_DUMP_FIELDWIDTH+1);
-    strftime(buf, SDS_DUMP_FIELDWIDTH, "%m/%d/%Y %H:%M:%S",
-	localtime ((const time_t *)&(timeP->tv_sec)));
-    fprintf (outfile, "%s.%06d\t",buf,(int)timeP->tv_usec);
-      
-    /* (b-2) */
-    for (j = 0; j < STRIP_MAX_CURVES; j++)
-	if (sds->buffers[j].curve)
-	{
-	  cd = &sds->buffers[j];
-	  memset(buf,0,SDS_DUMP_FIELDWIDTH+1);
-	  printData(timeP,cd,buf);
-	  fprintf (outfile, "%s\t",buf);
-	}
-      
-    /* finally, the end-line */
-    fprintf (outfile, "\n");
-  } /* end of history while() handeling */
+  StripFormat_init (&sf, outfile, "%m/%d/%Y %H:%M:%S");
+  if (sds->grid != STRIP_RESAMPLE_OFF)
+    ok = dump_grid (sds, &sf, &Start, &End, "", "\t");
+  else dump_history (sds, &sf, &Start, &End, "", "\t");
 
   
   if(DEBUG1)printf("Start=%s",ctime((const time_t *)&(Start.tv_sec)));
   if(DEBUG1)printf("End=%s",ctime((const time_t *)&(End.tv_sec)));
 
-  if (sds->idx_t0 != sds->idx_t1) 
+  if ((sds->grid == STRIP_RESAMPLE_OFF) && (sds->idx_t0 != sds->idx_t1))
   {
-    for (i = sds->idx_t0; i != sds->idx_t1; i = (i+1) % sds->buf_size)
+    for (i = sds->idx_t0;
+         (i != sds->idx_t1) && !sds->cancel;
+         i = (i+1) % sds->buf_size)
     {
 	if(compare_times(&(sds->times[i]),&End)>0) 
 	{if(DEBUG1)printf("T[%d]>End   break\n",i); break;}
@@ -1738,31 +2025,30 @@ StripDataSource_dump    (StripDataSource        the_sds,
 	if(DEBUG1)printf("Good i=%d\n",i);
 	
 	/* (b-1) */
-	memset(buf,0,SDS_DUMP_FIELDWIDTH+1);
-	strftime(buf, SDS_DUMP_FIELDWIDTH, "%m/%d/%Y %H:%M:%S",
-	  localtime ((const time_t *)&(sds->times[i].tv_sec)));
-	fprintf (outfile, "%s.%06d\t",buf,(int)sds->times[i].tv_usec); 
+	StripFormat_time (&sf, &sds->times[i]);
+	StripFormat_string (&sf, "\t");
 	/* (b-2) */
 	for (j = 0; j < STRIP_MAX_CURVES; j++)
 	  if (sds->buffers[j].curve)
 	  {
 	    if (sds->buffers[j].stat[i] & DATASTAT_PLOTABLE)
-		fprintf (outfile, "%g\t",sds->buffers[j].val[i]);
-	    else fprintf (outfile, "%s\t",SDS_DUMP_BADVALUESTR);
+		StripFormat_double (&sf, sds->buffers[j].val[i]);
+	    else StripFormat_string (&sf, SDS_DUMP_BADVALUESTR);
+	    StripFormat_string (&sf, "\t");
 	  }
 	
 	/* finally, the end-line */
-	fprintf (outfile, "\n");
+	StripFormat_string (&sf, "\n");
     }
   } else {if(DEBUG1) perror("DUMP:NO CURRENT DATA");}
 
 
   if(DEBUG1)printf("Last i=%d\n",i);
 
+  ok = StripFormat_flush (&sf) && ok;
   fflush (outfile);
-  XUndefineCursor(XtDisplay(history_topShell),
-    XtWindow(history_topShell));
-  return 1;
+  dump_end (sg);
+  return ok && !sds->cancel;
 }
 
 
@@ -1774,13 +2060,10 @@ StripDataSource_dump_csv    (StripDataSource        the_sds,
   FILE                   *outfile,char * cgi)
 {
   StripDataSourceInfo   *sds = (StripDataSourceInfo *)the_sds;
-  char                  buf[SDS_DUMP_FIELDWIDTH+1];
-  int                   i, j;
+  StripFormat           sf;
+  int                   i, j, ok = 1;
   struct timeval Start,End;
-  struct timeval StartCopy,EndCopy;
-  CurveData *cd;
 
-  struct timeval *timeP=0;
   StripGraph sg = (StripGraph) cgi;
 
   /* if range is not initialized, return failure 
@@ -1790,28 +2073,11 @@ StripDataSource_dump_csv    (StripDataSource        the_sds,
   for (i = 0; i < STRIP_MAX_CURVES; i++) if (sds->buffers[i].curve) break;
   if (i >= STRIP_MAX_CURVES) { if(DEBUG1)perror("No one curvers");return 0; }
 
-  StripGraph_getattr (sg, STRIPGRAPH_BEGIN_TIME, &Start, 0);
-  StripGraph_getattr (sg, STRIPGRAPH_END_TIME,   &End,   0);
-
-  memcpy(&StartCopy,&Start,sizeof(struct timeval));
-  memcpy(  &EndCopy,&End,  sizeof(struct timeval));
+  dump_begin (sds, sg, &Start, &End);
 
   if(DEBUG1)printf("Start=%s",ctime(&(Start.tv_sec)));
   if(DEBUG1)printf("End=%s",ctime(&(End.tv_sec)));
 
-  if(!cursor) cursor = XCreateFontCursor(XtDisplay(history_topShell),XC_watch);
-  XDefineCursor(XtDisplay(history_topShell),
-    XtWindow(history_topShell), cursor);
-  XFlush(XtDisplay(history_topShell));
-
-  for (i = 0; i < STRIP_MAX_CURVES; i++) {
-    if (!sds->buffers[i].curve) continue; 
-    cd = &sds->buffers[i];
-    StripHistory_fetch
-      (sds->history, cd->curve->details->name, &StartCopy, &EndCopy,
-	  &cd->history, 0, 0);
-  }
-
   /* this is very straightforward:
    * (a) for every curve, print out its name across the top
    * (b) for every time on the range
@@ -1828,40 +2094,28 @@ StripDataSource_dump_csv    (StripDataSource        the_sds,
   fprintf (outfile, "\n");
   
   /* (b) */
-  timeP=&StartCopy;
-
-  while(findNextTime(timeP,timeP,sds) ==0) 
+  if (sds->grid != STRIP_RESAMPLE_OFF)
   {
-    if(compare_times(timeP,&Start)<0) continue;
-    if(compare_times(timeP,&End)>0) break;
-
-    /* (b-1) */
-    memset(buf,0,SDS_DUMP_FIELDWIDTH+1);
-    strftime(buf, SDS_DUMP_FIELDWIDTH, "%m/%d/%Y,%H:%M:%S",
-	localtime (&(timeP->tv_sec)));
-    fprintf (outfile, "%s.%06d",buf,(int)timeP->tv_usec);
-      
-    /* (b-2) */
-    for (j = 0; j < STRIP_MAX_CURVES; j++)
-	if (sds->buffers[j].curve)
-	{
-	  cd = &sds->buffers[j];
-	  memset(buf,0,SDS_DUMP_FIELDWIDTH+1);
-	  printData(timeP,cd,buf);
-	  fprintf (outfile, ",%s",buf);
-	}
-      
-    /* finally, the end-line */
-    fprintf (outfile, "\n");
-  } /* end of history while() handeling */
+    StripFormat_init (&sf, outfile, "%m/%d/%Y %H:%M:%S");
+    ok = dump_grid (sds, &sf, &Start, &End, ",", "");
+  }
+  else
+  {
+    StripFormat_init (&sf, outfile, "%m/%d/%Y,%H:%M:%S");
+    dump_history (sds, &sf, &Start, &End, ",", "");
+    ok = StripFormat_flush (&sf) && ok;
+    StripFormat_init (&sf, outfile, "%m/%d/%Y %H:%M:%S");
+  }
 
   
   if(DEBUG1)printf("Start=%s",ctime(&(Start.tv_sec)));
   if(DEBUG1)printf("End=%s",ctime(&(End.tv_sec)));
 
-  if (sds->idx_t0 != sds->idx_t1) 
+  if ((sds->grid == STRIP_RESAMPLE_OFF) && (sds->idx_t0 != sds->idx_t1))
   {
-    for (i = sds->idx_t0; i != sds->idx_t1; i = (i+1) % sds->buf_size)
+    for (i = sds->idx_t0;
+         (i != sds->idx_t1) && !sds->cancel;
+         i = (i+1) % sds->buf_size)
     {
 	if(compare_times(&(sds->times[i]),&End)>0) 
 	{if(DEBUG1)printf("T[%d]>End   break\n",i); break;}
@@ -1872,31 +2126,166 @@ StripDataSource_dump_csv    (StripDataSource        the_sds,
 	if(DEBUG1)printf("Good i=%d\n",i);
 	
 	/* (b-1) */
-	memset(buf,0,SDS_DUMP_FIELDWIDTH+1);
-	strftime(buf, SDS_DUMP_FIELDWIDTH, "%m/%d/%Y %H:%M:%S",
-	  localtime (&(sds->times[i].tv_sec)));
-	fprintf (outfile, "%s.%06d",buf,(int)sds->times[i].tv_usec); 
+	StripFormat_time (&sf, &sds->times[i]);
 	/* (b-2) */
 	for (j = 0; j < STRIP_MAX_CURVES; j++)
 	  if (sds->buffers[j].curve)
 	  {
+	    StripFormat_string (&sf, ",");
 	    if (sds->buffers[j].stat[i] & DATASTAT_PLOTABLE)
-		fprintf (outfile, ",%g",sds->buffers[j].val[i]);
-	    else fprintf (outfile, ",%s",SDS_DUMP_BADVALUESTR);
+		StripFormat_double (&sf, sds->buffers[j].val[i]);
+	    else StripFormat_string (&sf, SDS_DUMP_BADVALUESTR);
 	  }
 	
 	/* finally, the end-line */
-	fprintf (outfile, "\n");
+	StripFormat_string (&sf, "\n");
     }
   } else {if(DEBUG1) perror("DUMP:NO CURRENT DATA");}
 
 
   if(DEBUG1)printf("Last i=%d\n",i);
 
+  ok = StripFormat_flush (&sf) && ok;
   fflush (outfile);
-  XUndefineCursor(XtDisplay(history_topShell),
-    XtWindow(history_topShell));
-  return 1;
+  dump_end (sg);
+  return ok && !sds->cancel;
+}
+
+
+/*
+ * StripDataSource_dump_columns
+ *
+ *      The history windows are written to temporary files, one per
+ *      column, since the directory at the start of the file needs the
+ *      sample counts.  The columns are then copied into place.
+ */
+int
+StripDataSource_dump_columns    (StripDataSource        the_sds,
+  FILE                   *outfile,char * cgi)
+{
+  StripDataSourceInfo   *sds = (StripDataSourceInfo *)the_sds;
+  StripGraph            sg = (StripGraph) cgi;
+  StripHistoryResult    parts[STRIP_MAX_CURVES];
+  FILE                  *tmp[STRIP_MAX_CURVES][3];
+  struct timeval        Start, End, h_end, w0, w1;
+  CurveData             *cd;
+  StripHistoryChunk     *c;
+  size_t                local;
+  unsigned char         head[SDS_COLS_ENTRY];
+  long                  h_n[STRIP_MAX_CURVES];
+  long                  r_first, r_last, r_n, first, last, n;
+  double                offset;
+  int                   i, k, more, ok = 1, n_curves = 0;
+
+  for (i = 0; i < STRIP_MAX_CURVES; i++) if (sds->buffers[i].curve) n_curves++;
+  if (n_curves == 0) return 0;
+
+  dump_begin (sds, sg, &Start, &End);
+
+  memset (tmp, 0, sizeof (tmp));
+  for (i = 0; i < STRIP_MAX_CURVES; i++)
+    for (k = 0; (k < 3) && sds->buffers[i].curve; k++)
+      if (!(tmp[i][k] = tmpfile ()))
+      {
+        fprintf (stderr, "StripDataSource_dump_columns: no temporary file\n");
+        ok = 0;
+      }
+
+  /* the ring buffer samples on the range, shared by all curves */
+  r_n = 0;
+  r_first = r_last = -1;
+  if (sds->count > 0)
+  {
+    r_first = find_date_idx
+      (&Start, sds->times, sds->count, sds->buf_size, sds->cur_idx, SDS_GTE);
+    r_last = find_date_idx
+      (&End, sds->times, sds->count, sds->buf_size, sds->cur_idx, SDS_LTE);
+  }
+  if ((r_first >= 0) && (r_last >= 0) &&
+      (compare_times (&sds->times[r_first], &sds->times[r_last]) <= 0))
+    r_n = (r_first <= r_last)?
+      r_last - r_first + 1 : (long)sds->buf_size - r_first + r_last + 1;
+
+  /* history samples up to the first ring buffer sample (at the same
+   * time, the ring buffer sample is the one kept) */
+  h_end = (r_n > 0)? sds->times[r_first] : End;
+  for (i = 0; i < STRIP_MAX_CURVES; i++) h_n[i] = 0;
+
+  memset (parts, 0, sizeof (parts));
+  for (w0 = Start, more = ok; more && ok && !sds->cancel; w0 = w1)
+  {
+    more = dump_window (&w0, &w1, &h_end);
+    dump_progress (sds, &Start, &h_end, &w0);
+    dump_fetch (sds, parts, &w0, &w1);
+
+    for (i = 0; i < STRIP_MAX_CURVES; i++)
+    {
+      if (!sds->buffers[i].curve || (parts[i].fetch_stat != FETCH_DONE))
+        continue;
+
+      /* [w0, w1), but the last window up to h_end only if that is End */
+      first = find_hist_idx (&w0, &parts[i], SDS_GTE);
+      last = find_hist_idx (&w1, &parts[i], SDS_LTE);
+      if (((more || (r_n > 0)) && (last >= 0) &&
+           (c = StripHistoryResult_locate (&parts[i], last, &local)) &&
+           (compare_times (&c->times[local], &w1) == 0)))
+        last--;
+      if ((first < 0) || (last < first)) continue;
+
+      n = last - first + 1;
+      for (k = 0; k < 3; k++)
+        ok = cols_write (tmp[i][k], sds, &parts[i], 0, first, n, 0, 0, k)
+          && ok;
+      h_n[i] += n;
+    }
+
+    dump_release (sds, parts);
+  }
+
+  /* header */
+  memset (head, 0, sizeof (head));
+  memcpy (head, SDS_COLS_MAGIC, 8);
+  cols_put (head + 8, SDS_COLS_VERSION, 4);
+  cols_put (head + 12, n_curves, 4);
+  cols_put (head + 16, Start.tv_sec * 1e6 + Start.tv_usec, 8);
+  cols_put (head + 24, End.tv_sec * 1e6 + End.tv_usec, 8);
+  fwrite (head, 1, SDS_COLS_HEADER, outfile);
+
+  /* directory */
+  offset = SDS_COLS_HEADER + n_curves * SDS_COLS_ENTRY;
+  for (i = 0; i < STRIP_MAX_CURVES; i++)
+  {
+    if (!(cd = &sds->buffers[i])->curve) continue;
+    memset (head, 0, sizeof (head));
+    strncpy ((char *)head, cd->curve->details->name, 64);
+    strncpy ((char *)head + 64, cd->curve->details->egu, 32);
+    cols_put (head + 96, h_n[i] + r_n, 8);
+    cols_put (head + 104, offset, 8);
+    fwrite (head, 1, SDS_COLS_ENTRY, outfile);
+    offset += 16 * (h_n[i] + r_n) + SDS_PAD8 (2 * (h_n[i] + r_n));
+  }
+
+  /* columns: history part, then ring buffer part */
+  for (i = 0; i < STRIP_MAX_CURVES; i++)
+  {
+    if (!(cd = &sds->buffers[i])->curve) continue;
+    for (k = 0; k < 3; k++)
+    {
+      if (tmp[i][k]) ok &= cols_copy (outfile, tmp[i][k]);
+      ok &= cols_write (outfile, sds, 0, cd, 0, 0, r_first, r_n, k);
+    }
+    memset (head, 0, 8);
+    fwrite (head, 1,
+            SDS_PAD8 (2 * (h_n[i] + r_n)) - 2 * (h_n[i] + r_n), outfile);
+  }
+
+  for (i = 0; i < STRIP_MAX_CURVES; i++)
+    for (k = 0; k < 3; k++)
+      if (tmp[i][k]) fclose (tmp[i][k]);
+
+  fflush (outfile);
+  dump_end (sg);
+  return ok && !sds->cancel && !ferror (outfile);
 }
 
 
@@ -1984,32 +2373,364 @@ find_date_idx   (struct timeval         *t,
 }
 
 
-/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
- * change data buffer size routine
- * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/* ring_min_max
+ *
+ *      Widens [*min, *max] to the plotable ring buffer samples on [a, b],
+ *      from the summary if there is one.
+ */
 static int
-resize  (StripDataSourceInfo *sds, size_t buf_size)
+ring_min_max    (StripDataSourceInfo    *sds,
+  CurveData              *cd,
+  int                    a,
+  int                    b,
+  double                 *min,
+  double                 *max)
 {
-  int                   i;
-  int                   new_count = sds->count;
-  int                   ret_val = 0;
-  
-  int                   new_index;
+  int   i, found = 0;
 
-    
-#if DEBUG_SDS_TIMES
-  printf("resize: times=%u buf_size=%u\n",
-    sds->times,buf_size);
-#endif
-  
-  if (sds->buf_size == 0)
+  if (cd->summary)
+    return StripMinMax_range
+      (cd->summary, cd->val, cd->stat, a, b, (int)sds->cur_idx, min, max);
+
+  for (i = a; i <= b; i++)
+    if (cd->stat[i] & DATASTAT_PLOTABLE)
+    {
+      if (cd->val[i] < *min) *min = cd->val[i];
+      if (cd->val[i] > *max) *max = cd->val[i];
+      found = 1;
+    }
+  return found;
+}
+
+
+/* find_hist_idx
+ *
+ *      Like find_date_idx(), but searches the chunk list of a history
+ *      result and returns an index over the whole list.
+ */
+static long
+find_hist_idx   (struct timeval         *t,
+  StripHistoryResult     *result,
+  int                    mode)
+{
+  StripHistoryChunk     *c;
+  long                  i;
+
+  if (mode == SDS_GTE)
   {
-    sds->times = (struct timeval *)malloc
-      (buf_size * sizeof(struct timeval));
-    new_index = new_count = 0;
-    ret_val = (sds->times != NULL);
+    /* first chunk which ends on or after t */
+    for (c = result->first; c; c = c->next)
+      if (compare_times (&c->times[c->n_points-1], t) >= 0)
+      {
+        i = find_date_idx
+          (t, c->times, c->n_points, c->n_points, c->n_points - 1, SDS_GTE);
+        return (i < 0)? -1 : (long)c->offset + i;
+      }
   }
-  else
+  else if (mode == SDS_LTE)
+  {
+    /* last chunk which starts on or before t */
+    for (c = result->last; c; c = c->prev)
+      if (compare_times (&c->times[0], t) <= 0)
+      {
+        i = find_date_idx
+          (t, c->times, c->n_points, c->n_points, c->n_points - 1, SDS_LTE);
+        return (i < 0)? -1 : (long)c->offset + i;
+      }
+  }
+
+  return -1;
+}
+
+
+/* hist_use_chunk
+ *
+ *      Points the segmentify() buffers at the start of the given chunk.
+ */
+static void
+hist_use_chunk  (StripHistoryChunk      *c,
+  TimeBuffer             *times,
+  ValueBuffer            *values,
+  StatusBuffer           *status)
+{
+  times->chunk = c;
+  times->base = times->ptr = c->times;
+  values->base = values->ptr = c->data;
+  status->base = status->ptr = c->status;
+  times->count = values->count = status->count = (size_t)c->n_points;
+}
+
+
+/* hist_seek
+ *
+ *      Points the segmentify() buffers at history sample idx.
+ */
+static void
+hist_seek       (StripHistoryResult     *result,
+  size_t                 idx,
+  TimeBuffer             *times,
+  ValueBuffer            *values,
+  StatusBuffer           *status)
+{
+  StripHistoryChunk     *c;
+  size_t                i;
+
+  if ((c = StripHistoryResult_locate (result, idx, &i)) != NULL)
+  {
+    hist_use_chunk (c, times, values, status);
+    times->ptr += i;
+    values->ptr += i;
+    status->ptr += i;
+  }
+}
+
+
+/* hist_point
+ *
+ *      Copies history sample idx into the data point.
+ */
+static void
+hist_point      (StripHistoryResult     *result,
+  size_t                 idx,
+  DataPoint              *p)
+{
+  StripHistoryChunk     *c;
+  size_t                i;
+
+  if ((c = StripHistoryResult_locate (result, idx, &i)) != NULL)
+  {
+    p->t = c->times[i];
+    p->v = c->data[i];
+    p->s = c->status[i];
+  }
+  else memset (p, 0, sizeof (DataPoint));
+}
+
+
+/* history_callback
+ *
+ *      A progressive history fetch has added data: have the client
+ *      redraw, which will join the new data onto the rendered data.
+ */
+static void
+history_callback        (StripHistoryResult     *BOGUS(result),
+  void                   *data)
+{
+  StripDataSourceInfo   *sds = (StripDataSourceInfo *)data;
+
+  history_notify (sds);
+}
+
+
+/* history_notify
+ *
+ *      Tells the client that history data has arrived.  Once nothing is
+ *      pending any more, and StripDataSource_min_max has been waiting
+ *      for it, the client is asked to rescale instead of just redrawing.
+ *      Fetches started by that rescale don't lead to another one.
+ */
+static void
+history_notify  (StripDataSourceInfo    *sds)
+{
+  CurveData             *cd;
+  int                   i;
+
+  if (sds->rescale_pending && sds->rescale_func)
+  {
+    for (i = 0; i < STRIP_MAX_CURVES; i++)
+    {
+      cd = &sds->buffers[i];
+      if (cd->curve &&
+          ((cd->history.fetch_stat == FETCH_PENDING) ||
+           (cd->extend[0].fetch_stat == FETCH_PENDING) ||
+           (cd->extend[1].fetch_stat == FETCH_PENDING)))
+        break;
+    }
+    if (i == STRIP_MAX_CURVES)
+    {
+      sds->rescale_func (sds->refresh_data);
+      sds->rescale_pending = 0;
+      return;
+    }
+  }
+  if (sds->refresh_func) sds->refresh_func (sds->refresh_data);
+}
+
+
+/* history_extend
+ *
+ *      If the curve's history already covers part of [h0, h1], fetches
+ *      only the missing piece(s) at either end, so that a moving window
+ *      transfers each sample once.  The pieces are fetched like any other
+ *      request, after the settle time, and are spliced into the result
+ *      once they are in.  The history's [t0, t1] is the span it covers,
+ *      also after a fetch which stopped short, so a piece which wasn't
+ *      fetched is asked for again the next time.  Data lying more than a
+ *      window width outside [h0, h1] is released.  Returns 0 if a
+ *      complete fetch is needed instead.
+ */
+static int
+history_extend  (StripDataSourceInfo    *sds,
+  CurveData              *cd,
+  struct timeval         *h0,
+  struct timeval         *h1)
+{
+  StripHistoryResult    *hr = &cd->history;
+  struct timeval        width, lo, hi;
+
+  if (!HISTORY_COVERED (hr) || !hr->first ||
+      (compare_times (&hr->t0, &hr->t1) >= 0) ||
+      (compare_times (&hr->t0, h1) > 0) || (compare_times (&hr->t1, h0) < 0))
+  {
+    extend_release (sds, cd);
+    return 0;
+  }
+
+  /* extend left */
+  if (compare_times (h0, &hr->t0) < 0)
+    extend_fetch (sds, cd, 0, h0, &hr->t0);
+
+  /* extend right */
+  if (compare_times (h1, &hr->t1) > 0)
+    extend_fetch (sds, cd, 1, &hr->t1, h1);
+
+  subtract_times (&width, h0, h1);
+  subtract_times (&lo, &width, h0);
+  add_times (&hi, h1, &width);
+  StripHistoryResult_drop (hr, &lo, &hi);
+
+  return 1;
+}
+
+
+/* extend_fetch
+ *
+ *      Requests the piece [t0, t1] on the given side (0 before the
+ *      history, 1 after it).  A pending piece which covers it already is
+ *      left alone; any other is replaced, so that while the window is
+ *      dragged the requests keep being restarted within the settle time,
+ *      and only the last one is fetched.
+ */
+static void
+extend_fetch    (StripDataSourceInfo    *sds,
+  CurveData              *cd,
+  int                    side,
+  struct timeval         *t0,
+  struct timeval         *t1)
+{
+  StripHistoryResult    *part = &cd->extend[side];
+
+  if ((part->fetch_stat == FETCH_PENDING) &&
+      (compare_times (&part->t0, t0) <= 0) &&
+      (compare_times (&part->t1, t1) >= 0))
+    return;
+
+  StripHistoryResult_release (sds->history, part);
+  if (StripHistory_fetch
+      (sds->history, cd->curve->details->name, t0, t1, part,
+       extend_callback, sds) != FETCH_PENDING)
+    extend_finish (sds, cd, side);
+}
+
+
+/* extend_callback
+ *
+ *      A history extension has delivered data.  It is only spliced in
+ *      once complete, after which the client redraws.
+ */
+static void
+extend_callback (StripHistoryResult     *result,
+  void                   *data)
+{
+  StripDataSourceInfo   *sds = (StripDataSourceInfo *)data;
+  int                   i, side;
+
+  if (result->fetch_stat == FETCH_PENDING) return;
+
+  for (i = 0; i < STRIP_MAX_CURVES; i++)
+    for (side = 0; side < 2; side++)
+      if (result == &sds->buffers[i].extend[side])
+      {
+        extend_finish (sds, &sds->buffers[i], side);
+        history_notify (sds);
+        return;
+      }
+}
+
+
+/* extend_finish
+ *
+ *      Splices a finished extension into the history, if the span it
+ *      covers (all of the piece, or the part next to the history for one
+ *      which stopped short) still adjoins it, and releases it.  The
+ *      history is widened by that span only.
+ */
+static void
+extend_finish   (StripDataSourceInfo    *sds,
+  CurveData              *cd,
+  int                    side)
+{
+  StripHistoryResult    *hr = &cd->history;
+  StripHistoryResult    *part = &cd->extend[side];
+  struct timeval        t0 = part->t0, t1 = part->t1;
+
+  if (HISTORY_COVERED (part) && HISTORY_COVERED (hr) &&
+      (compare_times (&t0, &t1) < 0) &&
+      (side?
+       ((compare_times (&t0, &hr->t1) <= 0) &&
+        (compare_times (&t1, &hr->t1) > 0)) :
+       ((compare_times (&t1, &hr->t0) >= 0) &&
+        (compare_times (&t0, &hr->t0) < 0))))
+  {
+    StripHistoryResult_splice (hr, part);
+    if (side) hr->t1 = t1;
+    else hr->t0 = t0;
+  }
+  StripHistoryResult_release (sds->history, part);
+}
+
+
+/* extend_release
+ *
+ *      Drops the curve's history extensions, pending or not.
+ */
+static void
+extend_release  (StripDataSourceInfo    *sds,
+  CurveData              *cd)
+{
+  StripHistoryResult_release (sds->history, &cd->extend[0]);
+  StripHistoryResult_release (sds->history, &cd->extend[1]);
+  cd->extend[0].fetch_stat = FETCH_IDLE;
+  cd->extend[1].fetch_stat = FETCH_IDLE;
+}
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * change data buffer size routine
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static int
+resize  (StripDataSourceInfo *sds, size_t buf_size)
+{
+  int                   i;
+  int                   new_count = sds->count;
+  int                   ret_val = 0;
+  
+  int                   new_index;
+
+    
+#if DEBUG_SDS_TIMES
+  printf("resize: times=%u buf_size=%u\n",
+    sds->times,buf_size);
+#endif
+  
+  if (sds->buf_size == 0)
+  {
+    sds->times = (struct timeval *)malloc
+      (buf_size * sizeof(struct timeval));
+    new_index = new_count = 0;
+    ret_val = (sds->times != NULL);
+  }
+  else
   {
     ret_val = pack_array
       ((void **)&sds->times, sizeof(struct timeval),
@@ -2037,6 +2758,13 @@ resize  (StripDataSourceInfo *sds, size_t buf_size)
     sds->cur_idx = new_index;
     sds->count = new_count;
   }
+
+  /* the ring buffer summaries are rebuilt when next needed */
+  for (i = 0; i < STRIP_MAX_CURVES; i++)
+  {
+    StripMinMax_delete (sds->buffers[i].summary);
+    sds->buffers[i].summary = 0;
+  }
   return ret_val;
 }
 
@@ -2124,53 +2852,674 @@ verify_render_buffer    (RenderBuffer *rbuf, int n)
 }
 
 
-/* static function for HistoryDump: Albert */
-static int findNextTime (struct timeval *tv,struct timeval *result,StripDataSourceInfo *sds)
+/* dump_history
+ *
+ *      Writes a row for every time on [start, end] at which some curve has
+ *      a history sample: the time, then a field per curve, each preceded
+ *      by pre and followed by post.  A curve without a sample at that
+ *      time shows N/A, or with STRIP_DUMP_JOIN=asof, its latest sample.
+ */
+static void
+dump_history    (StripDataSourceInfo    *sds,
+  StripFormat            *sf,
+  struct timeval         *start,
+  struct timeval         *end,
+  char                   *pre,
+  char                   *post)
 {
-  CurveData *cd;
-  int m,i;
-  int first=1;
+  StripHistoryResult    parts[STRIP_MAX_CURVES];
+  DumpMerge             merge;
+  DumpCursor            *c;
+  struct timeval        w0, w1;
+  char                  *env;
+  int                   j, more;
+
+  memset (&merge, 0, sizeof (merge));
+  env = getenv (STRIP_DUMP_JOIN_ENV);
+  merge.asof = (env && (strcmp (env, "asof") == 0));
+
+  memset (parts, 0, sizeof (parts));
+  for (w0 = *start, more = 1; more && !sds->cancel; w0 = w1)
+  {
+    more = dump_window (&w0, &w1, end);
+    dump_progress (sds, start, end, &w0);
+    dump_fetch (sds, parts, &w0, &w1);
+    dump_merge_init (&merge, parts, &w0);
+
+    /* windows are [w0, w1), except for the last */
+    while (dump_merge_next (&merge, &w1, !more))
+    {
+      StripFormat_time (sf, &merge.t);
+      StripFormat_string (sf, post);
+
+      for (j = 0; j < STRIP_MAX_CURVES; j++)
+      {
+        if (!sds->buffers[j].curve) continue;
+        c = &merge.c[j];
+        StripFormat_string (sf, pre);
+        if (!c->hit && !(merge.asof && c->have))
+          StripFormat_string (sf, "N/A");
+        else if (c->status & DATASTAT_PLOTABLE)
+          StripFormat_double (sf, c->value);
+        else StripFormat_string (sf, SDS_DUMP_BADVALUESTR);
+        StripFormat_string (sf, post);
+      }
+      StripFormat_string (sf, "\n");
+    }
+
+    dump_release (sds, parts);
+  }
+}
+
+
+/* dump_grid
+ *
+ *      Writes the rows of a time grid dump: every curve is resampled
+ *      (StripResample) on a grid of sds->grid_step seconds from start.
+ *      The rows are written as soon as all curves have got that far.  A
+ *      curve whose next sample is more than SDS_GRID_BATCH grid points
+ *      ahead holds its value meanwhile, even with linear interpolation.
+ */
+static int
+dump_grid       (StripDataSourceInfo    *sds,
+  StripFormat            *sf,
+  struct timeval         *start,
+  struct timeval         *end,
+  char                   *pre,
+  char                   *post)
+{
+  StripHistoryResult    parts[STRIP_MAX_CURVES];
+  StripResample         rs[STRIP_MAX_CURVES];
+  GridSource            src[STRIP_MAX_CURVES];
+  StripResample         *grid = 0;
+  struct timeval        w0, w1, t;
+  double                *val;
+  char                  *flag;
+  size_t                local;
+  long                  idx, kb = 0, kw, k_total, kmin, limit, k;
+  int                   j, more, all, done[STRIP_MAX_CURVES];
+
+  if (sds->grid_step <= 0) return 0;
+
+  val = (double *)malloc
+    (STRIP_MAX_CURVES * SDS_GRID_BATCH * sizeof (double));
+  flag = (char *)malloc (STRIP_MAX_CURVES * SDS_GRID_BATCH);
+  if (!val || !flag)
+  {
+    fprintf (stderr, "StripDataSource_dump: can't allocate memory\n");
+    if (val) free (val);
+    if (flag) free (flag);
+    return 0;
+  }
+
+  memset (src, 0, sizeof (src));
+  for (j = 0; j < STRIP_MAX_CURVES; j++)
+    if (sds->buffers[j].curve)
+    {
+      StripResample_init (&rs[j], sds->grid, start, sds->grid_step);
+      grid = &rs[j];
+    }
+  k_total = StripResample_count (grid, end);
+
+  memset (parts, 0, sizeof (parts));
+  for (w0 = *start, more = 1; more && !sds->cancel; w0 = w1)
+  {
+    more = dump_window (&w0, &w1, end);
+    dump_progress (sds, start, end, &w0);
+    dump_fetch (sds, parts, &w0, &w1);
+    kw = more? StripResample_before (grid, &w1) : k_total;
+
+    /* history from the window start, or from the sample before it for
+     * the first window */
+    for (j = 0; j < STRIP_MAX_CURVES; j++)
+    {
+      src[j].chunk = 0;
+      if (!sds->buffers[j].curve || (parts[j].n_points < 1) ||
+          (parts[j].fetch_stat != FETCH_DONE))
+        continue;
+      idx = find_hist_idx (&w0, &parts[j], SDS_GTE);
+      if (idx < 0) idx = parts[j].n_points;
+      if ((idx > 0) && (compare_times (&w0, start) == 0)) idx--;
+      if ((src[j].chunk = StripHistoryResult_locate
+           (&parts[j], idx, &local)))
+        src[j].i = local;
+    }
+
+    for (kmin = -1; !sds->cancel; )
+    {
+      /* go as far as the batch, the window, and the samples allow */
+      limit = kb + SDS_GRID_BATCH;
+      all = 1;
+      for (j = 0; j < STRIP_MAX_CURVES; j++)
+      {
+        if (!sds->buffers[j].curve) continue;
+        done[j] = grid_feed
+          (sds, j, &src[j], &rs[j], &w1, !more, limit,
+           val + j * SDS_GRID_BATCH, flag + j * SDS_GRID_BATCH);
+        all = all && done[j];
+        if (done[j] && (!more || (sds->grid == STRIP_RESAMPLE_HOLD)))
+          StripResample_hold
+            (&rs[j], kb, min (kw, limit),
+             val + j * SDS_GRID_BATCH, flag + j * SDS_GRID_BATCH);
+      }
+
+      for (k = limit, j = 0; j < STRIP_MAX_CURVES; j++)
+        if (sds->buffers[j].curve && (rs[j].k < k)) k = rs[j].k;
+
+      /* a curve waiting for its next sample holds up the others */
+      if ((k == kb) && !all)
+        for (k = limit, j = 0; j < STRIP_MAX_CURVES; j++)
+        {
+          if (!sds->buffers[j].curve) continue;
+          if (done[j])
+            StripResample_hold
+              (&rs[j], kb, min (kw, limit),
+               val + j * SDS_GRID_BATCH, flag + j * SDS_GRID_BATCH);
+          if (rs[j].k < k) k = rs[j].k;
+        }
 
+      if (k == kmin) break;
+      kmin = k;
+
+      for (k = kb; (k < kmin) && !sds->cancel; k++)
+      {
+        StripResample_time (grid, k, &t);
+        StripFormat_time (sf, &t);
+        StripFormat_string (sf, post);
+        for (j = 0; j < STRIP_MAX_CURVES; j++)
+        {
+          if (!sds->buffers[j].curve) continue;
+          StripFormat_string (sf, pre);
+          switch (flag[j * SDS_GRID_BATCH + (k - kb)])
+          {
+            case STRIP_RESAMPLE_OK:
+              StripFormat_double (sf, val[j * SDS_GRID_BATCH + (k - kb)]);
+              break;
+            case STRIP_RESAMPLE_BAD:
+              StripFormat_string (sf, SDS_DUMP_BADVALUESTR);
+              break;
+            default:
+              StripFormat_string (sf, "N/A");
+          }
+          StripFormat_string (sf, post);
+        }
+        StripFormat_string (sf, "\n");
+      }
+
+      for (j = 0; j < STRIP_MAX_CURVES; j++)
+        if (sds->buffers[j].curve && (rs[j].k > kmin))
+        {
+          memmove (val + j * SDS_GRID_BATCH,
+                   val + j * SDS_GRID_BATCH + (kmin - kb),
+                   (rs[j].k - kmin) * sizeof (double));
+          memmove (flag + j * SDS_GRID_BATCH,
+                   flag + j * SDS_GRID_BATCH + (kmin - kb),
+                   rs[j].k - kmin);
+        }
+      kb = kmin;
+    }
+
+    dump_release (sds, parts);
+  }
+
+  free (val);
+  free (flag);
+  return 1;
+}
+
+
+/* grid_feed
+ *
+ *      Feeds curve j's samples before w1 (or at w1, if inclusive) to its
+ *      resampler, up to the grid point limit.  Returns 1 if it has got
+ *      through them.
+ */
+static int
+grid_feed       (StripDataSourceInfo    *sds,
+  int                    j,
+  GridSource             *src,
+  StripResample          *rs,
+  struct timeval         *w1,
+  int                    inclusive,
+  long                   limit,
+  double                 *val,
+  char                   *flag)
+{
+  CurveData             *cd = &sds->buffers[j];
+  StripHistoryChunk     *c;
+  struct timeval        *ring_t0 = 0;
+  size_t                ring_n = 0, idx;
+  long                  n, used;
+  int                   x;
+
+  /* idx_t0 == idx_t1 is a single sample, or none at all if the range
+   * holds no ring buffer data */
+  if ((sds->count > 0) &&
+      ((sds->idx_t0 != sds->idx_t1) ||
+       ((compare_times (&sds->times[sds->idx_t0], &sds->req_t0) >= 0) &&
+        (compare_times (&sds->times[sds->idx_t0], &sds->req_t1) <= 0))))
+  {
+    ring_n = (sds->idx_t1 + sds->buf_size - sds->idx_t0) % sds->buf_size + 1;
+    ring_t0 = &sds->times[sds->idx_t0];
+  }
+
+  /* history, before the ring buffer data */
+  while ((c = src->chunk))
+  {
+    for (n = 0; src->i + n < c->n_points; n++)
+    {
+      x = compare_times (&c->times[src->i + n], w1);
+      if ((x > 0) || ((x == 0) && !inclusive)) break;
+      if (ring_t0 && (compare_times (&c->times[src->i + n], ring_t0) >= 0))
+        break;
+    }
+    used = StripResample_feed
+      (rs, c->times + src->i, c->data + src->i, c->status + src->i, n,
+       limit - SDS_GRID_BATCH, limit, val, flag);
+    src->i += used;
+    if (used < n) return 0;
+    if (src->i < c->n_points)
+    {
+      src->chunk = 0;
+      break;
+    }
+    do c = c->next;
+    while (c && (c->n_points == 0));
+    src->chunk = c;
+    src->i = 0;
+  }
+
+  /* the ring buffer, in runs up to its wrap */
+  while (src->r < ring_n)
+  {
+    idx = (sds->idx_t0 + src->r) % sds->buf_size;
+    for (n = 0; (src->r + n < ring_n) && (idx + n < sds->buf_size); n++)
+    {
+      x = compare_times (&sds->times[idx + n], w1);
+      if ((x > 0) || ((x == 0) && !inclusive)) break;
+    }
+    if (n == 0) break;
+    used = StripResample_feed
+      (rs, sds->times + idx, cd->val + idx, cd->stat + idx, n,
+       limit - SDS_GRID_BATCH, limit, val, flag);
+    src->r += used;
+    if (used < n) return 0;
+  }
+
+  return 1;
+}
+
+
+/* dump_begin
+ *
+ *      Gets the range to dump: the graph's or, without a graph, the
+ *      snapshot's.  Only with a graph is this the Xt thread, which may
+ *      show the watch cursor.
+ */
+static void
+dump_begin      (StripDataSourceInfo    *sds,
+  StripGraph             sg,
+  struct timeval         *start,
+  struct timeval         *end)
+{
+  sds->progress = 0;
+
+  if (!sg)
+  {
+    *start = sds->req_t0;
+    *end = sds->req_t1;
+    return;
+  }
+
+  StripGraph_getattr (sg, STRIPGRAPH_BEGIN_TIME, start, 0);
+  StripGraph_getattr (sg, STRIPGRAPH_END_TIME,   end,   0);
+
+  if(!cursor) cursor = XCreateFontCursor(XtDisplay(history_topShell),XC_watch);
+  XDefineCursor(XtDisplay(history_topShell),
+    XtWindow(history_topShell), cursor);
+  XFlush(XtDisplay(history_topShell));
+}
+
+
+static void
+dump_end        (StripGraph sg)
+{
+  if (!sg) return;
+  XUndefineCursor(XtDisplay(history_topShell),
+    XtWindow(history_topShell));
+}
+
+
+/* dump_progress
+ *
+ *      The dump has got as far as t on [start, end].
+ */
+static void
+dump_progress   (StripDataSourceInfo    *sds,
+  struct timeval         *start,
+  struct timeval         *end,
+  struct timeval         *t)
+{
+  double        span = time2dbl (end) - time2dbl (start);
+
+  if (span > 0) sds->progress = (time2dbl (t) - time2dbl (start)) / span;
+}
+
+
+/* dump_window
+ *
+ *      Sets w1 to the end of the window starting at w0, and returns 0 if
+ *      that is the last window before end.
+ */
+static int
+dump_window     (struct timeval         *w0,
+  struct timeval         *w1,
+  struct timeval         *end)
+{
+  static double         width = -1;
+  char                  *env;
+
+  if (width < 0)
+  {
+    width = STRIP_DUMP_WINDOW;
+    if ((env = getenv (STRIP_DUMP_WINDOW_ENV)) && (atof (env) > 0))
+      width = atof (env);
+  }
+
+  dbl2time (w1, time2dbl (w0) + width);
+  if (compare_times (w1, end) < 0) return 1;
+  *w1 = *end;
+  return 0;
+}
+
+
+/* dump_fetch
+ *
+ *      Fetches [w0, w1] for every curve into parts, which are released
+ *      again by dump_release().  The curves' own history results, which
+ *      are what the graph shows, are not touched.
+ */
+static void
+dump_fetch      (StripDataSourceInfo    *sds,
+  StripHistoryResult     *parts,
+  struct timeval         *w0,
+  struct timeval         *w1)
+{
+  int   i;
+
+  for (i = 0; i < STRIP_MAX_CURVES; i++)
+    if (sds->buffers[i].curve)
+      StripHistory_fetch
+        (sds->history, sds->buffers[i].curve->details->name, w0, w1,
+         &parts[i], 0, 0);
+}
+
+
+static void
+dump_release    (StripDataSourceInfo    *sds,
+  StripHistoryResult     *parts)
+{
+  int   i;
+
+  for (i = 0; i < STRIP_MAX_CURVES; i++)
+  {
+    StripHistoryResult_release (sds->history, &parts[i]);
+    memset (&parts[i], 0, sizeof (parts[i]));
+  }
+}
+
+
+/* dump_merge_init
+ *
+ *      Sets up a cursor at the first sample at or after start for each
+ *      curve with complete history data.  For as-of joins, a sample
+ *      before start is the curve's latest value.
+ */
+static void
+dump_merge_init (DumpMerge              *merge,
+  StripHistoryResult     *parts,
+  struct timeval         *start)
+{
+  DumpCursor            *c;
+  size_t                local;
+  long                  idx;
+  int                   m, k;
+
+  merge->n = 0;
   for (m = 0; m < STRIP_MAX_CURVES; m++)
   {
-    if (sds->buffers[m].curve == NULL) continue;
-    cd = &sds->buffers[m];
-    if(cd->history.n_points<1) continue;
-    if(cd->history.fetch_stat!=FETCH_DONE){perror("FETCH_DONE!"); continue;}
+    c = &merge->c[m];
+    c->chunk = 0;
+    if ((parts[m].n_points < 1) || (parts[m].fetch_stat != FETCH_DONE))
+      continue;
+
+    idx = find_hist_idx (start, &parts[m], SDS_GTE);
+    if (idx < 0) idx = parts[m].n_points;
 
-    for(i=0;i<cd->history.n_points;i++) 
+    if (idx > 0)
     {
-	if( compare_times(&(cd->history.times[i]),tv) >0) {
-	  if (first) {
-	    first=0;
-	    result->tv_sec= (cd->history.times[i]).tv_sec;
-	    result->tv_usec=(cd->history.times[i]).tv_usec;
-	    continue;
-	  }
-	  if(compare_times(&(cd->history.times[i]),result)<0) { 
-	    result->tv_sec= (cd->history.times[i]).tv_sec;
-	    result->tv_usec=(cd->history.times[i]).tv_usec;
-	  }
-	}
+      c->chunk = StripHistoryResult_locate (&parts[m], idx - 1, &local);
+      c->value = c->chunk->data[local];
+      c->status = c->chunk->status[local];
+      c->have = 1;
+    }
+
+    if (!(c->chunk = StripHistoryResult_locate (&parts[m], idx, &local)))
+      continue;
+    c->i = (int)local;
+
+    /* sift up */
+    for (k = merge->n++;
+         (k > 0) &&
+           (compare_times
+            (&c->chunk->times[c->i],
+             &merge->c[merge->heap[(k-1)/2]].chunk->times
+             [merge->c[merge->heap[(k-1)/2]].i]) < 0);
+         k = (k-1)/2)
+      merge->heap[k] = merge->heap[(k-1)/2];
+    merge->heap[k] = m;
+  }
+}
+
+
+/* dump_merge_next
+ *
+ *      Moves on to the next row, if there is one before end (or at end,
+ *      if inclusive): takes the samples of all curves at the earliest
+ *      time left.
+ */
+static int
+dump_merge_next (DumpMerge              *merge,
+  struct timeval         *end,
+  int                    inclusive)
+{
+  DumpCursor            *c;
+  int                   m, x;
+
+  for (m = 0; m < STRIP_MAX_CURVES; m++) merge->c[m].hit = 0;
+
+  if (merge->n == 0) return 0;
+  c = &merge->c[merge->heap[0]];
+  merge->t = c->chunk->times[c->i];
+  x = compare_times (&merge->t, end);
+  if ((x > 0) || ((x == 0) && !inclusive)) return 0;
+
+  while ((merge->n > 0) &&
+         (c = &merge->c[merge->heap[0]],
+          compare_times (&c->chunk->times[c->i], &merge->t) == 0))
+  {
+    c->value = c->chunk->data[c->i];
+    c->status = c->chunk->status[c->i];
+    c->have = 1;
+    c->hit = 1;
+
+    if (++c->i >= c->chunk->n_points)
+    {
+      do c->chunk = c->chunk->next;
+      while (c->chunk && (c->chunk->n_points == 0));
+      c->i = 0;
     }
+    if (!c->chunk) merge->heap[0] = merge->heap[--merge->n];
+    dump_sift_down (merge, 0);
   }
 
-  return(first);
+  return 1;
 }
 
-static int printData(struct timeval *time, CurveData *cd, char *val)
+
+static void
+dump_sift_down  (DumpMerge *merge, int k)
 {
-  int i;
-  short first=1;
-  for(i=0;i<cd->history.n_points;i++) 
+  DumpCursor            *a, *b;
+  int                   m = merge->heap[k];
+  int                   child;
+
+  while ((child = 2*k + 1) < merge->n)
+  {
+    a = &merge->c[merge->heap[child]];
+    if (child + 1 < merge->n)
+    {
+      b = &merge->c[merge->heap[child+1]];
+      if (compare_times (&b->chunk->times[b->i], &a->chunk->times[a->i]) < 0)
+      {
+        child++;
+        a = b;
+      }
+    }
+    b = &merge->c[m];
+    if (compare_times (&a->chunk->times[a->i], &b->chunk->times[b->i]) >= 0)
+      break;
+    merge->heap[k] = merge->heap[child];
+    k = child;
+  }
+  merge->heap[k] = m;
+}
+
+/* cols_put
+ *
+ *      Stores a non-negative integral value as an n-byte little-endian
+ *      integer, exactly as long as it is below 2^53.
+ */
+static void
+cols_put        (unsigned char *b, double v, int n)
+{
+  int   i;
+
+  for (i = 0; i < n; i++)
+  {
+    b[i] = (unsigned char)fmod (v, 256.0);
+    v = floor (v / 256.0);
+  }
+}
+
+
+/* cols_write
+ *
+ *      Writes a column (0: times, 1: values, 2: status) of a curve's
+ *      export: h_n samples of hr from index h_first on, then r_n of the
+ *      curve's ring buffer samples from r_first on.  Values and status are
+ *      written straight from the sample arrays on little-endian hosts.
+ *      Returns false if fewer samples were written than asked for, since
+ *      the directory has counted them already.
+ */
+static int
+cols_write      (FILE                   *f,
+  StripDataSourceInfo    *sds,
+  StripHistoryResult     *hr,
+  CurveData              *cd,
+  long                   h_first,
+  long                   h_n,
+  long                   r_first,
+  long                   r_n,
+  int                    column)
+{
+  static int            one = 1;
+  static unsigned char  block[8 * SDS_COLS_BLOCK];
+  StripHistoryChunk     *c = 0;
+  struct timeval        *times;
+  double                *data;
+  StatusType            *status;
+  size_t                local = 0;
+  unsigned char         x;
+  long                  n, k, j;
+  int                   b, width = (column == 2)? 2 : 8;
+
+  if (h_n > 0) c = StripHistoryResult_locate (hr, h_first, &local);
+
+  /* runs of contiguous samples: history chunks, then the ring buffer
+   * up to and after its wrap */
+  while ((h_n > 0) || (r_n > 0))
   {
-    if(!compare_times(&(cd->history.times[i]),time)) {
-	first=0;
-	sprintf(val,"%g",cd->history.data[i]);
+    if (h_n > 0)
+    {
+      if (!c) return 0;
+      n = c->n_points - (long)local;
+      if (n > h_n) n = h_n;
+      times = c->times + local;
+      data = c->data + local;
+      status = c->status + local;
+      h_n -= n;
+      c = c->next;
+      local = 0;
+    }
+    else
+    {
+      n = (long)sds->buf_size - r_first;
+      if (n > r_n) n = r_n;
+      times = sds->times + r_first;
+      data = cd->val + r_first;
+      status = cd->stat + r_first;
+      r_n -= n;
+      r_first = 0;
+    }
+
+    if (*(char *)&one && (column > 0))
+    {
+      if (column == 1) j = (long)fwrite (data, 8, n, f);
+      else j = (long)fwrite (status, 2, n, f);
+      if (j != n) return 0;
+      continue;
+    }
+
+    for (k = 0; k < n; k += SDS_COLS_BLOCK)
+    {
+      for (j = 0; (j < SDS_COLS_BLOCK) && (k + j < n); j++)
+      {
+        if (column == 0)
+          cols_put (block + 8*j,
+                    times[k+j].tv_sec * 1e6 + times[k+j].tv_usec, 8);
+        else if (column == 1)
+        {
+          memcpy (block + 8*j, &data[k+j], 8);
+          for (b = 0; b < 4; b++)
+          {
+            x = block[8*j + b];
+            block[8*j + b] = block[8*j + 7 - b];
+            block[8*j + 7 - b] = x;
+          }
+        }
+        else cols_put (block + 2*j, (unsigned short)status[k+j], 2);
+      }
+      if (fwrite (block, width, j, f) != (size_t)j) return 0;
     }
   }
-  if(first) sprintf(val,"%s","N/A");
-  return(first);    
+  return 1;
+}
+
+/* cols_copy
+ *
+ *      Appends the contents of the temporary file to f.
+ */
+static int
+cols_copy       (FILE *f, FILE *tmp)
+{
+  static char   block[8 * SDS_COLS_BLOCK];
+  size_t        n;
+
+  rewind (tmp);
+  while ((n = fread (block, 1, sizeof (block), tmp)) > 0)
+    if (fwrite (block, 1, n, f) != n) return 0;
+  return !ferror (tmp);
 }
 
 /* **************************** Emacs Editing Sequences ***************** */
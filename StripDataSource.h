@@ -14,6 +14,9 @@
 
 #include "StripCurve.h"
 #include "StripHistory.h"
+#include "StripMinMax.h"
+#include "StripRecord.h"
+#include "StripResample.h"
 
 
 /* ======= Data Types ======= */
@@ -42,6 +45,7 @@ typedef struct          _CurveData
   size_t                first;  /* index of first live data point */
   double                *val;
   StatusType            *stat;
+  StripMinMax           summary;        /* of val, built on demand */
 
   /* === rendered data info === */
   Boolean               connectable;    /* can new data be connected to old? */
@@ -50,7 +54,11 @@ typedef struct          _CurveData
 
   /* === history buffer === */
   StripHistoryResult    history;
+  StripHistoryResult    extend[2];      /* pending pieces before, after it */
   size_t                hidx_t0, hidx_t1;
+
+  /* every update is delivered through StripDataSource_ingest() */
+  Boolean               ingested;
 } CurveData;
 
 typedef struct          _StripDataSourceInfo
@@ -69,6 +77,25 @@ typedef struct          _StripDataSourceInfo
   struct timeval        req_t0, req_t1;
   double                bin_size;
   int                   n_bins;
+
+  /* called when a pending history fetch has delivered more data */
+  void                  (*refresh_func) (void *);
+  void                  *refresh_data;
+
+  /* called instead, once the fetches of StripDataSource_min_max are in */
+  void                  (*rescale_func) (void *);
+  int                   rescale_pending;
+
+  /* dumps of a snapshot, which may run in a thread of their own */
+  int                   snapshot;       /* owns its times and curves */
+  volatile double       progress;       /* of the dump, 0 to 1 */
+  volatile int          cancel;         /* stops the dump */
+  StripResampleMethod   grid;           /* rows on a time grid, or off */
+  double                grid_step;      /* seconds */
+
+  /* gets every sample, or 0 */
+  StripRecord           record;
+  int                   ingesting;      /* StripDataSource_ingested flushes */
 }
 StripDataSourceInfo;
 
@@ -108,6 +135,14 @@ typedef enum
 {
   SDS_NUMSAMPLES = 1,   /* (size_t)     number of samples to keep       rw */
   SDS_BEGIN_TIME = 2,   /* (struct timeval *) */
+  SDS_REFRESH_FUNC = 3, /* (void (*)(void *)) history update notification rw */
+  SDS_REFRESH_DATA = 4, /* (void *)     client data for the above      rw */
+  SDS_DUMP_PROGRESS = 5,/* (double)     fraction of the dump written    r */
+  SDS_DUMP_CANCEL = 6,  /* (int)        stop the dump if set            rw */
+  SDS_RECORD = 7,       /* (StripRecord) continuous recording, or 0     rw */
+  SDS_DUMP_GRID = 8,    /* (int)        StripResampleMethod of the dump rw */
+  SDS_DUMP_GRID_STEP = 9,/* (double)    grid step (seconds)             rw */
+  SDS_RESCALE_FUNC = 10,/* (void (*)(void *)) autoscale history arrived rw */
   SDS_LAST_ATTRIBUTE
 } SDSAttribute;
 
@@ -165,6 +200,32 @@ int     StripDataSource_removecurve     (StripDataSource, StripCurve);
 void    StripDataSource_sample  (StripDataSource, char *); /* Albert */
 
 
+/*
+ * StripDataSource_ingest
+ *
+ *      Takes n updates of the curve, as they arrived from its data
+ *      source, between samples.  They go to the recording, which then
+ *      leaves the curve out of the sampled rows.
+ */
+void    StripDataSource_ingest  (StripDataSource,
+                                 StripCurve,
+                                 struct timeval *,      /* received */
+                                 struct timeval *,      /* stamps */
+                                 double *,              /* values */
+                                 StatusType *,          /* status */
+                                 int);                  /* n */
+
+
+/*
+ * StripDataSource_ingested
+ *
+ *      Tells that all updates received before the given time have been
+ *      passed on, so that the recording can write out the rows up to
+ *      then.  Once this is called, samples wait for it as well.
+ */
+void    StripDataSource_ingested        (StripDataSource, struct timeval *);
+
+
 /*
  * StripDataSource_init_range
  *
@@ -218,6 +279,20 @@ size_t  StripDataSource_render  (StripDataSource,
                                  XSegment **);          /* result */
 
 #endif /* Albert */
+/*
+ * StripDataSource_snapshot
+ *
+ *      Returns a new data source holding copies of the curves and of the
+ *      ring buffer samples on [begin, end], sharing only the history
+ *      service with the original, or 0 if there is no memory.  It can be
+ *      dumped (with no graph: the range is [begin, end]) from another
+ *      thread while sampling goes on.  Delete it with
+ *      StripDataSource_delete().
+ */
+StripDataSource StripDataSource_snapshot        (StripDataSource,
+                                                 struct timeval *,
+                                                 struct timeval *);
+
 /*
  * StripDataSource_dump
  *
@@ -234,6 +309,26 @@ int     StripDataSource_dump            (StripDataSource, FILE *,char *sgi);/* A
  */
 int     StripDataSource_dump_csv        (StripDataSource, FILE *,char *sgi);
 
+/*
+ * StripDataSource_dump_columns
+ *
+ *      Dumps the data for the current range as a binary column file,
+ *      which can be memory-mapped and used without parsing.  All integers
+ *      are little-endian, and all offsets are from the start of the file.
+ *
+ *        header (64 bytes)    "STRIPCOL", uint32 version (1),
+ *                             uint32 number of curves, int64 begin and
+ *                             end of the range (microseconds since 1970)
+ *        directory            128 bytes per curve: name (64 bytes) and
+ *                             units (32 bytes), NUL padded, uint64 number
+ *                             of samples n, uint64 offset of the columns
+ *        columns              per curve, at its offset: int64 times
+ *                             (microseconds since 1970) [n], float64
+ *                             values [n], int16 status [n] (bit 0 set:
+ *                             plotable), padded to a multiple of 8 bytes
+ */
+int     StripDataSource_dump_columns    (StripDataSource, FILE *,char *sgi);
+
 int   Strip_auto_scale     (Strip the_strip);  /* Albert */
 
 int   StripDataSource_removecurveAll(StripDataSource the_sds);
@@ -74,6 +74,24 @@
 #define STRIP_CA_PEND_TIMEOUT           0.1 /* Albert 0.001 */
 #endif
 
+/* "yes": Channel Access runs in threads of its own, and every monitor
+ * update is queued (up to STRIP_CA_RING_SIZE, a power of two, per curve)
+ * until the Xt thread picks it up */
+#define STRIP_CA_PREEMPTIVE_ENV         "STRIP_CA_PREEMPTIVE"
+#define STRIP_CA_RING_SIZE              4096
+
+/* snapshots queued per array curve (a power of two); each holds the
+ * PV's native element count */
+#define STRIP_CA_SNAPSHOTS              4
+
+/* seconds before searching again for an unconnected channel: starts at
+ * the minimum and doubles after each search */
+#define STRIP_CA_RETRY_MIN              1.0
+#define STRIP_CA_RETRY_MAX              64.0
+
+/* seconds to search for a curve's .DESC field before giving up */
+#define STRIP_CA_DESC_TIMEOUT           10.0
+
 /* timeout period for handling cdev events */
 #define STRIP_CDEV_PEND_TIMEOUT         0.005
 
@@ -132,5 +150,71 @@
 
 #define STRIP_DUMP_TYPE_DEFAULT_ENV         "STRIP_DUMP_TYPE_DEFAULT"
 
+/* "asof": dumps fill a curve's field with its latest value rather than
+ * N/A when it has no sample at a row's time */
+#define STRIP_DUMP_JOIN_ENV                 "STRIP_DUMP_JOIN"
+
+/* dumps fetch and write history a window of this many seconds at a time */
+#define STRIP_DUMP_WINDOW_ENV               "STRIP_DUMP_WINDOW"
+#define STRIP_DUMP_WINDOW                   3600.0
+
+/* level of compressed dumps: 1 (fast) .. 9 for gzip, up to 19 for zstd */
+#define STRIP_DUMP_COMPRESS_LEVEL_ENV       "STRIP_DUMP_COMPRESS_LEVEL"
+#define STRIP_DUMP_COMPRESS_LEVEL           3
+
+/* continuous recording of the samples (StripRecord) */
+#define STRIP_RECORD_DIR_ENV                "STRIP_RECORD_DIR"
+#define STRIP_RECORD_FILE_SIZE_ENV          "STRIP_RECORD_FILE_SIZE"
+#define STRIP_RECORD_FILE_SIZE              64          /* Mbytes */
+#define STRIP_RECORD_FILE_TIME_ENV          "STRIP_RECORD_FILE_TIME"
+#define STRIP_RECORD_FILE_TIME              86400       /* seconds */
+#define STRIP_RECORD_SYNC_ENV               "STRIP_RECORD_SYNC"
+#define STRIP_RECORD_SYNC                   10.0        /* seconds */
+
+/* file of record descriptions kept across sessions (StripDescCache),
+ * and the age in seconds after which they are fetched again */
+#define STRIP_DESC_CACHE_ENV                "STRIP_DESC_CACHE"
+#define STRIP_DESC_CACHE_AGE_ENV            "STRIP_DESC_CACHE_AGE"
+#define STRIP_DESC_CACHE_AGE                604800
+
+/* on-disk archive cache (StripHistoryCache) */
+#define STRIP_HISTORY_CACHE_DIR_ENV         "STRIP_HISTORY_CACHE_DIR"
+#define STRIP_HISTORY_CACHE_SIZE_ENV        "STRIP_HISTORY_CACHE_SIZE"
+#define STRIP_HISTORY_CACHE_SIZE            256         /* Mbytes */
+#define STRIP_HISTORY_CACHE_PARTITION       3600        /* seconds per file */
+#define STRIP_HISTORY_CACHE_SETTLE          600         /* seconds */
+
+/* archive readers reduce a range to min/max of about this many bins
+ * (0: raw data) */
+#define STRIP_HISTORY_BINS_ENV              "STRIP_HISTORY_BINS"
+#define STRIP_HISTORY_BINS                  0
+
+/* progressive history fetches start with 1/STRIP_HISTORY_SLICES of the range */
+#define STRIP_HISTORY_SLICES                64
+
+/* seconds a history request waits for being superseded before it is sent */
+#define STRIP_HISTORY_SETTLE_ENV            "STRIP_HISTORY_SETTLE"
+#define STRIP_HISTORY_SETTLE                0.2
+
+/* time limit (seconds) for a history request */
+#define STRIP_HISTORY_TIMEOUT_ENV           "STRIP_HISTORY_TIMEOUT"
+#define STRIP_HISTORY_TIMEOUT               30.0
+#define STRIP_HISTORY_FOREVER               1e30
+
+/* Archiver Appliance (StripHistoryAA) */
+#define STRIP_HISTORY_AA_URL_ENV            "STRIP_HISTORY_AA_URL"
+#define STRIP_HISTORY_AA_OPERATOR_ENV       "STRIP_HISTORY_AA_OPERATOR"
+#define STRIP_HISTORY_AA_OPERATOR           "mean"
+
+/* synthetic archive (StripHistoryTEST) */
+#define STRIP_HISTORY_TEST_PERIOD_ENV       "STRIP_HISTORY_TEST_PERIOD"
+#define STRIP_HISTORY_TEST_MAX_POINTS_ENV   "STRIP_HISTORY_TEST_MAX_POINTS"
+#define STRIP_HISTORY_TEST_LATENCY_ENV      "STRIP_HISTORY_TEST_LATENCY"
+#define STRIP_HISTORY_TEST_JITTER_ENV       "STRIP_HISTORY_TEST_JITTER"
+#define STRIP_HISTORY_TEST_FAILURE_ENV      "STRIP_HISTORY_TEST_FAILURE"
+#define STRIP_HISTORY_TEST_GAP_PERIOD_ENV   "STRIP_HISTORY_TEST_GAP_PERIOD"
+#define STRIP_HISTORY_TEST_GAP_LENGTH_ENV   "STRIP_HISTORY_TEST_GAP_LENGTH"
+#define STRIP_HISTORY_TEST_SEED_ENV         "STRIP_HISTORY_TEST_SEED"
+
 #endif /* #ifndef _StripDefines */
 
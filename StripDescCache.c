@@ -0,0 +1,351 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Sessions share the file under a lock, taken around each load, append
+ * and rewrite, so that they never see each other's partial entries.
+ * When it has grown to more than twice its live entries, the file is
+ * rewritten at start-up, and renamed over the old one while that is
+ * still locked.  A session which then gets the lock finds that the name
+ * refers to another file, and reopens it.
+ */
+
+#include "StripDescCache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#ifndef WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#define SDC_BUCKETS     256
+#define SDC_LINE_MAX    (32 + STRIP_MAX_NAME_CHAR + STRIP_MAX_COMMENT_CHAR)
+#define SDC_PATH_MAX    1024
+
+typedef struct _SdcEntry
+{
+  struct _SdcEntry      *next;
+  long                  stamp;          /* seconds past 1970 */
+  char                  *desc;
+  char                  name[1];        /* allocated to fit */
+}
+SdcEntry;
+
+typedef struct _StripDescCacheInfo
+{
+  char                  path[SDC_PATH_MAX];
+  FILE                  *f;             /* read and appended to */
+  long                  max_age;
+  SdcEntry              *buckets[SDC_BUCKETS];
+  long                  n_entries;
+}
+StripDescCacheInfo;
+
+static SdcEntry **sdc_find      (StripDescCacheInfo *, char *);
+static int      sdc_set         (StripDescCacheInfo *, char *, char *, long);
+static int      sdc_lock        (StripDescCacheInfo *);
+static void     sdc_unlock      (StripDescCacheInfo *);
+static void     sdc_load        (StripDescCacheInfo *);
+static int      sdc_rewrite     (StripDescCacheInfo *);
+static void     sdc_clean       (char *);
+
+
+/* StripDescCache_init
+ */
+StripDescCache  StripDescCache_init     (void)
+{
+  StripDescCacheInfo    *sdc;
+  char                  *env;
+
+  if (!(env = getenv (STRIP_DESC_CACHE_ENV)) || !*env)
+    return 0;
+
+  if (!(sdc = (StripDescCacheInfo *)calloc
+        (1, sizeof (StripDescCacheInfo))))
+  {
+    fprintf (stderr, "StripDescCache_init: can't allocate memory\n");
+    return 0;
+  }
+
+  strncpy (sdc->path, env, SDC_PATH_MAX - 1);
+  sdc->max_age = STRIP_DESC_CACHE_AGE;
+  if ((env = getenv (STRIP_DESC_CACHE_AGE_ENV)) && (atol (env) > 0))
+    sdc->max_age = atol (env);
+
+  if (!sdc_lock (sdc))
+  {
+    fprintf (stderr, "StripDescCache_init: can't open %s: %s\n",
+             sdc->path, strerror (errno));
+    StripDescCache_delete ((StripDescCache)sdc);
+    return 0;
+  }
+  sdc_load (sdc);
+  sdc_unlock (sdc);
+
+  return (StripDescCache)sdc;
+}
+
+
+/* StripDescCache_delete
+ */
+void            StripDescCache_delete   (StripDescCache the_sdc)
+{
+  StripDescCacheInfo    *sdc = (StripDescCacheInfo *)the_sdc;
+  SdcEntry              *e, *next;
+  int                   i;
+
+  if (!sdc) return;
+  if (sdc->f) fclose (sdc->f);
+  for (i = 0; i < SDC_BUCKETS; i++)
+    for (e = sdc->buckets[i]; e; e = next)
+    {
+      next = e->next;
+      free (e->desc);
+      free (e);
+    }
+  free (sdc);
+}
+
+
+/* StripDescCache_get
+ */
+char            *StripDescCache_get     (StripDescCache the_sdc, char *name)
+{
+  StripDescCacheInfo    *sdc = (StripDescCacheInfo *)the_sdc;
+  SdcEntry              *e;
+
+  if (!sdc || !(e = *sdc_find (sdc, name))) return 0;
+  if ((long)time (0) - e->stamp > sdc->max_age) return 0;
+  return e->desc;
+}
+
+
+/* StripDescCache_put
+ */
+void            StripDescCache_put      (StripDescCache         the_sdc,
+                                         char                   *name,
+                                         char                   *desc)
+{
+  StripDescCacheInfo    *sdc = (StripDescCacheInfo *)the_sdc;
+  char                  buf[STRIP_MAX_COMMENT_CHAR+1];
+  long                  now = (long)time (0);
+
+  if (!sdc || !*name || strchr (name, ' ') ||
+      (strlen (name) > STRIP_MAX_NAME_CHAR))
+    return;
+
+  strncpy (buf, desc, STRIP_MAX_COMMENT_CHAR);
+  buf[STRIP_MAX_COMMENT_CHAR] = 0;
+  sdc_clean (buf);
+  if (!sdc_set (sdc, name, buf, now) || !sdc_lock (sdc)) return;
+
+  fseek (sdc->f, 0, SEEK_END);
+  fprintf (sdc->f, "%ld %s %s\n", now, name, buf);
+  sdc_unlock (sdc);
+}
+
+
+/* sdc_find
+ *
+ *      The link which points, or would point, to the name's entry.
+ */
+static SdcEntry **sdc_find      (StripDescCacheInfo *sdc, char *name)
+{
+  SdcEntry              **p;
+  unsigned              h = 0;
+  char                  *s;
+
+  for (s = name; *s; s++) h = h * 31 + (unsigned char)*s;
+  for (p = &sdc->buckets[h % SDC_BUCKETS]; *p; p = &(*p)->next)
+    if (strcmp ((*p)->name, name) == 0) break;
+  return p;
+}
+
+
+/* sdc_set
+ *
+ *      Adds or replaces the name's entry.  Returns false if out of memory.
+ */
+static int      sdc_set         (StripDescCacheInfo     *sdc,
+                                 char                   *name,
+                                 char                   *desc,
+                                 long                   stamp)
+{
+  SdcEntry              **p = sdc_find (sdc, name), *e = *p;
+  char                  *d;
+
+  if (!(d = (char *)malloc (strlen (desc) + 1))) return 0;
+  strcpy (d, desc);
+
+  if (!e)
+  {
+    if (!(e = (SdcEntry *)malloc (sizeof (SdcEntry) + strlen (name))))
+    {
+      free (d);
+      return 0;
+    }
+    strcpy (e->name, name);
+    e->next = 0;
+    e->desc = 0;
+    *p = e;
+    sdc->n_entries++;
+  }
+  if (e->desc) free (e->desc);
+  e->desc = d;
+  e->stamp = stamp;
+  return 1;
+}
+
+
+/* sdc_lock
+ *
+ *      Opens the file if need be and locks it, reopening it for as long
+ *      as the name refers to another file than the one locked.  Returns
+ *      false if it can't be opened.
+ */
+static int      sdc_lock        (StripDescCacheInfo *sdc)
+{
+#ifndef WIN32
+  struct flock          fl;
+  struct stat           locked, named;
+#endif
+
+  for (;;)
+  {
+    if (!sdc->f && !(sdc->f = fopen (sdc->path, "a+"))) return 0;
+#ifndef WIN32
+    memset (&fl, 0, sizeof (fl));
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    while ((fcntl (fileno (sdc->f), F_SETLKW, &fl) != 0) && (errno == EINTR));
+    if ((fstat (fileno (sdc->f), &locked) == 0) &&
+        (stat (sdc->path, &named) == 0) &&
+        (locked.st_dev == named.st_dev) && (locked.st_ino == named.st_ino))
+      return 1;
+
+    /* rewritten meanwhile: closing the file drops the lock */
+    fclose (sdc->f);
+    sdc->f = 0;
+#else
+    return 1;
+#endif
+  }
+}
+
+
+/* sdc_unlock
+ */
+static void     sdc_unlock      (StripDescCacheInfo *sdc)
+{
+#ifndef WIN32
+  struct flock          fl;
+#endif
+
+  if (!sdc->f) return;
+  fflush (sdc->f);
+#ifndef WIN32
+  memset (&fl, 0, sizeof (fl));
+  fl.l_type = F_UNLCK;
+  fl.l_whence = SEEK_SET;
+  fcntl (fileno (sdc->f), F_SETLK, &fl);
+#endif
+}
+
+
+/* sdc_load
+ *
+ *      Reads the locked file, and rewrites it if it has grown too big.
+ */
+static void     sdc_load        (StripDescCacheInfo *sdc)
+{
+  char                  line[SDC_LINE_MAX], *name, *desc, *end;
+  long                  stamp, n_lines = 0;
+  int                   c;
+
+  rewind (sdc->f);
+  while (fgets (line, sizeof (line), sdc->f))
+  {
+    n_lines++;
+    if ((end = strchr (line, '\n'))) *end = 0;
+    else if (!feof (sdc->f))
+    {
+      /* too long to be one of ours: skip the rest of it */
+      while (((c = getc (sdc->f)) != EOF) && (c != '\n'));
+      continue;
+    }
+    stamp = strtol (line, &name, 10);
+    if ((name == line) || (*name++ != ' ')) continue;
+    if (!(desc = strchr (name, ' '))) continue;
+    *desc++ = 0;
+    if (strlen (desc) > STRIP_MAX_COMMENT_CHAR)
+      desc[STRIP_MAX_COMMENT_CHAR] = 0;
+    if (*name && (strlen (name) <= STRIP_MAX_NAME_CHAR))
+      sdc_set (sdc, name, desc, stamp);
+  }
+
+  if ((n_lines > 2 * sdc->n_entries + SDC_BUCKETS) && sdc_rewrite (sdc))
+  {
+    /* others waiting for the old file will find it replaced */
+    fclose (sdc->f);
+    sdc->f = 0;
+  }
+}
+
+
+/* sdc_rewrite
+ *
+ *      Replaces the file by one holding just the live entries.  Returns
+ *      true if it did.
+ */
+static int      sdc_rewrite     (StripDescCacheInfo *sdc)
+{
+  FILE                  *f;
+  SdcEntry              *e;
+  char                  tmp[SDC_PATH_MAX + 16];
+  int                   i, ok;
+
+  sprintf (tmp, "%s.%ld", sdc->path, (long)time (0));
+  if (!(f = fopen (tmp, "w"))) return 0;
+  for (i = 0; i < SDC_BUCKETS; i++)
+    for (e = sdc->buckets[i]; e; e = e->next)
+      fprintf (f, "%ld %s %s\n", e->stamp, e->name, e->desc);
+  ok = (fclose (f) == 0);
+  if (!ok || (rename (tmp, sdc->path) != 0))
+  {
+    remove (tmp);
+    return 0;
+  }
+  return 1;
+}
+
+
+/* sdc_clean
+ *
+ *      Keeps the description on one line.
+ */
+static void     sdc_clean       (char *s)
+{
+  for (; *s; s++)
+    if ((*s == '\n') || (*s == '\r')) *s = ' ';
+}
+
+/* **************************** Emacs Editing Sequences ***************** */
+/* Local Variables: */
+/* tab-width: 6 */
+/* c-basic-offset: 2 */
+/* c-comment-only-line-offset: 0 */
+/* c-indent-comments-syntactically-p: t */
+/* c-label-minimum-indentation: 1 */
+/* End: */
@@ -0,0 +1,53 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#ifndef _StripDescCache
+#define _StripDescCache
+
+#include "StripDefines.h"
+
+/* StripDescCache
+ *
+ *      Record descriptions (.DESC fields) remembered across sessions,
+ *      in the text file named by STRIP_DESC_CACHE, one "time name
+ *      description" line per entry.  New entries are appended, and the
+ *      latest line for a name wins.  Entries older than
+ *      STRIP_DESC_CACHE_AGE seconds are not returned, so that they are
+ *      fetched again.
+ */
+typedef void *  StripDescCache;
+
+
+/* StripDescCache_init
+ *
+ *      Loads the cache file, returning 0 if STRIP_DESC_CACHE is not set
+ *      or the file can't be opened.
+ */
+StripDescCache  StripDescCache_init     (void);
+void            StripDescCache_delete   (StripDescCache);
+
+
+/* StripDescCache_get
+ *
+ *      The cached description for the name, or 0.
+ */
+char            *StripDescCache_get     (StripDescCache, char *);
+
+
+/* StripDescCache_put
+ *
+ *      Remembers the description of the name, in memory and on disk.
+ */
+void            StripDescCache_put      (StripDescCache,
+                                         char *,        /* name */
+                                         char *);       /* description */
+
+#endif  /* _StripDescCache */
@@ -0,0 +1,238 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* The export thread only works on its snapshot and on the history
+ * service, which serializes its backend calls.  History popups are
+ * deferred while it runs, and shown from the Xt thread when it is done.
+ * The Xt thread polls for progress and completion from a timeout.
+ */
+
+#include "StripExport.h"
+#include "StripMisc.h"
+
+#include <errno.h>
+#include <Xm/Xm.h>
+#include <Xm/MessageB.h>
+
+/* getArchiveRecord() uses Channel Access, which is bound to the Xt thread */
+#if !defined(WIN32) && !defined(USE_ARCHIVE_RECORD)
+#define STRIP_EXPORT_THREAD
+#include <pthread.h>
+#endif
+
+/* seconds between progress updates */
+#define EXPORT_POLL     0.25
+
+typedef struct _StripExportInfo
+{
+  Strip                 strip;
+  Widget                parent;
+  Widget                dialog;
+  StripDataSource       snap;
+  FILE                  *f;
+  StripCompress         compress;
+  char                  fname[STRIP_PATH_MAX+1];
+  StripExportFunc       func;
+  int                   ret_val;
+  volatile int          done;
+#ifdef STRIP_EXPORT_THREAD
+  pthread_t             thread;
+#endif
+}
+StripExportInfo;
+
+static StripExportInfo  *active = 0;
+static Widget           message_box = 0;
+
+static void     *export_thread  (void *);
+static void     export_poll     (XtPointer, XtIntervalId *);
+static void     export_cancel   (Widget, XtPointer, XtPointer);
+static void     export_finish   (StripExportInfo *);
+static void     export_message  (StripExportInfo *, char *);
+
+
+/* StripExport_start
+ */
+int     StripExport_start       (Strip                  strip,
+                                 Widget                 parent,
+                                 StripDataSource        snap,
+                                 char                   *fname,
+                                 char                   *mode,
+                                 StripCompressType      compress,
+                                 StripExportFunc        func)
+{
+  StripExportInfo       *ei;
+  XmString              xstr;
+
+  if (active)
+  {
+    MessageBox_popup
+      (parent, &message_box, XmDIALOG_ERROR, "File I/O", "OK",
+       "An export is still running.\nname: %s", active->fname);
+    StripDataSource_delete (snap);
+    return 0;
+  }
+
+  if (!(ei = (StripExportInfo *)calloc (1, sizeof (StripExportInfo))))
+  {
+    fprintf (stderr, "StripExport_start: can't allocate memory\n");
+    StripDataSource_delete (snap);
+    return 0;
+  }
+
+  if (!(ei->f = StripCompress_open (fname, mode, compress, &ei->compress)))
+  {
+    MessageBox_popup
+      (parent, &message_box, XmDIALOG_ERROR, "File I/O", "OK",
+       "Unable to open file for writing.\nname: %s\nerror: %s",
+       fname, strerror (errno));
+    StripDataSource_delete (snap);
+    free (ei);
+    return 0;
+  }
+
+  ei->strip = strip;
+  ei->parent = parent;
+  ei->snap = snap;
+  strncpy (ei->fname, fname, STRIP_PATH_MAX);
+  ei->func = func;
+
+  ei->dialog = XmCreateWorkingDialog (parent, "exportDialog", NULL, 0);
+  xstr = XmStringCreateLocalized ("Export");
+  XtVaSetValues
+    (ei->dialog,
+     XmNdialogTitle,            xstr,
+     XmNautoUnmanage,           False,
+     XmNdeleteResponse,         XmDO_NOTHING,
+     NULL);
+  XmStringFree (xstr);
+  XtUnmanageChild (XmMessageBoxGetChild (ei->dialog, XmDIALOG_OK_BUTTON));
+  XtUnmanageChild (XmMessageBoxGetChild (ei->dialog, XmDIALOG_HELP_BUTTON));
+  XtAddCallback (ei->dialog, XmNcancelCallback, export_cancel, ei);
+  export_message (ei, 0);
+  XtManageChild (ei->dialog);
+
+  active = ei;
+  History_MessageBox_defer (1);
+
+#ifdef STRIP_EXPORT_THREAD
+  if (pthread_create (&ei->thread, NULL, export_thread, ei) == 0)
+  {
+    Strip_addtimeout (strip, EXPORT_POLL, export_poll, (XtPointer)ei);
+    return 1;
+  }
+  fprintf (stderr, "StripExport_start: no thread, exporting in place\n");
+#endif
+
+  export_thread (ei);
+  export_finish (ei);
+  return 1;
+}
+
+
+static void     *export_thread  (void *arg)
+{
+  StripExportInfo       *ei = (StripExportInfo *)arg;
+
+  ei->ret_val = ei->func (ei->snap, ei->f, ei->fname);
+  ei->done = 1;
+  return NULL;
+}
+
+
+/* export_poll
+ *
+ *      Shows the progress, or cleans up once the thread is done.
+ */
+static void     export_poll     (XtPointer arg, XtIntervalId *BOGUS(id))
+{
+  StripExportInfo       *ei = (StripExportInfo *)arg;
+
+  if (!ei->done)
+  {
+    export_message (ei, 0);
+    Strip_addtimeout (ei->strip, EXPORT_POLL, export_poll, arg);
+    return;
+  }
+
+#ifdef STRIP_EXPORT_THREAD
+  pthread_join (ei->thread, NULL);
+#endif
+  export_finish (ei);
+}
+
+
+static void     export_cancel   (Widget         BOGUS(w),
+                                 XtPointer      data,
+                                 XtPointer      BOGUS(call))
+{
+  StripExportInfo       *ei = (StripExportInfo *)data;
+
+  StripDataSource_setattr (ei->snap, SDS_DUMP_CANCEL, 1, 0);
+  export_message (ei, "Cancelling");
+}
+
+
+static void     export_finish   (StripExportInfo *ei)
+{
+  int   cancelled = 0;
+
+  StripDataSource_getattr (ei->snap, SDS_DUMP_CANCEL, &cancelled, 0);
+  if (!StripCompress_close (ei->compress, ei->f)) ei->ret_val = 0;
+
+  XtDestroyWidget (ei->dialog);
+  History_MessageBox_defer (0);
+
+  /* a partly written file is of no use */
+  if (cancelled || !ei->ret_val) remove (ei->fname);
+  if (!cancelled && !ei->ret_val)
+    MessageBox_popup
+      (ei->parent, &message_box, XmDIALOG_ERROR, "File I/O", "OK",
+       "Unable to dump data\nname: %s", ei->fname);
+
+  StripDataSource_delete (ei->snap);
+  active = 0;
+  free (ei);
+}
+
+
+/* export_message
+ *
+ *      Shows the state, or if none is given, the progress.
+ */
+static void     export_message  (StripExportInfo *ei, char *state)
+{
+  char          buf[STRIP_PATH_MAX+64];
+  XmString      xstr;
+  double        progress = 0;
+  int           cancelled = 0;
+
+  StripDataSource_getattr
+    (ei->snap, SDS_DUMP_PROGRESS, &progress, SDS_DUMP_CANCEL, &cancelled, 0);
+  if (!state && cancelled) state = "Cancelling";
+
+  if (state) sprintf (buf, "Writing %.*s\n%s...", STRIP_PATH_MAX, ei->fname, state);
+  else sprintf (buf, "Writing %.*s\n%d%% done", STRIP_PATH_MAX, ei->fname,
+                (int)(100 * progress));
+
+  xstr = XmStringCreateLtoR (buf, XmFONTLIST_DEFAULT_TAG);
+  XtVaSetValues (ei->dialog, XmNmessageString, xstr, NULL);
+  XmStringFree (xstr);
+}
+
+/* **************************** Emacs Editing Sequences ***************** */
+/* Local Variables: */
+/* tab-width: 6 */
+/* c-basic-offset: 2 */
+/* c-comment-only-line-offset: 0 */
+/* c-indent-comments-syntactically-p: t */
+/* c-label-minimum-indentation: 1 */
+/* End: */
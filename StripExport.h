@@ -0,0 +1,53 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#ifndef _StripExport
+#define _StripExport
+
+#include "Strip.h"
+#include "StripDataSource.h"
+#include "StripCompress.h"
+
+/* StripExportFunc
+ *
+ *      Writes the snapshot to the open file, whose name is also given,
+ *      returning true on success.  It runs in the export thread, so it
+ *      must not use Xt or Motif.
+ */
+typedef int     (*StripExportFunc)      (StripDataSource,
+                                         FILE *,
+                                         char *);       /* file name */
+
+
+/* StripExport_start
+ *
+ *      Opens the file with the given fopen() mode and compression
+ *      method, and has the function write the snapshot to it in a
+ *      thread of its own, while a working
+ *      dialog shows the progress and lets the user cancel.  The Xt
+ *      thread goes on sampling meanwhile.  When the export is over, the
+ *      file is closed (and removed if the export was cancelled), and
+ *      errors are reported.
+ *
+ *      The export takes over the snapshot.  Only one export runs at a
+ *      time: returns false if another is still running or the file
+ *      can't be opened.  Without threads, the export is done before
+ *      returning.
+ */
+int     StripExport_start       (Strip,
+                                 Widget,                /* dialog parent */
+                                 StripDataSource,       /* snapshot */
+                                 char *,                /* file name */
+                                 char *,                /* fopen mode */
+                                 StripCompressType,
+                                 StripExportFunc);
+
+#endif  /* _StripExport */
@@ -0,0 +1,505 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Numbers are converted with Grisu2 (F. Loitsch, "Printing floating-point
+ * numbers quickly and accurately with integers", PLDI 2010): the value
+ * and its rounding boundaries are scaled by a cached power of ten into
+ * 64 bit fixed point, and digits are generated until they pin the value
+ * down between the boundaries.  The digits always read back as the same
+ * double, and are the shortest such digits in all but a few cases (where
+ * there is one digit more).
+ */
+
+#include "StripFormat.h"
+
+#include <string.h>
+
+#ifdef _MSC_VER
+typedef unsigned __int64        fmt_u64;
+#else
+typedef unsigned long long      fmt_u64;
+#endif
+
+#define FMT_U64(hi, lo)         (((fmt_u64)(hi) << 32) | (fmt_u64)(lo))
+#define FMT_HIDDEN_BIT          FMT_U64 (0x00100000, 0)
+#define FMT_SIGNIFICAND         FMT_U64 (0x000fffff, 0xffffffff)
+#define FMT_EXPONENT_BIAS       (0x3ff + 52)
+
+/* fixed point number f * 2^e */
+typedef struct _FmtFp
+{
+  fmt_u64       f;
+  int           e;
+}
+FmtFp;
+
+/* 10^k ~ f * 2^e, for k = -348, -340, ..., 340 */
+static fmt_u64  cached_f[] =
+{
+  FMT_U64 (0xfa8fd5a0, 0x081c0288),
+  FMT_U64 (0xbaaee17f, 0xa23ebf76),
+  FMT_U64 (0x8b16fb20, 0x3055ac76),
+  FMT_U64 (0xcf42894a, 0x5dce35ea),
+  FMT_U64 (0x9a6bb0aa, 0x55653b2d),
+  FMT_U64 (0xe61acf03, 0x3d1a45df),
+  FMT_U64 (0xab70fe17, 0xc79ac6ca),
+  FMT_U64 (0xff77b1fc, 0xbebcdc4f),
+  FMT_U64 (0xbe5691ef, 0x416bd60c),
+  FMT_U64 (0x8dd01fad, 0x907ffc3c),
+  FMT_U64 (0xd3515c28, 0x31559a83),
+  FMT_U64 (0x9d71ac8f, 0xada6c9b5),
+  FMT_U64 (0xea9c2277, 0x23ee8bcb),
+  FMT_U64 (0xaecc4991, 0x4078536d),
+  FMT_U64 (0x823c1279, 0x5db6ce57),
+  FMT_U64 (0xc2109436, 0x4dfb5637),
+  FMT_U64 (0x9096ea6f, 0x3848984f),
+  FMT_U64 (0xd77485cb, 0x25823ac7),
+  FMT_U64 (0xa086cfcd, 0x97bf97f4),
+  FMT_U64 (0xef340a98, 0x172aace5),
+  FMT_U64 (0xb23867fb, 0x2a35b28e),
+  FMT_U64 (0x84c8d4df, 0xd2c63f3b),
+  FMT_U64 (0xc5dd4427, 0x1ad3cdba),
+  FMT_U64 (0x936b9fce, 0xbb25c996),
+  FMT_U64 (0xdbac6c24, 0x7d62a584),
+  FMT_U64 (0xa3ab6658, 0x0d5fdaf6),
+  FMT_U64 (0xf3e2f893, 0xdec3f126),
+  FMT_U64 (0xb5b5ada8, 0xaaff80b8),
+  FMT_U64 (0x87625f05, 0x6c7c4a8b),
+  FMT_U64 (0xc9bcff60, 0x34c13053),
+  FMT_U64 (0x964e858c, 0x91ba2655),
+  FMT_U64 (0xdff97724, 0x70297ebd),
+  FMT_U64 (0xa6dfbd9f, 0xb8e5b88f),
+  FMT_U64 (0xf8a95fcf, 0x88747d94),
+  FMT_U64 (0xb9447093, 0x8fa89bcf),
+  FMT_U64 (0x8a08f0f8, 0xbf0f156b),
+  FMT_U64 (0xcdb02555, 0x653131b6),
+  FMT_U64 (0x993fe2c6, 0xd07b7fac),
+  FMT_U64 (0xe45c10c4, 0x2a2b3b06),
+  FMT_U64 (0xaa242499, 0x697392d3),
+  FMT_U64 (0xfd87b5f2, 0x8300ca0e),
+  FMT_U64 (0xbce50864, 0x92111aeb),
+  FMT_U64 (0x8cbccc09, 0x6f5088cc),
+  FMT_U64 (0xd1b71758, 0xe219652c),
+  FMT_U64 (0x9c400000, 0x00000000),
+  FMT_U64 (0xe8d4a510, 0x00000000),
+  FMT_U64 (0xad78ebc5, 0xac620000),
+  FMT_U64 (0x813f3978, 0xf8940984),
+  FMT_U64 (0xc097ce7b, 0xc90715b3),
+  FMT_U64 (0x8f7e32ce, 0x7bea5c70),
+  FMT_U64 (0xd5d238a4, 0xabe98068),
+  FMT_U64 (0x9f4f2726, 0x179a2245),
+  FMT_U64 (0xed63a231, 0xd4c4fb27),
+  FMT_U64 (0xb0de6538, 0x8cc8ada8),
+  FMT_U64 (0x83c7088e, 0x1aab65db),
+  FMT_U64 (0xc45d1df9, 0x42711d9a),
+  FMT_U64 (0x924d692c, 0xa61be758),
+  FMT_U64 (0xda01ee64, 0x1a708dea),
+  FMT_U64 (0xa26da399, 0x9aef774a),
+  FMT_U64 (0xf209787b, 0xb47d6b85),
+  FMT_U64 (0xb454e4a1, 0x79dd1877),
+  FMT_U64 (0x865b8692, 0x5b9bc5c2),
+  FMT_U64 (0xc83553c5, 0xc8965d3d),
+  FMT_U64 (0x952ab45c, 0xfa97a0b3),
+  FMT_U64 (0xde469fbd, 0x99a05fe3),
+  FMT_U64 (0xa59bc234, 0xdb398c25),
+  FMT_U64 (0xf6c69a72, 0xa3989f5c),
+  FMT_U64 (0xb7dcbf53, 0x54e9bece),
+  FMT_U64 (0x88fcf317, 0xf22241e2),
+  FMT_U64 (0xcc20ce9b, 0xd35c78a5),
+  FMT_U64 (0x98165af3, 0x7b2153df),
+  FMT_U64 (0xe2a0b5dc, 0x971f303a),
+  FMT_U64 (0xa8d9d153, 0x5ce3b396),
+  FMT_U64 (0xfb9b7cd9, 0xa4a7443c),
+  FMT_U64 (0xbb764c4c, 0xa7a44410),
+  FMT_U64 (0x8bab8eef, 0xb6409c1a),
+  FMT_U64 (0xd01fef10, 0xa657842c),
+  FMT_U64 (0x9b10a4e5, 0xe9913129),
+  FMT_U64 (0xe7109bfb, 0xa19c0c9d),
+  FMT_U64 (0xac2820d9, 0x623bf429),
+  FMT_U64 (0x80444b5e, 0x7aa7cf85),
+  FMT_U64 (0xbf21e440, 0x03acdd2d),
+  FMT_U64 (0x8e679c2f, 0x5e44ff8f),
+  FMT_U64 (0xd433179d, 0x9c8cb841),
+  FMT_U64 (0x9e19db92, 0xb4e31ba9),
+  FMT_U64 (0xeb96bf6e, 0xbadf77d9),
+  FMT_U64 (0xaf87023b, 0x9bf0ee6b)
+};
+
+static short    cached_e[] =
+{
+  -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+  -954, -927, -901, -874, -847, -821, -794, -768, -741, -715, -688, -661,
+  -635, -608, -582, -555, -529, -502, -475, -449, -422, -396, -369, -343,
+  -316, -289, -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3,
+  30, 56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348, 375, 402,
+  428, 455, 481, 508, 534, 561, 588, 614, 641, 667, 694, 720, 747, 774,
+  800, 827, 853, 880, 907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static unsigned long    pow10_tab[] =
+{
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static void     format_room     (StripFormat *, int);
+static void     format_grisu    (double, char *, int *, int *);
+static FmtFp    format_multiply (FmtFp, FmtFp);
+static void     format_digit_gen        (FmtFp, FmtFp, fmt_u64,
+                                         char *, int *, int *);
+static void     format_round    (char *, int, fmt_u64, fmt_u64,
+                                 fmt_u64, fmt_u64);
+static int      format_digits   (unsigned long, int, char *);
+
+
+/* StripFormat_init
+ */
+void    StripFormat_init        (StripFormat *sf, FILE *f, char *time_format)
+{
+  sf->f = f;
+  sf->time_format = time_format;
+  sf->secs = 0;
+  sf->time_len = -1;
+  sf->n = 0;
+  sf->error = 0;
+}
+
+
+/* StripFormat_time
+ */
+void    StripFormat_time        (StripFormat *sf, struct timeval *t)
+{
+  struct tm     tm;
+  time_t        secs = t->tv_sec;
+  char          *p;
+
+  if ((sf->time_len < 0) || (secs != sf->secs))
+  {
+#ifdef WIN32
+    tm = *localtime (&secs);
+#else
+    localtime_r (&secs, &tm);
+#endif
+    sf->time_len = (int)strftime
+      (sf->time_buf, STRIP_FORMAT_TIMEWIDTH, sf->time_format, &tm);
+    sf->secs = secs;
+  }
+
+  format_room (sf, sf->time_len + 8);
+  p = sf->buf + sf->n;
+  memcpy (p, sf->time_buf, sf->time_len);
+  p += sf->time_len;
+  *p++ = '.';
+  format_digits ((unsigned long)t->tv_usec, 6, p);
+  sf->n += sf->time_len + 7;
+}
+
+
+/* StripFormat_double
+ */
+void    StripFormat_double      (StripFormat *sf, double v)
+{
+  format_room (sf, 32);
+  sf->n += StripFormat_dtoa (v, sf->buf + sf->n);
+}
+
+
+/* StripFormat_string
+ */
+void    StripFormat_string      (StripFormat *sf, char *s)
+{
+  int   len = (int)strlen (s);
+
+  if (len > STRIP_FORMAT_BUFSIZE)
+  {
+    StripFormat_flush (sf);
+    if (fwrite (s, 1, len, sf->f) != (size_t)len) sf->error = 1;
+    return;
+  }
+  format_room (sf, len);
+  memcpy (sf->buf + sf->n, s, len);
+  sf->n += len;
+}
+
+
+/* StripFormat_flush
+ */
+int     StripFormat_flush       (StripFormat *sf)
+{
+  if ((sf->n > 0) && (fwrite (sf->buf, 1, sf->n, sf->f) != (size_t)sf->n))
+    sf->error = 1;
+  sf->n = 0;
+  return !sf->error;
+}
+
+
+/* StripFormat_dtoa
+ */
+int     StripFormat_dtoa        (double v, char *s)
+{
+  char          digits[24];
+  fmt_u64       bits;
+  int           n, k, point, exp, len = 0;
+
+  memcpy (&bits, &v, sizeof (bits));
+  if ((bits & FMT_U64 (0x7ff00000, 0)) == FMT_U64 (0x7ff00000, 0))
+    return sprintf (s, (v != v)? "nan" : (v < 0)? "-inf" : "inf");
+
+  if (bits & FMT_U64 (0x80000000, 0))
+  {
+    s[len++] = '-';
+    v = -v;
+  }
+  if (v == 0)
+  {
+    s[len++] = '0';
+    s[len] = 0;
+    return len;
+  }
+
+  format_grisu (v, digits, &n, &k);
+  point = n + k;                        /* digits before the point */
+
+  if ((point > -5) && (point <= 17))
+  {
+    if (point <= 0)
+    {
+      s[len++] = '0';
+      s[len++] = '.';
+      for (; point < 0; point++) s[len++] = '0';
+      memcpy (s + len, digits, n);
+      len += n;
+    }
+    else if (point >= n)
+    {
+      memcpy (s + len, digits, n);
+      len += n;
+      for (; n < point; n++) s[len++] = '0';
+    }
+    else
+    {
+      memcpy (s + len, digits, point);
+      len += point;
+      s[len++] = '.';
+      memcpy (s + len, digits + point, n - point);
+      len += n - point;
+    }
+  }
+  else
+  {
+    s[len++] = digits[0];
+    if (n > 1)
+    {
+      s[len++] = '.';
+      memcpy (s + len, digits + 1, n - 1);
+      len += n - 1;
+    }
+    exp = point - 1;
+    s[len++] = 'e';
+    s[len++] = (exp < 0)? '-' : '+';
+    len += format_digits ((unsigned long)((exp < 0)? -exp : exp), 2, s + len);
+  }
+
+  s[len] = 0;
+  return len;
+}
+
+
+/* format_room
+ *
+ *      Makes room for len more bytes in the buffer.
+ */
+static void     format_room     (StripFormat *sf, int len)
+{
+  if (sf->n + len > STRIP_FORMAT_BUFSIZE) StripFormat_flush (sf);
+}
+
+
+/* format_grisu
+ *
+ *      Writes the n digits of positive, finite v = digits * 10^k.
+ */
+static void     format_grisu    (double v, char *digits, int *n, int *k)
+{
+  FmtFp         w, w_m, w_p, c;
+  fmt_u64       bits;
+  double        dk;
+  int           i, e;
+
+  /* v = w.f * 2^w.e, and its boundaries */
+  memcpy (&bits, &v, sizeof (bits));
+  e = (int)((bits >> 52) & 0x7ff);
+  w.f = bits & FMT_SIGNIFICAND;
+  if (e)
+  {
+    w.f += FMT_HIDDEN_BIT;
+    w.e = e - FMT_EXPONENT_BIAS;
+  }
+  else w.e = 1 - FMT_EXPONENT_BIAS;
+
+  w_p.f = (w.f << 1) + 1;
+  w_p.e = w.e - 1;
+  while (!(w_p.f & (FMT_HIDDEN_BIT << 1))) w_p.f <<= 1, w_p.e--;
+  w_p.f <<= 10;
+  w_p.e -= 10;
+  if (w.f == FMT_HIDDEN_BIT)
+  {
+    w_m.f = (w.f << 2) - 1;
+    w_m.e = w.e - 2;
+  }
+  else
+  {
+    w_m.f = (w.f << 1) - 1;
+    w_m.e = w.e - 1;
+  }
+  w_m.f <<= w_m.e - w_p.e;
+  w_m.e = w_p.e;
+
+  while (!(w.f & FMT_U64 (0x80000000, 0))) w.f <<= 1, w.e--;
+
+  /* scale by the cached power which brings w_p.e to about -60 */
+  dk = (-61 - w_p.e) * 0.30102999566398114 + 347;
+  i = (int)dk;
+  if (dk - i > 0) i++;
+  i = (i >> 3) + 1;
+  *k = -(-348 + i * 8);
+  c.f = cached_f[i];
+  c.e = cached_e[i];
+
+  w = format_multiply (w, c);
+  w_p = format_multiply (w_p, c);
+  w_m = format_multiply (w_m, c);
+  w_m.f++;
+  w_p.f--;
+
+  format_digit_gen (w, w_p, w_p.f - w_m.f, digits, n, k);
+}
+
+
+/* format_multiply
+ *
+ *      Rounded upper 64 bits of the product.
+ */
+static FmtFp    format_multiply (FmtFp x, FmtFp y)
+{
+  fmt_u64       m32 = FMT_U64 (0, 0xffffffff);
+  fmt_u64       a = x.f >> 32, b = x.f & m32;
+  fmt_u64       c = y.f >> 32, d = y.f & m32;
+  fmt_u64       ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+  fmt_u64       tmp;
+  FmtFp         r;
+
+  tmp = (bd >> 32) + (ad & m32) + (bc & m32);
+  tmp += FMT_U64 (0, 0x80000000);
+  r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+  r.e = x.e + y.e + 64;
+  return r;
+}
+
+
+/* format_digit_gen
+ *
+ *      Generates the digits of w_p until the rest falls within delta of
+ *      it, then moves the last digit towards w.
+ */
+static void     format_digit_gen        (FmtFp          w,
+                                         FmtFp          w_p,
+                                         fmt_u64        delta,
+                                         char           *digits,
+                                         int            *n,
+                                         int            *k)
+{
+  fmt_u64       one = (fmt_u64)1 << -w_p.e;
+  fmt_u64       wp_w = w_p.f - w.f;
+  fmt_u64       p1 = w_p.f >> -w_p.e;
+  fmt_u64       p2 = w_p.f & (one - 1);
+  fmt_u64       unit = 1;
+  unsigned long p = (unsigned long)p1;
+  int           kappa, d;
+
+  for (kappa = 1; (kappa < 10) && (p >= pow10_tab[kappa]); kappa++);
+
+  *n = 0;
+  while (kappa > 0)
+  {
+    d = (int)(p / pow10_tab[kappa-1]);
+    p %= pow10_tab[kappa-1];
+    if (d || *n) digits[(*n)++] = (char)('0' + d);
+    kappa--;
+    if ((((fmt_u64)p << -w_p.e) + p2) <= delta)
+    {
+      *k += kappa;
+      format_round
+        (digits, *n, delta, ((fmt_u64)p << -w_p.e) + p2,
+         (fmt_u64)pow10_tab[kappa] << -w_p.e, wp_w);
+      return;
+    }
+  }
+
+  for (;;)
+  {
+    p2 *= 10;
+    delta *= 10;
+    unit *= 10;
+    d = (int)(p2 >> -w_p.e);
+    if (d || *n) digits[(*n)++] = (char)('0' + d);
+    p2 &= one - 1;
+    kappa--;
+    if (p2 < delta)
+    {
+      *k += kappa;
+      format_round (digits, *n, delta, p2, one, wp_w * unit);
+      return;
+    }
+  }
+}
+
+
+/* format_round
+ */
+static void     format_round    (char           *digits,
+                                 int            n,
+                                 fmt_u64        delta,
+                                 fmt_u64        rest,
+                                 fmt_u64        ten_kappa,
+                                 fmt_u64        wp_w)
+{
+  while ((rest < wp_w) && (delta - rest >= ten_kappa) &&
+         ((rest + ten_kappa < wp_w) ||
+          (wp_w - rest > rest + ten_kappa - wp_w)))
+  {
+    digits[n-1]--;
+    rest += ten_kappa;
+  }
+}
+
+
+/* format_digits
+ *
+ *      Writes x in decimal, zero padded to width digits, returning the
+ *      number of digits.
+ */
+static int      format_digits   (unsigned long x, int width, char *s)
+{
+  char  tmp[16];
+  int   n = 0, len;
+
+  do
+  {
+    tmp[n++] = (char)('0' + x % 10);
+    x /= 10;
+  }
+  while (x > 0);
+  while (n < width) tmp[n++] = '0';
+
+  for (len = 0; n > 0; len++) s[len] = tmp[--n];
+  s[len] = 0;
+  return len;
+}
@@ -0,0 +1,77 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#ifndef _StripFormat
+#define _StripFormat
+
+#include "StripMisc.h"
+
+#define STRIP_FORMAT_BUFSIZE    65536
+#define STRIP_FORMAT_TIMEWIDTH  64
+
+/* StripFormat
+ *
+ *      Output buffer for the text dumps.  Rows are built in the buffer,
+ *      which is written out when it fills up, so the file sees a few
+ *      large writes.  The date and time part of a time stamp is formatted
+ *      only when the second changes, and numbers are converted without
+ *      going through printf(): they read back as the same double, and
+ *      are as short as that allows but for rare cases of one digit more.
+ */
+typedef struct _StripFormat
+{
+  FILE          *f;
+  char          *time_format;           /* for strftime() */
+  time_t        secs;                   /* of the cached time prefix */
+  int           time_len;
+  char          time_buf[STRIP_FORMAT_TIMEWIDTH];
+  int           n;                      /* bytes in buf */
+  int           error;
+  char          buf[STRIP_FORMAT_BUFSIZE];
+}
+StripFormat;
+
+
+/* StripFormat_init
+ *
+ *      Sets up the buffer for writing to the file, with time stamps
+ *      formatted by strftime() as given, followed by the microseconds.
+ */
+void    StripFormat_init        (StripFormat *, FILE *, char *);
+
+
+/* StripFormat_time, StripFormat_double, StripFormat_string
+ *
+ *      Append a time stamp, a number or a string.  Numbers are written
+ *      as by StripFormat_dtoa.
+ */
+void    StripFormat_time        (StripFormat *, struct timeval *);
+void    StripFormat_double      (StripFormat *, double);
+void    StripFormat_string      (StripFormat *, char *);
+
+
+/* StripFormat_flush
+ *
+ *      Writes out the buffer, returning false if any write has failed.
+ */
+int     StripFormat_flush       (StripFormat *);
+
+
+/* StripFormat_dtoa
+ *
+ *      Writes a decimal form of the double which reads back as the same
+ *      value into the buffer (at least 32 bytes), returning its length.
+ *      It is the shortest such form in all but a few cases, where it has
+ *      one digit more.
+ */
+int     StripFormat_dtoa        (double, char *);
+
+#endif  /* _StripFormat */
@@ -1160,6 +1160,17 @@ int     StripGraph_dumpdata_csv     (StripGraph the_sgi, FILE *f)
   return StripDataSource_dump_csv (sgi->data, f,the_sgi);
 }
 
+
+/*
+ * StripGraph_dumpdata_columns
+ */
+int     StripGraph_dumpdata_columns (StripGraph the_sgi, FILE *f)
+{
+  StripGraphInfo        *sgi = (StripGraphInfo *)the_sgi;
+  
+  return StripDataSource_dump_columns (sgi->data, f,the_sgi);
+}
+
 /*
  * StripGraph_print
  */
@@ -155,6 +155,15 @@ int     StripGraph_dumpdata     (StripGraph, FILE *);
 int     StripGraph_dumpdata_csv     (StripGraph, FILE *);
 
 
+/*
+ * StripGraph_dumpdata_columns
+ *
+ *      Causes all data for the curves on the current time range, to be
+ *      dumped out to the specified binary column file.
+ */
+int     StripGraph_dumpdata_columns (StripGraph, FILE *);
+
+
 #ifdef USE_SDDS
 /*
  * StripGraph_dumpdata_sdds
@@ -30,10 +30,38 @@ typedef enum _FetchStatus
   FETCH_IDLE = 0,       /* uninitialized */
   FETCH_DONE,           /* most recent fetch has completed successfully */
   FETCH_PENDING,        /* most recent fetch is still processing */
-  FETCH_NODATA          /* most recent fetch yielded no data */
+  FETCH_NODATA,         /* most recent fetch yielded no data */
+  FETCH_PARTIAL         /* most recent fetch failed or was cut short, and
+                         * covers [t0, t1] only */
 } FetchStatus;
 
 
+/* StripHistoryChunk
+ *
+ *    One contiguous, time-ordered run of history samples.  A result is
+ *    built from a list of chunks so that data delivered by different
+ *    sources (e.g. IOC archive record and archiver) can be handed over
+ *    as-is instead of being copied into one big array.  The chunk owns
+ *    its arrays: free_func is invoked with the chunk when it is released
+ *    and disposes of whatever free_arg refers to (0 means the memory
+ *    belongs to someone else).  times/data/status may point into the
+ *    middle of the owned arrays.
+ */
+typedef struct _StripHistoryChunk
+{
+  struct _StripHistoryChunk     *next;
+  struct _StripHistoryChunk     *prev;
+  struct timeval                *times;
+  double                        *data;
+  short                         *status;
+  int                           n_points;
+  size_t                        offset;   /* index of times[0] in result */
+  void                          *summary; /* StripMinMax, built on demand */
+  void                          (*free_func) (struct _StripHistoryChunk *);
+  void                          *free_arg[3];
+} StripHistoryChunk;
+
+
 /* StripHistoryResult
  *
  *    Structure used for returning results of history request.  Note
@@ -49,15 +77,18 @@ typedef enum _FetchStatus
  *
  *    (c) StripHistory_delete() is called.  This function is invoked only
  *        when the application is terminating.
+ *
+ *    The samples live in a time-ordered list of chunks.  Sample indices
+ *    (n_points, hidx_t0 etc.) run over the whole list, so index i is
+ *    found in the chunk for which offset <= i < offset + n_points.
  */
 typedef struct _StripHistoryResult
 {
   struct timeval        t0;             /* the requested begin time */
   struct timeval        t1;             /* requested end time */
-  struct timeval        *times;         /* time stamps */
-  double                *data;          /* real or reduced data values */
-  short                 *status;        /* error status */
-  int                   n_points;
+  StripHistoryChunk     *first;         /* earliest chunk */
+  StripHistoryChunk     *last;          /* latest chunk */
+  int                   n_points;       /* total over all chunks */
   FetchStatus           fetch_stat;
 } StripHistoryResult;
 
@@ -78,6 +109,170 @@ void        StripHistoryResult_release    (StripHistory,
 typedef void    (*StripHistoryCallback) (StripHistoryResult *, void *);
 
 
+/* StripHistoryChunk_new
+ *
+ *      Wraps the given arrays into a new chunk which takes ownership of
+ *      them.  The free function is called when the chunk is released;
+ *      StripHistoryChunk_free releases arrays obtained from malloc().
+ *      Returns 0 if no memory is available.
+ */
+StripHistoryChunk       *StripHistoryChunk_new
+                        (struct timeval *,                      /* times */
+                         double *,                              /* data */
+                         short *,                               /* status */
+                         int,                                   /* n_points */
+                         void (*)(StripHistoryChunk *));        /* free func */
+
+void    StripHistoryChunk_free          (StripHistoryChunk *);
+
+
+/* StripHistoryResult_append
+ *
+ *      Links the chunk onto the end of the result.  The chunk must not
+ *      start before the current last sample.  Empty chunks are released
+ *      right away.
+ */
+void    StripHistoryResult_append       (StripHistoryResult *,
+                                         StripHistoryChunk *);
+
+
+/* StripHistoryResult_clear
+ *
+ *      Releases all chunks of the result and leaves it empty.  Used by
+ *      the history modules to implement StripHistoryResult_release().
+ */
+void    StripHistoryResult_clear        (StripHistoryResult *);
+
+
+/* StripHistoryResult_locate
+ *
+ *      Returns the chunk holding sample index idx, and the index of the
+ *      sample within that chunk, or 0 if idx is out of range.
+ */
+StripHistoryChunk       *StripHistoryResult_locate
+                        (StripHistoryResult *,
+                         size_t,                                /* idx */
+                         size_t *);                             /* local idx */
+
+
+/* StripHistoryResult_splice
+ *
+ *      Moves the chunks of part, which must lie entirely before or after
+ *      the data of result, into result and leaves part empty.  Samples of
+ *      part which are not strictly outside result's data are dropped.
+ */
+void    StripHistoryResult_splice       (StripHistoryResult *,
+                                         StripHistoryResult *);     /* part */
+
+
+/* StripHistoryResult_drop
+ *
+ *      Releases the chunks lying entirely outside [t0, t1], and narrows
+ *      the result's range accordingly.
+ */
+void    StripHistoryResult_drop         (StripHistoryResult *,
+                                         struct timeval *,          /* t0 */
+                                         struct timeval *);         /* t1 */
+
+
+/* StripHistoryResult_copy
+ *
+ *      Appends copies of the samples of src on [t0, t1] to the result,
+ *      as one chunk.  Used to share one archive fetch between requests.
+ */
+void    StripHistoryResult_copy         (StripHistoryResult *,
+                                         StripHistoryResult *,      /* src */
+                                         struct timeval *,          /* t0 */
+                                         struct timeval *);         /* t1 */
+
+
+/* StripHistoryResult_min_max
+ *
+ *      Widens [*min, *max] to include the plotable samples with index on
+ *      [first, last], and returns 1 if there are any.  Uses min/max
+ *      summaries of the chunks, which are built on first use and kept
+ *      with the chunks, so repeated calls are cheap.
+ */
+int     StripHistoryResult_min_max      (StripHistoryResult *,
+                                         size_t,                /* first */
+                                         size_t,                /* last */
+                                         double *,              /* min */
+                                         double *);             /* max */
+
+
+/* StripHistoryBuffer
+ *
+ *      Collects samples read one at a time from an archive, growing its
+ *      arrays geometrically.  With a bin width, runs of plotable samples
+ *      falling into the same bin (multiple of the width since 1970) are
+ *      reduced to the first, minimum, maximum and last sample of the run,
+ *      so that a long range can be read in one pass at about the
+ *      resolution of the plot.  Non-plotable samples are always kept.
+ */
+typedef struct _StripHistoryBinSample
+{
+  struct timeval        t;
+  double                value;
+  short                 status;
+  long                  seq;            /* arrival order */
+}
+StripHistoryBinSample;
+
+typedef struct _StripHistoryBuffer
+{
+  struct timeval        *times;
+  double                *data;
+  short                 *status;
+  int                   n_points;
+  int                   size;           /* allocated samples */
+  double                bin_width;      /* 0: keep every sample */
+  double                bin;            /* current bin */
+  int                   in_bin;         /* samples in the current bin */
+  long                  seq;
+  StripHistoryBinSample first, min, max, last;
+}
+StripHistoryBuffer;
+
+
+/* StripHistoryBuffer_init
+ */
+void    StripHistoryBuffer_init         (StripHistoryBuffer *,
+                                         double);               /* bin width */
+
+
+/* StripHistoryBuffer_add
+ *
+ *      Adds a sample, which must not be earlier than the previous one.
+ *      Returns 0 if no memory is available.
+ */
+int     StripHistoryBuffer_add          (StripHistoryBuffer *,
+                                         struct timeval *,
+                                         double,                /* value */
+                                         short);                /* status */
+
+
+/* StripHistoryBuffer_chunk
+ *
+ *      Hands the samples collected so far over as a chunk (freed with
+ *      StripHistoryChunk_free) and leaves the buffer empty.
+ */
+StripHistoryChunk       *StripHistoryBuffer_chunk       (StripHistoryBuffer *);
+
+
+/* StripHistoryBuffer_free
+ */
+void    StripHistoryBuffer_free         (StripHistoryBuffer *);
+
+
+/* StripHistory_binwidth
+ *
+ *      The bin width for reducing a span (seconds) to about n_bins bins:
+ *      a power of two seconds, so that bins of similar spans coincide.
+ *      0 if n_bins is not positive.
+ */
+double  StripHistory_binwidth           (double, int);          /* span, n_bins */
+
+
 
 
 /* StripHistory_init
@@ -113,8 +308,10 @@ void            StripHistory_delete       (StripHistory);
  *
  *      Note that result->t0 and result->t1 must be set to begin and end,
  *      respectively, though this need not guarantee that times[0] == t0
- *      or times[n_point-1] == t1.  The only guarantees (on successful
- *      completion) is:
+ *      or times[n_point-1] == t1.  A fetch which fails or is cut short
+ *      ends up FETCH_PARTIAL, with [t0, t1] narrowed to the part of the
+ *      range it did fetch in full (t0 == t1 == end if none).  The only
+ *      guarantees (on successful completion) is:
  *
  *      (1) t0 <= t1
  *      (2) times[i] <= times[i+1]      : 0 <= i < n_points
@@ -136,4 +333,98 @@ FetchStatus     StripHistory_fetch      (StripHistory,
  *      has no effect.
  */
 void            StripHistory_cancel     (StripHistory, StripHistoryResult *);
+
+
+/* StripHistoryDeadline
+ *
+ *      Bounds the time a history request may take.  Blocking archive
+ *      calls check it between steps (and pass the remaining time on as
+ *      their own timeout where they can), and return what they have got
+ *      so far once it has expired or the request has been cancelled.
+ *      It also carries the span of the whole request, of which a fetch
+ *      may be just one slice.
+ */
+typedef struct _StripHistoryDeadline
+{
+  struct timeval        t;              /* give up at this time */
+  int                   none;           /* no time limit */
+  volatile int          cancelled;      /* set to abandon the request */
+  double                span;           /* whole request, or 0 if unknown */
+}
+StripHistoryDeadline;
+
+
+/* StripHistoryDeadline_init
+ *
+ *      Sets the deadline the given number of seconds from now; if that
+ *      is not positive, there is no time limit.
+ */
+void    StripHistoryDeadline_init       (StripHistoryDeadline *, double);
+
+
+/* StripHistoryDeadline_left
+ *
+ *      Returns the seconds left until the deadline: 0 if it has expired
+ *      or the request was cancelled, STRIP_HISTORY_FOREVER if there is no
+ *      limit (or no deadline at all, i.e. a null pointer).
+ */
+double  StripHistoryDeadline_left       (StripHistoryDeadline *);
+
+
+/* StripHistory_settimeout, StripHistory_gettimeout
+ *
+ *      The time limit (seconds) for a history request; initially taken
+ *      from STRIP_HISTORY_TIMEOUT.  Not positive means no limit.
+ */
+void    StripHistory_settimeout         (double);
+double  StripHistory_gettimeout         (void);
+
+
+/* StripHistorySyncFetch
+ *
+ *      A history module's blocking fetch of [begin, end] into an empty
+ *      result, giving up at the deadline.  Returns FETCH_DONE or
+ *      FETCH_NODATA if the range was fetched, FETCH_PARTIAL if not.
+ */
+typedef FetchStatus     (*StripHistorySyncFetch)        (StripHistory,
+                                                         char *,
+                                                         struct timeval *,
+                                                         struct timeval *,
+                                                         StripHistoryResult *,
+                                                         StripHistoryDeadline *);
+
+
+/* StripHistory_fetch_sliced
+ *
+ *      Helper for the history modules' StripHistory_fetch(): if there is
+ *      a callback, fetches the range in slices from Xt timeouts, newest
+ *      slice first, invoking the callback as each slice is added to the
+ *      result, and returns FETCH_PENDING.  Without a callback, just calls
+ *      the blocking fetch.  The callback is never invoked from within
+ *      this function.  Either way the request is subject to the history
+ *      timeout; on expiry, or if a slice fails, whatever has arrived is
+ *      the result, which is FETCH_PARTIAL from the oldest slice in on
+ *      (see StripHistory_fetch).  The first
+ *      slice waits for the settle interval (STRIP_HISTORY_SETTLE), and
+ *      overlapping slices of requests for the same channel are fetched
+ *      together.  Blocking fetches may be made from another thread;
+ *      calls to the fetch function are serialized.
+ */
+FetchStatus     StripHistory_fetch_sliced       (Strip,
+                                                 StripHistory,
+                                                 StripHistorySyncFetch,
+                                                 char *,                /* name */
+                                                 struct timeval *,      /* begin */
+                                                 struct timeval *,      /* end */
+                                                 StripHistoryResult *,
+                                                 StripHistoryCallback,
+                                                 void *);               /* call data */
+
+
+/* StripHistory_cancel_sliced
+ *
+ *      Cancels the sliced fetch into the result, if there is one.  The
+ *      partial result is kept, but marked FETCH_IDLE.
+ */
+void            StripHistory_cancel_sliced      (StripHistoryResult *);
 #endif
@@ -0,0 +1,892 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* History from an EPICS Archiver Appliance, through its PB-over-HTTP
+ * retrieval interface (data/getData.raw).
+ *
+ * The response is a sequence of chunks, each a line holding a
+ * PayloadInfo message (PV type and year) followed by one line per
+ * sample, and separated by empty lines.  Newlines within a line are
+ * escaped (ESC 1 = ESC, ESC 2 = LF, ESC 3 = CR).  The response is decoded
+ * as it is read from the socket, a line at a time, straight into the
+ * result buffer.
+ *
+ * With STRIP_HISTORY_BINS, the appliance is asked to reduce the range
+ * to about that many bins (e.g. mean_N, where N is the bin width in
+ * seconds); otherwise raw data is requested.  The following environment
+ * variables control the backend:
+ *
+ *   STRIP_HISTORY_AA_URL       the retrieval URL, e.g.
+ *                              http://archiver:17668/retrieval
+ *   STRIP_HISTORY_AA_OPERATOR  the appliance's reduction operator for
+ *                              binned requests (mean; also firstSample,
+ *                              lastSample, min, max, ...)
+ *
+ * Only plain http is supported.  Since the request path is fixed, any
+ * web server serving a canned PB file as <path>/data/getData.raw (and
+ * ignoring the query) can stand in for the appliance.
+ */
+
+#include "StripHistory.h"
+#include "StripHistoryCache.h"
+#include "StripDataSource.h"
+
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define DEBUG_AA        0
+
+#define AA_HOST_MAX     256
+#define AA_PATH_MAX     512
+#define AA_REQUEST_MAX  (AA_PATH_MAX + 3 * STRIP_MAX_NAME_CHAR + 256)
+#define AA_READ_SIZE    65536
+
+#define PB_ESC          0x1b
+
+/* PayloadType of the appliance's EPICSEvent.proto */
+#define PB_SCALAR_STRING        0
+#define PB_SCALAR_SHORT         1
+#define PB_SCALAR_FLOAT         2
+#define PB_SCALAR_ENUM          3
+#define PB_SCALAR_BYTE          4
+#define PB_SCALAR_INT           5
+#define PB_SCALAR_DOUBLE        6
+
+/* StripHistoryInfo
+ *
+ *      Contains instance data for the archive service.
+ */
+typedef struct _StripHistoryInfo
+{
+  Strip                 strip;
+  char                  host[AA_HOST_MAX];
+  char                  port[16];
+  char                  path[AA_PATH_MAX];
+  char                  op[32];         /* reduction operator */
+  StripHistoryCache     cache;
+  int                   n_bins;         /* 0: raw data */
+}
+StripHistoryInfo;
+
+
+/* PBStream
+ *
+ *      State of the decoder between reads from the socket.
+ */
+typedef struct _PBStream
+{
+  StripHistoryBuffer    *buffer;
+  unsigned char         *line;          /* the line read so far */
+  int                   len;
+  int                   size;
+  int                   escape;         /* last byte was ESC */
+  int                   header;         /* next line is a PayloadInfo */
+  int                   type;           /* of the current chunk */
+  double                year;           /* start of the chunk's year */
+  struct timeval        last;           /* latest sample so far */
+  int                   n_samples;
+}
+PBStream;
+
+
+#ifndef WIN32
+
+static FetchStatus      fetch_range     (StripHistory, char *,
+                                         struct timeval *, struct timeval *,
+                                         StripHistoryResult *,
+                                         StripHistoryDeadline *);
+static int      parse_url       (StripHistoryInfo *, char *);
+static int      aa_request      (StripHistoryInfo *, char *, char *,
+                                 struct timeval *, struct timeval *,
+                                 StripHistoryDeadline *);
+static int      aa_wait         (int, int, StripHistoryDeadline *);
+static int      aa_read         (int, char *, int, StripHistoryDeadline *);
+static int      aa_header       (int, char *, int *, int *,
+                                 StripHistoryDeadline *);
+static int      pb_feed         (PBStream *, unsigned char *, int);
+static int      pb_line         (PBStream *);
+static int      pb_varint       (unsigned char **, unsigned char *,
+                                 unsigned long *);
+static int      pb_skip         (unsigned char **, unsigned char *, int);
+static void     pb_fixed        (unsigned char *, unsigned char *, int);
+static double   year_start      (int);
+static void     iso_time        (char *, struct timeval *);
+static void     url_encode      (char *, char *, int);
+
+
+/* StripHistory_init
+ */
+StripHistory    StripHistory_init       (Strip strip)
+{
+  StripHistoryInfo      *shi = 0;
+  char                  *env;
+
+  if (!(env = getenv (STRIP_HISTORY_AA_URL_ENV)) || !*env)
+  {
+    fprintf
+      (stderr, "StripHistory_init: %s is not set, no archive data\n",
+       STRIP_HISTORY_AA_URL_ENV);
+    return 0;
+  }
+
+  if (!(shi = (StripHistoryInfo *)malloc (sizeof(StripHistoryInfo))))
+  {
+    fprintf (stderr, "StripHistory_init: can't allocate memory\n");
+    return 0;
+  }
+
+  if (!parse_url (shi, env))
+  {
+    fprintf (stderr, "StripHistory_init: bad archiver URL %s\n", env);
+    free (shi);
+    return 0;
+  }
+
+  shi->strip = strip;
+  strcpy (shi->op, STRIP_HISTORY_AA_OPERATOR);
+  if ((env = getenv (STRIP_HISTORY_AA_OPERATOR_ENV)) && *env)
+  {
+    strncpy (shi->op, env, sizeof (shi->op) - 1);
+    shi->op[sizeof (shi->op) - 1] = 0;
+  }
+  shi->cache = StripHistoryCache_init ();
+  shi->n_bins = STRIP_HISTORY_BINS;
+  if ((env = getenv (STRIP_HISTORY_BINS_ENV)) && *env)
+    shi->n_bins = atoi (env);
+
+  return (StripHistory)shi;
+}
+
+
+/* StripHistory_delete
+ */
+void    StripHistory_delete     (StripHistory the_shi)
+{
+  StripHistoryInfo      *shi = (StripHistoryInfo *)the_shi;
+
+  if (!shi) return;
+  StripHistoryCache_delete (shi->cache);
+  free (shi);
+}
+
+
+/* StripHistory_fetch
+ */
+FetchStatus     StripHistory_fetch      (StripHistory           the_shi,
+                                         char                   *name,
+                                         struct timeval         *begin,
+                                         struct timeval         *end,
+                                         StripHistoryResult     *result,
+                                         StripHistoryCallback   callback,
+                                         void                   *call_data)
+{
+  StripHistoryInfo      *shi = (StripHistoryInfo *)the_shi;
+
+  if (!shi)
+  {
+    StripHistoryResult_clear (result);
+    result->t0 = *begin;
+    result->t1 = *end;
+    result->fetch_stat = FETCH_NODATA;
+    return result->fetch_stat;
+  }
+
+  return StripHistory_fetch_sliced
+    (shi->strip, the_shi, fetch_range, name, begin, end, result,
+     callback, call_data);
+}
+
+
+/* fetch_range
+ *
+ *      Blocking fetch of [begin, end], from the cache if possible.  At the
+ *      deadline, only the older part of the range read so far is returned,
+ *      as FETCH_PARTIAL: it doesn't reach end, so nothing counts as covered.
+ */
+static FetchStatus      fetch_range     (StripHistory           the_shi,
+                                         char                   *name,
+                                         struct timeval         *begin,
+                                         struct timeval         *end,
+                                         StripHistoryResult     *result,
+                                         StripHistoryDeadline   *deadline)
+{
+  StripHistoryInfo      *shi = (StripHistoryInfo *)the_shi;
+  StripHistoryBuffer    buffer;
+  PBStream              pb;
+  char                  op[64], tag[64];
+  char                  *buf;
+  double                width;
+  int                   fd, n, code = 0, ok, complete = 0;
+
+  StripHistoryResult_clear (result);
+  result->t0 = *begin;
+  result->t1 = *end;
+  result->fetch_stat = FETCH_NODATA;
+
+  /* the appliance bins by whole seconds */
+  width = StripHistory_binwidth
+    (time2dbl (end) - time2dbl (begin), shi->n_bins);
+  if (width >= 1)
+  {
+    sprintf (op, "%s_%d", shi->op, (int)width);
+    strcpy (tag, op);
+  }
+  else
+  {
+    op[0] = 0;
+    strcpy (tag, "raw");
+  }
+
+  if (StripHistoryCache_lookup (shi->cache, name, tag, begin, end, result))
+  {
+    result->fetch_stat = (result->n_points > 0)? FETCH_DONE : FETCH_NODATA;
+    return result->fetch_stat;
+  }
+
+  if ((fd = aa_request (shi, name, op, begin, end, deadline)) < 0)
+  {
+    result->t0 = *end;
+    result->fetch_stat = FETCH_PARTIAL;
+    return result->fetch_stat;
+  }
+
+  if (!(buf = (char *)malloc (AA_READ_SIZE)))
+  {
+    fprintf (stderr, "StripHistory_fetch: can't allocate memory\n");
+    close (fd);
+    result->t0 = *end;
+    result->fetch_stat = FETCH_PARTIAL;
+    return result->fetch_stat;
+  }
+
+  StripHistoryBuffer_init (&buffer, 0);
+  memset (&pb, 0, sizeof (pb));
+  pb.buffer = &buffer;
+  pb.header = 1;
+
+  /* whatever came along with the header is the start of the body */
+  if ((ok = aa_header (fd, buf, &n, &code, deadline)) && (code != 200))
+  {
+    if (code != 404)
+      fprintf (stderr, "%s: archiver replied %d\n", name, code);
+    ok = 0;
+  }
+  while (ok)
+  {
+    if ((n > 0) && !(ok = pb_feed (&pb, (unsigned char *)buf, n))) break;
+    if ((n = aa_read (fd, buf, AA_READ_SIZE, deadline)) <= 0)
+    {
+      complete = (n == 0);
+      break;
+    }
+  }
+  if (ok && complete && (pb.len > 0))   /* no newline after the last line */
+    ok = pb_line (&pb);
+
+  close (fd);
+  free (buf);
+  if (pb.line) free (pb.line);
+
+#if DEBUG_AA
+  fprintf (stderr, "%s %s: %d samples, %d kept\n",
+           name, op, pb.n_samples, buffer.n_points);
+#endif
+
+  StripHistoryResult_append (result, StripHistoryBuffer_chunk (&buffer));
+  StripHistoryBuffer_free (&buffer);
+
+  /* an unknown channel has no data, anything else is a failure */
+  if (!(ok && complete) && (code != 404))
+  {
+    result->t0 = *end;
+    result->fetch_stat = FETCH_PARTIAL;
+  }
+  else if (result->n_points > 0)
+  {
+    result->fetch_stat = FETCH_DONE;
+    StripHistoryCache_store (shi->cache, name, tag, begin, end, result);
+  }
+
+  return result->fetch_stat;
+}
+
+
+/* StripHistory_cancel
+ */
+void    StripHistory_cancel     (StripHistory           BOGUS(the_shi),
+                                 StripHistoryResult     *result)
+{
+  StripHistory_cancel_sliced (result);
+}
+
+
+/* StripHistoryResult_release
+ */
+void  StripHistoryResult_release    (StripHistory           BOGUS(the_shi),
+                                     StripHistoryResult     *result)
+{
+  StripHistory_cancel_sliced (result);
+  StripHistoryResult_clear (result);
+}
+
+
+/* parse_url
+ *
+ *      Splits http://host[:port][/path] into the info's fields.
+ */
+static int      parse_url       (StripHistoryInfo *shi, char *url)
+{
+  char  *p, *q;
+  int   n;
+
+  if (strncmp (url, "http://", 7) != 0) return 0;
+  p = url + 7;
+
+  for (q = p; *q && (*q != ':') && (*q != '/'); q++);
+  if (((n = q - p) == 0) || (n >= AA_HOST_MAX)) return 0;
+  memcpy (shi->host, p, n);
+  shi->host[n] = 0;
+
+  strcpy (shi->port, "80");
+  if (*q == ':')
+  {
+    for (p = ++q; isdigit ((unsigned char)*q); q++);
+    if (((n = q - p) == 0) || (n >= (int)sizeof (shi->port))) return 0;
+    memcpy (shi->port, p, n);
+    shi->port[n] = 0;
+  }
+
+  if (*q && (*q != '/')) return 0;
+  if (strlen (q) >= AA_PATH_MAX) return 0;
+  strcpy (shi->path, q);
+  n = strlen (shi->path);
+  if ((n > 0) && (shi->path[n-1] == '/')) shi->path[n-1] = 0;
+
+  return 1;
+}
+
+
+/* aa_request
+ *
+ *      Connects to the appliance and sends the request.  Returns the
+ *      socket, or -1.
+ */
+static int      aa_request      (StripHistoryInfo       *shi,
+                                 char                   *name,
+                                 char                   *op,
+                                 struct timeval         *begin,
+                                 struct timeval         *end,
+                                 StripHistoryDeadline   *deadline)
+{
+  struct addrinfo       hints, *ai, *a;
+  char                  pv[3 * STRIP_MAX_NAME_CHAR + 1];
+  char                  from[32], to[32];
+  char                  request[AA_REQUEST_MAX];
+  int                   fd = -1, err, n, sent;
+  socklen_t             len;
+
+  memset (&hints, 0, sizeof (hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if ((err = getaddrinfo (shi->host, shi->port, &hints, &ai)) != 0)
+  {
+    fprintf (stderr, "StripHistory_fetch: %s: %s\n",
+             shi->host, gai_strerror (err));
+    return -1;
+  }
+
+  /* non-blocking, so that connecting is subject to the deadline */
+  for (a = ai; a; a = a->ai_next)
+  {
+    if ((fd = socket (a->ai_family, a->ai_socktype, a->ai_protocol)) < 0)
+      continue;
+    fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+    err = 0;
+    if ((connect (fd, a->ai_addr, a->ai_addrlen) != 0) &&
+        ((errno != EINPROGRESS) || !aa_wait (fd, 1, deadline) ||
+         ((len = sizeof (err)),
+          getsockopt (fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) ||
+         (err != 0)))
+    {
+      close (fd);
+      fd = -1;
+      continue;
+    }
+    break;
+  }
+  freeaddrinfo (ai);
+
+  if (fd < 0)
+  {
+    fprintf (stderr, "StripHistory_fetch: can't connect to %s:%s\n",
+             shi->host, shi->port);
+    return -1;
+  }
+
+  url_encode (pv, name, sizeof (pv));
+  iso_time (from, begin);
+  iso_time (to, end);
+  if (op[0])
+    n = sprintf
+      (request,
+       "GET %s/data/getData.raw?pv=%s(%s)&from=%s&to=%s HTTP/1.0\r\n"
+       "Host: %s\r\n\r\n",
+       shi->path, op, pv, from, to, shi->host);
+  else
+    n = sprintf
+      (request,
+       "GET %s/data/getData.raw?pv=%s&from=%s&to=%s HTTP/1.0\r\n"
+       "Host: %s\r\n\r\n",
+       shi->path, pv, from, to, shi->host);
+
+  for (sent = 0; sent < n; sent += err)
+  {
+    if (!aa_wait (fd, 1, deadline) ||
+        ((err = send (fd, request + sent, n - sent, 0)) <= 0))
+    {
+      close (fd);
+      return -1;
+    }
+  }
+
+  return fd;
+}
+
+
+/* aa_wait
+ *
+ *      Waits until the socket is readable (or writable), returns 0 at the
+ *      deadline.
+ */
+static int      aa_wait         (int                    fd,
+                                 int                    for_write,
+                                 StripHistoryDeadline   *deadline)
+{
+  fd_set                fds;
+  struct timeval        tv, *ptv;
+  double                left;
+  int                   n;
+
+  do
+  {
+    if ((left = StripHistoryDeadline_left (deadline)) <= 0) return 0;
+
+    /* wake up now and then to notice cancellation */
+    if (left > 1) left = 1;
+    dbl2time (&tv, left);
+    ptv = &tv;
+
+    FD_ZERO (&fds);
+    FD_SET (fd, &fds);
+    n = select (fd + 1, for_write? 0 : &fds, for_write? &fds : 0, 0, ptv);
+  }
+  while ((n == 0) || ((n < 0) && (errno == EINTR)));
+
+  return (n > 0);
+}
+
+
+/* aa_read
+ *
+ *      Returns the number of bytes read, 0 at the end of the response, or
+ *      -1 on error or at the deadline.
+ */
+static int      aa_read         (int                    fd,
+                                 char                   *buf,
+                                 int                    size,
+                                 StripHistoryDeadline   *deadline)
+{
+  int   n;
+
+  do
+  {
+    if (!aa_wait (fd, 0, deadline)) return -1;
+    n = recv (fd, buf, size, 0);
+  }
+  while ((n < 0) && ((errno == EINTR) || (errno == EAGAIN)));
+
+  return n;
+}
+
+
+/* aa_header
+ *
+ *      Reads the HTTP response header and gets the status code.  The part
+ *      of the body read along with it is moved to the start of buf, and
+ *      its length returned in *n.
+ */
+static int      aa_header       (int                    fd,
+                                 char                   *buf,
+                                 int                    *n,
+                                 int                    *code,
+                                 StripHistoryDeadline   *deadline)
+{
+  char  *p;
+  int   len = 0, k;
+
+  *n = 0;
+  *code = 0;
+  for (;;)
+  {
+    if ((k = aa_read (fd, buf + len, AA_READ_SIZE - 1 - len, deadline)) <= 0)
+      return 0;
+    len += k;
+    buf[len] = 0;
+    if ((p = strstr (buf, "\r\n\r\n"))) break;
+    if (len >= AA_READ_SIZE - 1) return 0;
+  }
+
+  if (sscanf (buf, "HTTP/%*s %d", code) != 1) return 0;
+
+  p += 4;
+  *n = len - (p - buf);
+  memmove (buf, p, *n);
+  return 1;
+}
+
+
+/* pb_feed
+ *
+ *      Passes the next bytes of the response through the decoder.  Returns
+ *      0 if no memory is available.
+ */
+static int      pb_feed         (PBStream *pb, unsigned char *p, int n)
+{
+  unsigned char *end = p + n;
+  unsigned char c;
+
+  for (; p < end; p++)
+  {
+    c = *p;
+    if (pb->escape)
+    {
+      pb->escape = 0;
+      if (c == 1) c = PB_ESC;
+      else if (c == 2) c = '\n';
+      else if (c == 3) c = '\r';
+    }
+    else if (c == PB_ESC)
+    {
+      pb->escape = 1;
+      continue;
+    }
+    else if (c == '\n')
+    {
+      if (!pb_line (pb)) return 0;
+      continue;
+    }
+
+    if (pb->len >= pb->size)
+    {
+      unsigned char *line = (unsigned char *)realloc
+        (pb->line, pb->size? 2 * pb->size : 256);
+      if (!line)
+      {
+        fprintf (stderr, "StripHistory_fetch: can't allocate memory\n");
+        return 0;
+      }
+      pb->line = line;
+      pb->size = pb->size? 2 * pb->size : 256;
+    }
+    pb->line[pb->len++] = c;
+  }
+
+  return 1;
+}
+
+
+/* pb_line
+ *
+ *      Decodes a complete line: a PayloadInfo, a sample, or the empty
+ *      line ending a chunk.
+ */
+static int      pb_line         (PBStream *pb)
+{
+  unsigned char *p = pb->line, *end = pb->line + pb->len;
+  unsigned long key, v;
+  unsigned long secs = 0, nano = 0, severity = 0;
+  unsigned char b[8];
+  double        value = 0;
+  float         f;
+  int           year = 1970, has_value = 0;
+  struct timeval t;
+
+  pb->len = 0;
+
+  if (p == end)
+  {
+    pb->header = 1;
+    return 1;
+  }
+
+  if (pb->header)
+  {
+    pb->header = 0;
+    pb->type = -1;
+    while (p < end)
+    {
+      if (!pb_varint (&p, end, &key)) break;
+      if (((key >> 3) == 1) && ((key & 7) == 0) && pb_varint (&p, end, &v))
+        pb->type = (int)v;
+      else if (((key >> 3) == 3) && ((key & 7) == 0) && pb_varint (&p, end, &v))
+        year = (int)v;
+      else if (!pb_skip (&p, end, (int)(key & 7))) break;
+    }
+    pb->year = year_start (year);
+    if ((pb->type < PB_SCALAR_SHORT) || (pb->type > PB_SCALAR_DOUBLE) ||
+        (pb->type == PB_SCALAR_BYTE))
+      fprintf (stderr, "StripHistory_fetch: can't plot payload type %d\n",
+               pb->type);
+    return 1;
+  }
+
+  while (p < end)
+  {
+    if (!pb_varint (&p, end, &key)) return 1;
+    switch (key)
+    {
+        case (1 << 3) | 0:      /* secondsintoyear */
+          if (!pb_varint (&p, end, &secs)) return 1;
+          break;
+        case (2 << 3) | 0:      /* nano */
+          if (!pb_varint (&p, end, &nano)) return 1;
+          break;
+        case (3 << 3) | 0:      /* sint32 val (short, enum) */
+          if (!pb_varint (&p, end, &v)) return 1;
+          value = (v & 1)? -(double)(v >> 1) - 1 : (double)(v >> 1);
+          has_value = 1;
+          break;
+        case (3 << 3) | 1:      /* double val */
+          if (end - p < 8) return 1;
+          pb_fixed (b, p, 8);
+          memcpy (&value, b, 8);
+          p += 8;
+          has_value = 1;
+          break;
+        case (3 << 3) | 5:      /* float or sfixed32 val */
+          if (end - p < 4) return 1;
+          if (pb->type == PB_SCALAR_FLOAT)
+          {
+            pb_fixed (b, p, 4);
+            memcpy (&f, b, 4);
+            value = f;
+          }
+          else
+          {
+            v = (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+              ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+            value = (v & 0x80000000UL)?
+              -(double)(0xffffffffUL - v) - 1 : (double)v;
+          }
+          p += 4;
+          has_value = 1;
+          break;
+        case (4 << 3) | 0:      /* severity */
+          if (!pb_varint (&p, end, &severity)) return 1;
+          break;
+        default:
+          if (!pb_skip (&p, end, (int)(key & 7))) return 1;
+          break;
+    }
+  }
+
+  dbl2time (&t, pb->year + secs);
+  t.tv_usec = nano / 1000;
+  pb->n_samples++;
+
+  /* the result must be in order */
+  if ((pb->n_samples > 1) && (compare_times (&t, &pb->last) < 0))
+    return 1;
+  pb->last = t;
+
+  /* the appliance uses severities above INVALID for disconnections etc. */
+  if (!has_value || (severity > 3) ||
+      (pb->type < PB_SCALAR_SHORT) || (pb->type > PB_SCALAR_DOUBLE) ||
+      (pb->type == PB_SCALAR_BYTE))
+    return StripHistoryBuffer_add (pb->buffer, &t, 0, 0);
+  return StripHistoryBuffer_add (pb->buffer, &t, value, DATASTAT_PLOTABLE);
+}
+
+
+static int      pb_varint       (unsigned char  **p,
+                                 unsigned char  *end,
+                                 unsigned long  *v)
+{
+  int   shift;
+
+  *v = 0;
+  for (shift = 0; *p < end; shift += 7)
+  {
+    if (shift < 8 * (int)sizeof (unsigned long))
+      *v |= (unsigned long)(**p & 0x7f) << shift;
+    if (!(*(*p)++ & 0x80)) return 1;
+  }
+  return 0;
+}
+
+
+/* pb_skip
+ *
+ *      Skips a field of the given wire type.
+ */
+static int      pb_skip         (unsigned char  **p,
+                                 unsigned char  *end,
+                                 int            wire_type)
+{
+  unsigned long v;
+
+  switch (wire_type)
+  {
+      case 0:
+        return pb_varint (p, end, &v);
+      case 1:
+        v = 8;
+        break;
+      case 2:
+        if (!pb_varint (p, end, &v)) return 0;
+        break;
+      case 5:
+        v = 4;
+        break;
+      default:
+        return 0;
+  }
+  if ((unsigned long)(end - *p) < v) return 0;
+  *p += v;
+  return 1;
+}
+
+
+/* pb_fixed
+ *
+ *      Copies a little-endian fixed size field into host byte order.
+ */
+static void     pb_fixed        (unsigned char *b, unsigned char *p, int n)
+{
+  static int    one = 1;
+  int           i;
+
+  for (i = 0; i < n; i++) b[i] = *(char *)&one? p[i] : p[n - 1 - i];
+}
+
+
+/* year_start
+ *
+ *      Seconds since 1970 at the start of the year (UTC).
+ */
+static double   year_start      (int year)
+{
+  long  y = year - 1, days;
+
+  days = 365 * (y - 1969) + (y / 4 - 1969 / 4) - (y / 100 - 1969 / 100) +
+    (y / 400 - 1969 / 400);
+  return 86400.0 * days;
+}
+
+
+/* iso_time
+ *
+ *      Formats the time as the appliance expects, e.g.
+ *      2004-01-01T08:00:00.000Z.
+ */
+static void     iso_time        (char *buf, struct timeval *t)
+{
+  time_t        secs = t->tv_sec;
+  struct tm     *tm = gmtime (&secs);
+
+  sprintf (buf, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+           tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
+           tm->tm_hour, tm->tm_min, tm->tm_sec, (int)(t->tv_usec / 1000));
+}
+
+
+static void     url_encode      (char *buf, char *s, int size)
+{
+  static char   hex[] = "0123456789ABCDEF";
+  int           n = 0;
+
+  for (; *s && (n < size - 3); s++)
+  {
+    if (isalnum ((unsigned char)*s) || strchr ("-_.~:", *s))
+      buf[n++] = *s;
+    else
+    {
+      buf[n++] = '%';
+      buf[n++] = hex[(unsigned char)*s >> 4];
+      buf[n++] = hex[*s & 15];
+    }
+  }
+  buf[n] = 0;
+}
+
+
+#else   /* WIN32 */
+
+StripHistory    StripHistory_init       (Strip BOGUS(strip))
+{
+  fprintf (stderr, "StripHistory_init: no Archiver Appliance support\n");
+  return 0;
+}
+
+void    StripHistory_delete     (StripHistory BOGUS(the_shi))
+{
+}
+
+FetchStatus     StripHistory_fetch      (StripHistory           BOGUS(the_shi),
+                                         char                   *BOGUS(name),
+                                         struct timeval         *begin,
+                                         struct timeval         *end,
+                                         StripHistoryResult     *result,
+                                         StripHistoryCallback   BOGUS(callback),
+                                         void                   *BOGUS(call_data))
+{
+  StripHistoryResult_clear (result);
+  result->t0 = *begin;
+  result->t1 = *end;
+  result->fetch_stat = FETCH_NODATA;
+  return result->fetch_stat;
+}
+
+void    StripHistory_cancel     (StripHistory           BOGUS(the_shi),
+                                 StripHistoryResult     *BOGUS(result))
+{
+}
+
+void  StripHistoryResult_release    (StripHistory           BOGUS(the_shi),
+                                     StripHistoryResult     *result)
+{
+  StripHistoryResult_clear (result);
+}
+
+#endif  /* WIN32 */
+
+/* **************************** Emacs Editing Sequences ***************** */
+/* Local Variables: */
+/* tab-width: 6 */
+/* c-basic-offset: 2 */
+/* c-comment-only-line-offset: 0 */
+/* c-indent-comments-syntactically-p: t */
+/* c-label-minimum-indentation: 1 */
+/* c-file-offsets: ((substatement-open . 0) (label . 2) */
+/* (brace-entry-open . 0) (label .2) (arglist-intro . +) */
+/* (arglist-cont-nonempty . c-lineup-arglist) ) */
+/* End: */
@@ -19,9 +19,18 @@
 /*#ifdef USE_AAPI TODO */
 extern char **algorithmString;
 extern int algorithmLength;
+extern long radioBoxAlgorithm;
+extern unsigned int historySize;
 
 /* #endif */
 
+static FetchStatus      fetch_range     (StripHistory, char *,
+                                         struct timeval *, struct timeval *,
+                                         StripHistoryResult *,
+                                         StripHistoryDeadline *);
+static char     *cache_tag      (struct timeval *, struct timeval *,
+                                 StripHistoryDeadline *, char *);
+
 /* StripHistory_init
  */
 StripHistory    StripHistory_init       (Strip strip)
@@ -31,6 +40,7 @@ StripHistory    StripHistory_init       (Strip strip)
   if ((shi = (StripHistoryInfo *)malloc (sizeof(StripHistoryInfo))))
   {
     shi->strip = strip;
+    shi->cache = StripHistoryCache_init ();
   } 
   else
     {
@@ -73,6 +83,7 @@ void    StripHistory_delete     (StripHistory the_shi)
 #ifdef USE_CAR
   CAR_delete(shi);
 #endif
+  StripHistoryCache_delete (shi->cache);
   free (shi);
 }
 
@@ -86,39 +97,70 @@ FetchStatus     StripHistory_fetch      (StripHistory           the_shi,
                                          StripHistoryCallback   callback,
                                          void                   *call_data)
 {
+  StripHistoryInfo      *shi = (StripHistoryInfo *)the_shi;
 
-  unsigned long err;
+  return StripHistory_fetch_sliced
+    (shi->strip, the_shi, fetch_range, name, begin, end, result,
+     callback, call_data);
+}
+
+/* fetch_range
+ *
+ *      Blocking fetch of [begin, end], from the cache if possible.
+ */
+static FetchStatus      fetch_range     (StripHistory           the_shi,
+                                         char                   *name,
+                                         struct timeval         *begin,
+                                         struct timeval         *end,
+                                         StripHistoryResult     *result,
+                                         StripHistoryDeadline   *deadline)
+{
 
-  struct timeval *times=NULL;
-  short  *status=NULL;
-  double *data=NULL;
-  unsigned long count=0;
+  StripHistoryInfo      *shi = (StripHistoryInfo *)the_shi;
+  unsigned long err;
+  StripHistoryChunk *first, *last;
+  char tag[64];
   
+  StripHistoryResult_clear(result);
   result->t0 = *begin;
   result->t1 = *end;
-  result->n_points = 0;
   result->fetch_stat=FETCH_NODATA;
+
+  cache_tag(begin, end, deadline, tag);
+  if(StripHistoryCache_lookup(shi->cache,name,tag,begin,end,result))
+    {
+      if(DEBUG) printf("%s: StripHistory_fetch: from cache\n",name);
+      result->fetch_stat = (result->n_points > 0)? FETCH_DONE : FETCH_NODATA;
+      return result->fetch_stat;
+    }
   
-  if((err=getHistory(the_shi,name,begin,end,&times,&status,&data,&count)) != 0) 
+  /* a failed source is asked again next time: nothing goes to the
+   * cache, where an empty partition would stand for no data */
+  if((err=getHistory(the_shi,name,begin,end,result,deadline)) != 0) 
     {
-      fprintf(stderr,"err=%ld:bad getHistory; no goodData \n",err);
-      return (FETCH_NODATA);
+      fprintf(stderr,"err=%ld:bad getHistory; data incomplete\n",err);
+      result->fetch_stat = FETCH_PARTIAL;
+      return result->fetch_stat;
     }
-  if(count < 1)
+  if(result->n_points < 1)
     {
-      if(DEBUG) fprintf(stderr,"getHistory; no goodData count=%lu\n",count);
+      if(DEBUG) fprintf(stderr,"getHistory; no goodData count=%d\n",
+			result->n_points);
       return (FETCH_NODATA);
     }
-  
-  if ((compare_times (begin, &times[count-1]) <= 0) &&
-      (compare_times (end, &times[0]) >= 0) &&
+
+  first = result->first;
+  last  = result->last;
+  if ((compare_times (begin, &last->times[last->n_points-1]) <= 0) &&
+      (compare_times (end, &first->times[0]) >= 0) &&
       (compare_times (begin, end) <= 0))
     {
-      result->times      = times;
-      result->data       = data;
-      result->status     = status;
-      result->n_points   = count;
       result->fetch_stat = FETCH_DONE;
+      /* a result cut at historySize, or at the deadline, doesn't
+       * cover the whole range */
+      if((result->n_points < (int)historySize - 1) &&
+	 (StripHistoryDeadline_left(deadline) > 0))
+	StripHistoryCache_store(shi->cache,name,tag,begin,end,result);
     }
   else 
     {
@@ -126,6 +168,7 @@ FetchStatus     StripHistory_fetch      (StripHistory           the_shi,
 	{
 	  printf("StripHistory_fetch: Compare problem \n");
 	}
+      StripHistoryResult_clear(result);
       result->fetch_stat = FETCH_NODATA;
     }
   if(DEBUG) printf("%s: StripHistory_fetch: OK\n",name);
@@ -134,19 +177,52 @@ FetchStatus     StripHistory_fetch      (StripHistory           the_shi,
 
  /* StripHistory_cancel
  */
-void    StripHistory_cancel     (StripHistory           the_shi,
+void    StripHistory_cancel     (StripHistory           BOGUS(the_shi),
                                  StripHistoryResult     *result)
 {
+  StripHistory_cancel_sliced(result);
 }
 /* StripHistoryResult_release
  */
 void  StripHistoryResult_release    (StripHistory           BOGUS(the_shi),
                                      StripHistoryResult     *result)
 {
-#ifdef USE_AAPI
-AAPI_Result_release(result);
+  StripHistory_cancel_sliced(result);
+  StripHistoryResult_clear(result);
+}
+
+/* cache_tag
+ *
+ *      The archiver's reduced data depends on the method and on the
+ *      resolution (span / historySize), so both go into the cache tag.
+ *      The span is that of the whole request rather than of the slice
+ *      being fetched: a slice comes back at least as fine as the tag
+ *      says, and all slices of a request share one tag.  The resolution
+ *      is rounded up to a power of two seconds, letting similar time
+ *      spans share cached partitions.  CAR data is reduced to min/max
+ *      per bin by get_CAR_data(), on the same ladder.
+ */
+static char     *cache_tag      (struct timeval         *begin,
+                                 struct timeval         *end,
+                                 StripHistoryDeadline   *deadline,
+                                 char                   *buf)
+{
+#if defined(USE_AAPI) || defined(USE_CAR)
+  double        span = time2dbl (end) - time2dbl (begin);
+  unsigned long res = 1;
+
+  if (deadline && (deadline->span > span)) span = deadline->span;
 #endif
-#ifdef USE_CAR
-CAR_Result_release(result);
+#ifdef USE_AAPI
+  while ((double)res * historySize < span) res <<= 1;
+  if ((radioBoxAlgorithm >= 0) && (radioBoxAlgorithm < algorithmLength))
+    sprintf (buf, "%.40s.%lu", algorithmString[radioBoxAlgorithm], res);
+  else sprintf (buf, "%ld.%lu", radioBoxAlgorithm, res);
+#elif defined(USE_CAR)
+  while ((double)res * (historySize / 4) < span) res <<= 1;
+  sprintf (buf, "minmax.%lu", res);
+#else
+  strcpy (buf, "raw");
 #endif
+  return buf;
 }
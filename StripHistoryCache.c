@@ -0,0 +1,655 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Notes
+ *
+ *      Cache layout:
+ *
+ *        $STRIP_HISTORY_CACHE_DIR/<channel>@<tag>/<t0>.shc
+ *
+ *      where <channel> and <tag> are escaped so that they make valid
+ *      file names, and t0 is the partition start in seconds past 1970.
+ *      A partition file looks like this:
+ *
+ *        ShcHeader                     (32 bytes)
+ *        double  data[n_points]
+ *        short   status[n_points]      (padded to a multiple of 8 bytes)
+ *        time stamps                   (time_bytes bytes)
+ *
+ *      Every time stamp is stored as two unsigned varints: the seconds
+ *      elapsed since the previous sample (since t0 for the first one),
+ *      and the microseconds.  Files are written to a temporary name and
+ *      then renamed, so concurrent sessions never see partial files.
+ *      The file modification time serves as LRU stamp: it is refreshed
+ *      whenever a partition is read.
+ */
+
+#include "StripHistoryCache.h"
+#include "StripDataSource.h"
+
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#endif
+
+#define DEBUG_CACHE     0
+
+#define SHC_MAGIC       "SHC1"
+#define SHC_SUFFIX      ".shc"
+#define SHC_PATH_MAX    1024
+#define SHC_PAD8(n)     (((n) + 7) & ~((size_t)7))
+
+typedef struct _ShcHeader
+{
+  char                  magic[4];
+  unsigned int          n_points;
+  unsigned int          partition;      /* partition length (seconds) */
+  unsigned int          time_bytes;     /* size of the time stamp column */
+  double                t0;             /* partition start */
+  unsigned int          reserved[2];
+}
+ShcHeader;
+
+typedef struct _StripHistoryCacheInfo
+{
+  char                  dir[SHC_PATH_MAX];
+  unsigned long         partition;      /* seconds per file */
+  unsigned long         settle;         /* never cache the last seconds */
+  double                max_bytes;
+  double                total_bytes;
+}
+StripHistoryCacheInfo;
+
+typedef struct _ShcFile
+{
+  char                  *path;
+  time_t                mtime;
+  double                size;
+}
+ShcFile;
+
+
+#ifndef WIN32
+
+static double   scan_dir        (StripHistoryCacheInfo *, ShcFile **, int *);
+static void     evict           (StripHistoryCacheInfo *);
+static void     shc_chunk_free  (StripHistoryChunk *);
+static int      shc_path        (StripHistoryCacheInfo *, char *, char *,
+                                 unsigned long, char *, int);
+static void     escape_name     (char *, char *, int);
+static size_t   put_varint      (unsigned char *, unsigned long);
+static size_t   get_varint      (unsigned char *, unsigned char *,
+                                 unsigned long *);
+
+
+/* StripHistoryCache_init
+ */
+StripHistoryCache       StripHistoryCache_init  (void)
+{
+  StripHistoryCacheInfo *shc;
+  struct stat           st;
+  char                  *env;
+
+  if (!(env = getenv (STRIP_HISTORY_CACHE_DIR_ENV)) || !*env)
+    return 0;
+
+  if ((stat (env, &st) != 0) && (mkdir (env, 0775) != 0))
+  {
+    fprintf (stderr, "StripHistoryCache_init: can't create %s: %s\n",
+             env, strerror (errno));
+    return 0;
+  }
+
+  if (!(shc = (StripHistoryCacheInfo *)malloc
+        (sizeof (StripHistoryCacheInfo))))
+  {
+    fprintf (stderr, "StripHistoryCache_init: can't allocate memory\n");
+    return 0;
+  }
+
+  strncpy (shc->dir, env, SHC_PATH_MAX - 1);
+  shc->dir[SHC_PATH_MAX - 1] = 0;
+  shc->partition = STRIP_HISTORY_CACHE_PARTITION;
+  shc->settle = STRIP_HISTORY_CACHE_SETTLE;
+  shc->max_bytes = STRIP_HISTORY_CACHE_SIZE;
+  if ((env = getenv (STRIP_HISTORY_CACHE_SIZE_ENV)) && (atof (env) > 0))
+    shc->max_bytes = atof (env);
+  shc->max_bytes *= 1024.0 * 1024.0;
+
+  shc->total_bytes = scan_dir (shc, 0, 0);
+  if (shc->total_bytes > shc->max_bytes) evict (shc);
+
+#if DEBUG_CACHE
+  fprintf (stderr, "StripHistoryCache_init: %s, %g of %g bytes used\n",
+           shc->dir, shc->total_bytes, shc->max_bytes);
+#endif
+  return (StripHistoryCache)shc;
+}
+
+
+/* StripHistoryCache_delete
+ */
+void    StripHistoryCache_delete        (StripHistoryCache the_shc)
+{
+  if (the_shc) free (the_shc);
+}
+
+
+/* StripHistoryCache_lookup
+ */
+int     StripHistoryCache_lookup        (StripHistoryCache      the_shc,
+                                         char                   *name,
+                                         char                   *tag,
+                                         struct timeval         *begin,
+                                         struct timeval         *end,
+                                         StripHistoryResult     *result)
+{
+  StripHistoryCacheInfo *shc = (StripHistoryCacheInfo *)the_shc;
+  StripHistoryResult    tmp;
+  StripHistoryChunk     *c;
+  char                  path[SHC_PATH_MAX];
+  unsigned long         p, p0, p1;
+  struct stat           st;
+  ShcHeader             *h;
+  unsigned char         *map, *q, *q_end;
+  double                *data;
+  short                 *status;
+  struct timeval        *times;
+  unsigned long         sec, usec, i, i0, i1;
+  int                   fd;
+
+  if (!shc || (compare_times (begin, end) > 0) || (begin->tv_sec < 0))
+    return 0;
+
+  p0 = (unsigned long)begin->tv_sec / shc->partition;
+  p1 = (unsigned long)end->tv_sec / shc->partition;
+
+  /* cheap check first: is every partition there? */
+  for (p = p0; p <= p1; p++)
+    if (!shc_path (shc, name, tag, p * shc->partition, path, 0) ||
+        (access (path, R_OK) != 0))
+      return 0;
+
+  memset (&tmp, 0, sizeof (tmp));
+
+  for (p = p0; p <= p1; p++)
+  {
+    shc_path (shc, name, tag, p * shc->partition, path, 0);
+    if ((fd = open (path, O_RDONLY)) < 0) break;
+    if ((fstat (fd, &st) != 0) || (st.st_size < (off_t)sizeof (ShcHeader)))
+    {
+      close (fd);
+      break;
+    }
+
+    map = (unsigned char *)mmap
+      (0, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (map == (unsigned char *)MAP_FAILED) break;
+
+    h = (ShcHeader *)map;
+    if ((memcmp (h->magic, SHC_MAGIC, 4) != 0) ||
+        (h->partition != shc->partition) ||
+        ((size_t)st.st_size !=
+         sizeof (ShcHeader) + h->n_points * sizeof (double) +
+         SHC_PAD8 (h->n_points * sizeof (short)) + h->time_bytes))
+    {
+      fprintf (stderr, "StripHistoryCache: discarding bad file %s\n", path);
+      munmap ((void *)map, (size_t)st.st_size);
+      unlink (path);
+      break;
+    }
+
+    utime (path, 0);    /* LRU stamp */
+
+    if (h->n_points == 0)       /* archiver had nothing there */
+    {
+      munmap ((void *)map, (size_t)st.st_size);
+      continue;
+    }
+
+    data = (double *)(map + sizeof (ShcHeader));
+    status = (short *)(data + h->n_points);
+    q = (unsigned char *)status + SHC_PAD8 (h->n_points * sizeof (short));
+    q_end = q + h->time_bytes;
+
+    if (!(times = (struct timeval *)malloc
+          (h->n_points * sizeof (struct timeval))))
+    {
+      munmap ((void *)map, (size_t)st.st_size);
+      break;
+    }
+
+    /* decode the time stamps, keeping the samples on [begin, end] */
+    sec = (unsigned long)h->t0;
+    i0 = h->n_points;
+    i1 = 0;
+    for (i = 0; i < h->n_points; i++)
+    {
+      unsigned long     dsec;
+
+      q += get_varint (q, q_end, &dsec);
+      q += get_varint (q, q_end, &usec);
+      sec += dsec;
+      times[i].tv_sec = (long)sec;
+      times[i].tv_usec = (long)usec;
+
+      if ((compare_times (&times[i], begin) >= 0) &&
+          (compare_times (&times[i], end) <= 0))
+      {
+        if (i0 == h->n_points) i0 = i;
+        i1 = i;
+      }
+    }
+
+    if (!(c = StripHistoryChunk_new (times, data, status, 0, shc_chunk_free)))
+    {
+      free (times);
+      munmap ((void *)map, (size_t)st.st_size);
+      break;
+    }
+    c->free_arg[1] = map;
+    c->free_arg[2] = 0;
+    if (i0 < h->n_points)
+    {
+      c->times += i0;
+      c->data += i0;
+      c->status += i0;
+      c->n_points = (int)(i1 - i0 + 1);
+    }
+    StripHistoryResult_append (&tmp, c);
+  }
+
+  if (p <= p1)          /* something went wrong on the way */
+  {
+    StripHistoryResult_clear (&tmp);
+    return 0;
+  }
+
+  result->first = tmp.first;
+  result->last = tmp.last;
+  result->n_points = tmp.n_points;
+  return 1;
+}
+
+
+/* StripHistoryCache_store
+ */
+void    StripHistoryCache_store         (StripHistoryCache      the_shc,
+                                         char                   *name,
+                                         char                   *tag,
+                                         struct timeval         *begin,
+                                         struct timeval         *end,
+                                         StripHistoryResult     *result)
+{
+  StripHistoryCacheInfo *shc = (StripHistoryCacheInfo *)the_shc;
+  StripHistoryChunk     *c;
+  struct timeval        now;
+  unsigned long         p, p0, p1, limit, t_start, t_end;
+  char                  path[SHC_PATH_MAX], tmp_path[SHC_PATH_MAX];
+  ShcHeader             h;
+  double                *data = 0;
+  short                 *status = 0;
+  unsigned char         *tbuf = 0;
+  size_t                n, max_n, nt;
+  unsigned long         prev_sec;
+  int                   i, ok;
+  FILE                  *f;
+  static char           pad[8];
+
+  if (!shc || (begin->tv_sec < 0) || (compare_times (begin, end) >= 0))
+    return;
+
+  get_current_time (&now);
+  limit = (unsigned long)now.tv_sec - shc->settle;
+  if ((unsigned long)end->tv_sec < limit) limit = (unsigned long)end->tv_sec;
+
+  /* partitions lying entirely on [begin, limit] */
+  p0 = ((unsigned long)begin->tv_sec + shc->partition - 1) / shc->partition;
+  if (begin->tv_usec && ((unsigned long)begin->tv_sec % shc->partition == 0))
+    p0++;
+  p1 = limit / shc->partition;          /* first partition not to store */
+  if (p0 >= p1) return;
+
+  max_n = (size_t)result->n_points;
+  data = (double *)malloc ((max_n + 1) * sizeof (double));
+  status = (short *)malloc ((max_n + 1) * sizeof (short));
+  tbuf = (unsigned char *)malloc ((max_n + 1) * 2 * 10);
+  if (!data || !status || !tbuf)
+  {
+    fprintf (stderr, "StripHistoryCache_store: can't allocate memory\n");
+    goto done;
+  }
+
+  /* chunks are in time order, so walk them once */
+  c = result->first;
+  i = 0;
+  for (p = p0; p < p1; p++)
+  {
+    t_start = p * shc->partition;
+    t_end = t_start + shc->partition;
+
+    if (!shc_path (shc, name, tag, t_start, path, 1)) break;
+    if (access (path, F_OK) == 0)
+      continue;
+
+    n = nt = 0;
+    prev_sec = t_start;
+    ok = 1;
+    for (; c; c = c->next, i = 0)
+    {
+      for (; i < c->n_points; i++)
+      {
+        if ((unsigned long)c->times[i].tv_sec < t_start) continue;
+        if ((unsigned long)c->times[i].tv_sec >= t_end) break;
+        if ((unsigned long)c->times[i].tv_sec < prev_sec) ok = 0;
+        data[n] = c->data[i];
+        status[n] = c->status[i];
+        nt += put_varint
+          (tbuf + nt, (unsigned long)c->times[i].tv_sec - prev_sec);
+        nt += put_varint (tbuf + nt, (unsigned long)c->times[i].tv_usec);
+        prev_sec = (unsigned long)c->times[i].tv_sec;
+        n++;
+      }
+      if (i < c->n_points) break;
+    }
+    if (!ok) continue;  /* not in time order --don't trust it */
+
+    memset (&h, 0, sizeof (h));
+    memcpy (h.magic, SHC_MAGIC, 4);
+    h.n_points = (unsigned int)n;
+    h.partition = (unsigned int)shc->partition;
+    h.time_bytes = (unsigned int)nt;
+    h.t0 = (double)t_start;
+
+    sprintf (tmp_path, "%s.%d", path, (int)getpid ());
+    if (!(f = fopen (tmp_path, "wb")))
+    {
+      fprintf (stderr, "StripHistoryCache_store: can't write %s: %s\n",
+               tmp_path, strerror (errno));
+      break;
+    }
+    ok = (fwrite (&h, sizeof (h), 1, f) == 1);
+    if (ok && n)
+      ok = ((fwrite (data, sizeof (double), n, f) == n) &&
+            (fwrite (status, sizeof (short), n, f) == n) &&
+            (fwrite (pad, 1, SHC_PAD8 (n * sizeof (short)) -
+                     n * sizeof (short), f) ==
+             SHC_PAD8 (n * sizeof (short)) - n * sizeof (short)) &&
+            (fwrite (tbuf, 1, nt, f) == nt));
+    if ((fclose (f) != 0) || !ok || (rename (tmp_path, path) != 0))
+    {
+      fprintf (stderr, "StripHistoryCache_store: can't write %s\n", path);
+      unlink (tmp_path);
+      break;
+    }
+
+    shc->total_bytes += sizeof (h) + n * sizeof (double) +
+      SHC_PAD8 (n * sizeof (short)) + nt;
+  }
+
+  if (shc->total_bytes > shc->max_bytes) evict (shc);
+
+done:
+  if (data) free (data);
+  if (status) free (status);
+  if (tbuf) free (tbuf);
+}
+
+
+/* shc_chunk_free
+ *
+ *      Unmaps the partition file and frees the decoded time stamps.
+ */
+static void     shc_chunk_free  (StripHistoryChunk *c)
+{
+  ShcHeader     *h = (ShcHeader *)c->free_arg[1];
+
+  if (h)
+    munmap ((void *)h, sizeof (ShcHeader) + h->n_points * sizeof (double) +
+            SHC_PAD8 (h->n_points * sizeof (short)) + h->time_bytes);
+  if (c->free_arg[0]) free (c->free_arg[0]);
+}
+
+
+/* shc_path
+ *
+ *      Builds the file name of a partition, optionally creating the
+ *      channel directory.  Returns 0 if the name doesn't fit.
+ */
+static int      shc_path        (StripHistoryCacheInfo  *shc,
+                                 char                   *name,
+                                 char                   *tag,
+                                 unsigned long          t0,
+                                 char                   *path,
+                                 int                    create)
+{
+  char  ename[SHC_PATH_MAX / 4], etag[SHC_PATH_MAX / 8];
+
+  escape_name (name, ename, sizeof (ename));
+  escape_name (tag, etag, sizeof (etag));
+  if (strlen (shc->dir) + strlen (ename) + strlen (etag) + 32 >= SHC_PATH_MAX)
+    return 0;
+
+  sprintf (path, "%s/%s@%s", shc->dir, ename, etag);
+  if (create) mkdir (path, 0775);
+  sprintf (path + strlen (path), "/%lu%s", t0, SHC_SUFFIX);
+  return 1;
+}
+
+
+/* escape_name
+ *
+ *      Copies the string, replacing every character which could upset
+ *      the file system by %XX.
+ */
+static void     escape_name     (char *s, char *buf, int size)
+{
+  static char   hex[] = "0123456789ABCDEF";
+  int           n = 0;
+
+  for (; *s && (n < size - 4); s++)
+  {
+    if (isalnum ((unsigned char)*s) || (*s == ':') || (*s == '_') ||
+        (*s == '-') || ((*s == '.') && n))
+      buf[n++] = *s;
+    else
+    {
+      buf[n++] = '%';
+      buf[n++] = hex[(*s >> 4) & 0xf];
+      buf[n++] = hex[*s & 0xf];
+    }
+  }
+  buf[n] = 0;
+}
+
+
+static size_t   put_varint      (unsigned char *q, unsigned long x)
+{
+  size_t        n = 0;
+
+  while (x >= 0x80)
+  {
+    q[n++] = (unsigned char)(x | 0x80);
+    x >>= 7;
+  }
+  q[n++] = (unsigned char)x;
+  return n;
+}
+
+
+static size_t   get_varint      (unsigned char  *q,
+                                 unsigned char  *q_end,
+                                 unsigned long  *x)
+{
+  size_t        n = 0;
+  int           shift = 0;
+
+  *x = 0;
+  while (q + n < q_end)
+  {
+    *x |= (unsigned long)(q[n] & 0x7f) << shift;
+    shift += 7;
+    if (!(q[n++] & 0x80)) break;
+  }
+  return n;
+}
+
+
+/* scan_dir
+ *
+ *      Returns the total size of all partition files, and optionally
+ *      a list of them.
+ */
+static double   scan_dir        (StripHistoryCacheInfo  *shc,
+                                 ShcFile                **list,
+                                 int                    *n_list)
+{
+  DIR           *top, *sub;
+  struct dirent *d, *e;
+  struct stat   st;
+  char          path[SHC_PATH_MAX];
+  double        total = 0;
+  int           n = 0, max = 0;
+  size_t        len;
+
+  if (list) *list = 0;
+  if (!(top = opendir (shc->dir))) return 0;
+
+  while ((d = readdir (top)))
+  {
+    if (d->d_name[0] == '.') continue;
+    if (strlen (shc->dir) + strlen (d->d_name) + 2 >= SHC_PATH_MAX) continue;
+    sprintf (path, "%s/%s", shc->dir, d->d_name);
+    if (!(sub = opendir (path))) continue;
+
+    while ((e = readdir (sub)))
+    {
+      len = strlen (e->d_name);
+      if ((len <= strlen (SHC_SUFFIX)) ||
+          strcmp (e->d_name + len - strlen (SHC_SUFFIX), SHC_SUFFIX))
+        continue;
+      if (strlen (shc->dir) + strlen (d->d_name) + len + 3 >= SHC_PATH_MAX)
+        continue;
+      sprintf (path, "%s/%s/%s", shc->dir, d->d_name, e->d_name);
+      if (stat (path, &st) != 0) continue;
+
+      total += (double)st.st_size;
+      if (list)
+      {
+        if (n == max)
+        {
+          ShcFile       *tmp;
+          max = max? 2 * max : 256;
+          if (!(tmp = (ShcFile *)realloc (*list, max * sizeof (ShcFile))))
+            break;
+          *list = tmp;
+        }
+        if (((*list)[n].path = (char *)malloc (strlen (path) + 1)))
+        {
+          strcpy ((*list)[n].path, path);
+          (*list)[n].mtime = st.st_mtime;
+          (*list)[n].size = (double)st.st_size;
+          n++;
+        }
+      }
+    }
+    closedir (sub);
+  }
+  closedir (top);
+
+  if (n_list) *n_list = n;
+  return total;
+}
+
+
+static int      cmp_mtime       (const void *a, const void *b)
+{
+  time_t        x = ((ShcFile *)a)->mtime, y = ((ShcFile *)b)->mtime;
+  return (x < y)? -1 : ((x > y)? 1 : 0);
+}
+
+
+/* evict
+ *
+ *      Removes the least recently used partitions until the cache is
+ *      down to 90% of its size limit.
+ */
+static void     evict           (StripHistoryCacheInfo *shc)
+{
+  ShcFile       *list;
+  int           i, n;
+
+  shc->total_bytes = scan_dir (shc, &list, &n);
+  if (!list) return;
+
+  qsort (list, n, sizeof (ShcFile), cmp_mtime);
+  for (i = 0; i < n; i++)
+  {
+    if (shc->total_bytes > 0.9 * shc->max_bytes)
+      if (unlink (list[i].path) == 0) shc->total_bytes -= list[i].size;
+    free (list[i].path);
+  }
+  free (list);
+}
+
+#else   /* WIN32: no cache */
+
+StripHistoryCache       StripHistoryCache_init  (void)
+{
+  return 0;
+}
+
+void    StripHistoryCache_delete        (StripHistoryCache BOGUS(1))
+{
+}
+
+int     StripHistoryCache_lookup        (StripHistoryCache      BOGUS(1),
+                                         char                   *BOGUS(2),
+                                         char                   *BOGUS(3),
+                                         struct timeval         *BOGUS(4),
+                                         struct timeval         *BOGUS(5),
+                                         StripHistoryResult     *BOGUS(6))
+{
+  return 0;
+}
+
+void    StripHistoryCache_store         (StripHistoryCache      BOGUS(1),
+                                         char                   *BOGUS(2),
+                                         char                   *BOGUS(3),
+                                         struct timeval         *BOGUS(4),
+                                         struct timeval         *BOGUS(5),
+                                         StripHistoryResult     *BOGUS(6))
+{
+}
+
+#endif  /* WIN32 */
+
+/* **************************** Emacs Editing Sequences ***************** */
+/* Local Variables: */
+/* tab-width: 6 */
+/* c-basic-offset: 2 */
+/* c-comment-only-line-offset: 0 */
+/* c-indent-comments-syntactically-p: t */
+/* c-label-minimum-indentation: 1 */
+/* c-file-offsets: ((substatement-open . 0) (label . 2) */
+/* (brace-entry-open . 0) (label .2) (arglist-intro . +) */
+/* (arglist-cont-nonempty . c-lineup-arglist) ) */
+/* End: */
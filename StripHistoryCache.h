@@ -0,0 +1,76 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#ifndef _StripHistoryCache
+#define _StripHistoryCache
+
+#include "StripHistory.h"
+
+/* StripHistoryCache
+ *
+ *      Persistent on-disk cache of archive data, shared by all StripTool
+ *      sessions which use the same directory.  Each channel has its own
+ *      subdirectory holding one file per fixed time partition; a file
+ *      stores the partition's values and status as plain columns, which
+ *      are memory-mapped on read, followed by the delta-encoded time
+ *      stamps.  Only partitions which lie entirely in the (settled) past
+ *      and were entirely covered by an archive request are written, so
+ *      a partition file is always complete.
+ *
+ *      The cache is enabled by setting STRIP_HISTORY_CACHE_DIR.  Its
+ *      total size is bounded by STRIP_HISTORY_CACHE_SIZE (Mbytes); the
+ *      least recently used partitions are evicted first.
+ */
+typedef void *  StripHistoryCache;
+
+
+/* StripHistoryCache_init
+ *
+ *      Returns a handle to the cache, or 0 if the cache is disabled or
+ *      its directory is unusable.
+ */
+StripHistoryCache       StripHistoryCache_init          (void);
+
+
+/* StripHistoryCache_delete
+ */
+void                    StripHistoryCache_delete        (StripHistoryCache);
+
+
+/* StripHistoryCache_lookup
+ *
+ *      If every partition overlapping [begin, end] is in the cache,
+ *      appends the cached samples on that range to the (empty) result
+ *      and returns 1.  Otherwise leaves the result alone and returns 0.
+ *      The tag distinguishes differently reduced data of one channel
+ *      (e.g. the archiver's reduction method).
+ */
+int     StripHistoryCache_lookup        (StripHistoryCache,
+                                         char *,                /* name */
+                                         char *,                /* tag */
+                                         struct timeval *,      /* begin */
+                                         struct timeval *,      /* end */
+                                         StripHistoryResult *);
+
+
+/* StripHistoryCache_store
+ *
+ *      Writes those partitions which are completely covered by a
+ *      successful fetch on [begin, end] and not cached yet.
+ */
+void    StripHistoryCache_store         (StripHistoryCache,
+                                         char *,                /* name */
+                                         char *,                /* tag */
+                                         struct timeval *,      /* begin */
+                                         struct timeval *,      /* end */
+                                         StripHistoryResult *);
+
+#endif  /* _StripHistoryCache */
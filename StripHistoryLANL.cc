@@ -13,6 +13,7 @@
 extern "C" {
 #include "StripHistory.h"
 #include "StripDataSource.h"
+#include "StripHistoryCache.h"
 }
 
 #include <iostream.h>
@@ -31,22 +32,20 @@ extern "C" {
 #endif
 */
 
-// AccessChanArch does the actual data acquisition from the archiver
-int AccessChanArch(ArchiveI *, 
-		   const stdString &, 
-		   const osiTime &, 
-		   const osiTime &, 
-		   double *, 
-		   short *, 
-		   struct timeval *, 
-		   size_t);
-
-// CountSamples finds out how many distinct data points we have in the requested range 
-// in order to allocate memory properly
-size_t CountSamples(ArchiveI *, 
-		    const stdString &, 
-		    const osiTime &, 
-		    const osiTime &);
+// ReadChanArch reads the requested range from the archiver in one pass,
+// into the buffer (which reduces it to min/max per bin if it has a bin
+// width).  At the deadline it stops, keeping the older part read so far.
+bool ReadChanArch(ArchiveI *, 
+		  const stdString &, 
+		  const osiTime &, 
+		  const osiTime &, 
+		  StripHistoryBuffer *,
+		  StripHistoryDeadline *);
+
+extern "C" FetchStatus LANL_fetch_range (StripHistory, char *,
+                                        struct timeval *, struct timeval *,
+                                        StripHistoryResult *,
+                                        StripHistoryDeadline *);
 
 static bool VERBOSE = false;
 
@@ -58,6 +57,8 @@ typedef struct _StripHistoryInfo
 {
   Strip         strip;
   ArchiveI      *archiveI;
+  StripHistoryCache     cache;
+  int           n_bins;         /* 0: raw data */
 }
 StripHistoryInfo;
 
@@ -68,6 +69,7 @@ extern "C" StripHistory    StripHistory_init       (Strip strip)
 {
   StripHistoryInfo      *shi = 0;
   stdString ARCHIVE_NAME, VERBOSE_SWITCH;
+  char *env;
   
   ARCHIVE_NAME = getenv(ARCHIVE_NAME_ENVIRONMENT_VAR);
   if(ARCHIVE_NAME.empty())
@@ -92,6 +94,10 @@ extern "C" StripHistory    StripHistory_init       (Strip strip)
     {
       shi->strip = strip;
       shi->archiveI = new BinArchive (ARCHIVE_NAME);
+      shi->cache = StripHistoryCache_init ();
+      shi->n_bins = STRIP_HISTORY_BINS;
+      if ((env = getenv (STRIP_HISTORY_BINS_ENV)) && *env)
+        shi->n_bins = atoi (env);
     }
   
   return (StripHistory)shi;
@@ -105,6 +111,7 @@ extern "C" void    StripHistory_delete     (StripHistory the_shi)
   StripHistoryInfo      *shi = (StripHistoryInfo *)the_shi;
 
   delete shi->archiveI;
+  StripHistoryCache_delete (shi->cache);
   free (shi);
 }
 
@@ -116,60 +123,83 @@ extern "C" FetchStatus     StripHistory_fetch      (StripHistory           the_s
 						    struct timeval         *begin,
 						    struct timeval         *end,
 						    StripHistoryResult     *result,
-						    StripHistoryCallback   BOGUS(callback),
-						    void                   *BOGUS(call_data))
+						    StripHistoryCallback   callback,
+						    void                   *call_data)
 {
   StripHistoryInfo *shi = (StripHistoryInfo *)the_shi;
-  size_t samples;
-  int no_of_points;
+
+  return StripHistory_fetch_sliced
+    (shi->strip, the_shi, LANL_fetch_range, name, begin, end, result,
+     callback, call_data);
+}
+
+
+/* LANL_fetch_range
+ *
+ *      Blocking fetch of [begin, end], from the cache if possible.  At the
+ *      deadline, only the older part of the range read so far is returned.
+ */
+extern "C" FetchStatus     LANL_fetch_range        (StripHistory           the_shi,
+						    char                   *name,
+						    struct timeval         *begin,
+						    struct timeval         *end,
+						    StripHistoryResult     *result,
+						    StripHistoryDeadline   *deadline)
+{
+  StripHistoryInfo *shi = (StripHistoryInfo *)the_shi;
+  StripHistoryBuffer buffer;
+  double width;
+  char tag[32];
 
   osiTime t0 = osiTime(begin->tv_sec, (begin->tv_usec * 1000));
   osiTime t1 = osiTime(end->tv_sec, (end->tv_usec * 1000));
 
-  samples = CountSamples(shi->archiveI, name, t0, t1);
+  /* binned data depends on the bin width, so it goes into the cache tag */
+  width = StripHistory_binwidth
+    (time2dbl (end) - time2dbl (begin), shi->n_bins);
+  if (width > 0) sprintf (tag, "minmax.%g", width);
+  else strcpy (tag, "raw");
 
-  if(VERBOSE == true)
-    {  
-      cout << "Requested Channel: " << name << " " << t0 << " - " << t1
-	   << " (" << samples << ")\n";
+  StripHistoryResult_clear (result);
+  result->t0 = *begin;
+  result->t1 = *end;
+  if (StripHistoryCache_lookup (shi->cache, name, tag, begin, end, result))
+    {
+      if(VERBOSE == true)
+        cout << "Requested Channel: " << name << " from cache ("
+             << result->n_points << ")\n";
+      result->fetch_stat = (result->n_points > 0)? FETCH_DONE : FETCH_NODATA;
+      return result->fetch_stat;
     }
-  
-  
-  struct timeval *times = new struct timeval[samples];
-  double *data = new double[samples];
-  short *status = new short[samples];
 
-  no_of_points = AccessChanArch(shi->archiveI, name, t0, t1, data, status, times, samples);
+  StripHistoryBuffer_init (&buffer, width);
+  if (!ReadChanArch(shi->archiveI, name, t0, t1, &buffer, deadline))
+    {
+      StripHistoryBuffer_free (&buffer);
+      result->fetch_stat = FETCH_NODATA;
+      return result->fetch_stat;
+    }
 
   if(VERBOSE == true)
     {  
       cout << "Requested Channel: " << name << " " << t0 << " - " << t1
-	   << "NoP= (" << no_of_points << ")\n";
+	   << "NoP= (" << buffer.n_points << ")\n";
     }
   
+  StripHistoryResult_append (result, StripHistoryBuffer_chunk (&buffer));
   
-  /* remember the request range */
-  result->t0 = *begin;
-  result->t1 = *end;
-
-  if ((compare_times (begin, &times[no_of_points-1]) <= 0) && 
-      (compare_times (end, &times[0]) >= 0) &&
+  if ((result->n_points > 0) &&
+      (compare_times (begin, &result->last->times[result->last->n_points-1]) <= 0) && 
+      (compare_times (end, &result->first->times[0]) >= 0) &&
       (compare_times (begin, end) <= 0)) 
     {
-      result->times = times; 
-      result->data = data;
-      result->status = status;
-      result->n_points = no_of_points; 
       result->fetch_stat = FETCH_DONE;
+      if (StripHistoryDeadline_left (deadline) > 0)
+        StripHistoryCache_store (shi->cache, name, tag, begin, end, result);
     }
   else
     { 
-      result->times = 0;
-      result->data = 0;
-      result->status = 0;
-      delete[] times;
-      delete[] data;
-      delete[] status;
+      StripHistoryResult_clear (result);
       result->fetch_stat = FETCH_NODATA;
     }
 
@@ -180,95 +210,76 @@ extern "C" FetchStatus     StripHistory_fetch      (StripHistory           the_s
 /* StripHistory_cancel
  */
 extern "C" void    StripHistory_cancel     (StripHistory           BOGUS(the_shi),
-					    StripHistoryResult     *BOGUS(result))
+					    StripHistoryResult     *result)
 {
+  StripHistory_cancel_sliced (result);
 }
 
 
 /* StripHistoryResult_release
  */
-void  StripHistoryResult_release    (StripHistory           BOGUS(the_shi),
+extern "C" void  StripHistoryResult_release    (StripHistory           BOGUS(the_shi),
                                      StripHistoryResult     *result)
 {
-  delete[] result->data;
-  delete[] result->times;
-  delete[] result->status;
+  StripHistory_cancel_sliced (result);
+  StripHistoryResult_clear (result);
 }
 
-size_t CountSamples(ArchiveI *archiveI, const stdString &channel_name, const osiTime &start, const osiTime &end)
-{
-  Archive archive (archiveI);
-  ChannelIterator channel(archive);
-  ValueIterator	value(archive);
-  size_t chunk_size=0, chunk_cumulative=0;
-
-  archive.findChannelByName (channel_name, channel);
-
-  channel->getValueAfterTime (start, value);
-
-  while (value && (end == nullTime  ||  value->getTime() < end))     
-    {
-      chunk_size = value.determineChunk(end);
-      for(int i = 0; i < chunk_size; i++) ++value;
-      chunk_cumulative += chunk_size;
-    }
-  
-  archive.detach();
-
-  chunk_cumulative += 2;
-  
-  return chunk_cumulative;
-}
 
-int AccessChanArch(ArchiveI *archiveI, const stdString &channel_name, const osiTime &start, const osiTime &end, double *data, short *status, struct timeval *times, size_t samples)
+bool ReadChanArch(ArchiveI *archiveI, const stdString &channel_name, const osiTime &start, const osiTime &end, StripHistoryBuffer *buffer, StripHistoryDeadline *deadline)
 {  
   Archive archive (archiveI);
   ChannelIterator channel(archive);
   ValueIterator	value(archive);
-  int i = 0;
+  struct timeval t;
+  size_t n = 0;
+  bool ok = true;
   
-  archive.findChannelByName (channel_name, channel);
+  if (!archive.findChannelByName (channel_name, channel))
+    {
+      archive.detach();
+      return false;
+    }
 
   channel->getValueAfterTime (start, value);
 
   if(!value)
     {
-      for(i = 0; i < 2; i++) status[i] &= ~DATASTAT_PLOTABLE;
-      times[0].tv_sec = start.getSec();
-      times[0].tv_usec = start.getUSec();
-      times[1].tv_sec = end.getSec();
-      times[1].tv_usec = start.getUSec();
+      t.tv_sec = start.getSec();
+      t.tv_usec = start.getUSec();
+      StripHistoryBuffer_add (buffer, &t, 0, 0);
+      t.tv_sec = end.getSec();
+      t.tv_usec = end.getUSec();
+      StripHistoryBuffer_add (buffer, &t, 0, 0);
       archive.detach();
-      return 2;
+      return true;
     }
 	  
-  while (value && (end == nullTime  ||  value->getTime() < end) && i < (samples - 1))
+  while (ok && value && (end == nullTime  ||  value->getTime() < end))
     {
+      // checking the clock for every sample would cost more than reading it
+      if ((++n % 1024 == 0) && StripHistoryDeadline_left(deadline) <= 0)
+	break;
+
+      t.tv_sec = value->getTime().getSec();
+      t.tv_usec = value->getTime().getUSec();      
       if(value->isInfo())
-	status[i] &= ~DATASTAT_PLOTABLE;
-      else {
-	data[i] = value->getDouble();	  
-	status[i] |= DATASTAT_PLOTABLE;
-      }
-      
-      times[i].tv_sec = value->getTime().getSec();
-      times[i].tv_usec = value->getTime().getUSec();      
+	ok = StripHistoryBuffer_add (buffer, &t, 0, 0);
+      else
+	ok = StripHistoryBuffer_add
+	  (buffer, &t, value->getDouble(), DATASTAT_PLOTABLE);
       
       ++value;
-      ++i;
     }
 
   //pad end with a ~DATASTAT_PLOTABLE to avoid interpolation
-  status[i] &= ~DATASTAT_PLOTABLE;
-  
-  times[i].tv_sec = end.getSec();
-  times[i].tv_usec = end.getUSec();
-  
-  //########################  
+  t.tv_sec = end.getSec();
+  t.tv_usec = end.getUSec();
+  StripHistoryBuffer_add (buffer, &t, 0, 0);
   
   archive.detach();
   
-  return ++i;
+  return true;
 }
 #undef NO_X11_HERE /* Albert */
 
@@ -40,22 +40,16 @@ extern "C" {
   using namespace std;
 #endif
 extern unsigned int historySize;
-// AccessChanArch does the actual data acquisition from the archiver
-int AccessChanArch(ArchiveI *, 
-		   const stdString &, 
-		   const osiTime &, 
-		   const osiTime &, 
-		   double *, 
-		   short *, 
-		   struct timeval *, 
-		   size_t);
-
-// CountSamples finds out how many distinct data points we have in the requested range 
-// in order to allocate memory properly
-size_t CountSamples(ArchiveI *, 
-		    const stdString &, 
-		    const osiTime &, 
-		    const osiTime &);
+// ReadChanArch reads the requested range from the archiver in one pass,
+// into the buffer, which reduces it to min/max per bin.  At the deadline
+// it stops, keeping the older part read so far.  Returns false if there
+// is no data in the range.
+bool ReadChanArch(ArchiveI *, 
+		  const stdString &, 
+		  const osiTime &, 
+		  const osiTime &, 
+		  StripHistoryBuffer *,
+		  StripHistoryDeadline *);
 
 static bool VERBOSE = false;
 
@@ -111,108 +105,69 @@ extern "C" void    CAR_delete     (StripHistoryInfo *shi)
 
 
 
-/* StripHistoryResult_release
- */
-extern "C" void  CAR_Result_release (StripHistoryResult     *result)
+bool ReadChanArch(ArchiveI *archiveI, const stdString &channel_name, const osiTime &start, const osiTime &end, StripHistoryBuffer *buffer, StripHistoryDeadline *deadline)
 {
- if(result->data)    delete[] result->data;
- if(result->times)   delete[] result->times;
- if(result->status)  delete[] result->status;
-}
-
-size_t CountSamples(ArchiveI *archiveI, const stdString &channel_name, const osiTime &start, const osiTime &end)
-{
-  size_t chunk_size=0, chunk_cumulative=0;
-
   Archive archive (archiveI);
   ChannelIterator channel(archive);
   ValueIterator	value(archive);
+  struct timeval t;
+  size_t n = 0;
+  bool ok = true;
+
   if(!archive.findChannelByName (channel_name, channel))
     {
       cout <<channel_name<<" is not in Archive"<<endl;
       archive.detach();
-      return 0;
+      return false;
     }
 
   channel->getValueAfterTime (start, value);
 
-  while (value && (end == nullTime  ||  value->getTime() < end))     
-    {
-      chunk_size = value.determineChunk(end);
-      for(size_t i = 0; i < chunk_size; i++) ++value;
-      chunk_cumulative += chunk_size;
-
-      if(chunk_cumulative > historySize) {
-	History_MessageBox_popup
-	  ("BIG REQUEST", 
-	   "Ok",
-	   "So many Data from Archiver\nPlease, decrease interval or increase # historyPoints.\n");	
-	archive.detach();
-	return 2;
-      }
-    }
-
-  archive.detach();
-  chunk_cumulative += 2;
-  return chunk_cumulative;
-}
-
-int AccessChanArch(ArchiveI *archiveI, const stdString &channel_name, const osiTime &start, const osiTime &end, double *data, short *status, struct timeval *times, size_t samples)
-{  
-  Archive archive (archiveI);
-  ChannelIterator channel(archive);
-  ValueIterator	value(archive);
-  size_t i = 0;
-  size_t real_count=0;
-  
-  archive.findChannelByName (channel_name, channel);
-  channel->getValueAfterTime (start, value);
-
-
-  if(!value) {
-    channel->getValueBeforeTime (start, value);
-    data[real_count] = value->getDouble();
-    times[real_count].tv_sec =  start.getSec() + 1;
-    times[real_count].tv_usec = 0;    
+  /* no data in the range */
+  if(!value || (end!=nullTime && !(value->getTime() <end))) {
     archive.detach();
-    return 1;
+    return false;
   }
  
   --value;
   if(value) { /* left fitting */
     if(DEBUG) cerr<< "left fitting OK" <<endl;
-    data[real_count] = value->getDouble();
-    if(DEBUG) cerr<< "right fitting val="<< data[real_count] <<endl;
-    times[real_count].tv_sec =  start.getSec()+1;
-    times[real_count].tv_usec = 0;            
-    ++real_count;
+    t.tv_sec =  start.getSec()+1;
+    t.tv_usec = 0;            
+    StripHistoryBuffer_add (buffer, &t, value->getDouble(), DATASTAT_PLOTABLE);
   } else  if(DEBUG) cerr<< "left fitting NO" <<endl;
   ++value;
 
-  while (value && (end==nullTime || value->getTime() <end)&& i< (samples - 1))
+  while (ok && value && (end==nullTime || value->getTime() <end))
     {
-      i++;
-      data[real_count] = value->getDouble();
-      times[real_count].tv_sec =  value->getTime().getSec();
-      times[real_count].tv_usec = value->getTime().getUSec();            
+      // checking the clock for every sample would cost more than reading it
+      if ((++n % 1024 == 0) && StripHistoryDeadline_left(deadline) <= 0)
+	break;
+      t.tv_sec =  value->getTime().getSec();
+      t.tv_usec = value->getTime().getUSec();            
+      ok = StripHistoryBuffer_add
+	(buffer, &t, value->getDouble(), DATASTAT_PLOTABLE);
       ++value;
-      ++real_count;
     }
 
-  if(value) {
+  if(value && (end==nullTime || !(value->getTime() <end))) {
     if(DEBUG) cerr<< "right fitting OK" <<endl;
-    data[real_count] = value->getDouble();
-    if(DEBUG)  cerr<< "right fitting val="<< data[real_count] <<endl;
-    times[real_count].tv_sec =  end.getSec() ;
-    times[real_count].tv_usec = 0;            
-    ++real_count;
+    t.tv_sec =  end.getSec() ;
+    t.tv_usec = 0;            
+    StripHistoryBuffer_add (buffer, &t, value->getDouble(), DATASTAT_PLOTABLE);
   } else if(DEBUG) cerr<< "right fitting NO" <<endl;
 
-
   archive.detach();
-  if(DEBUG) cerr<< "real_count=" <<real_count<< endl;
-  return real_count;
+  if(DEBUG) cerr<< "real_count=" <<buffer->n_points<< endl;
+  return true;
 }
+
+/* get_CAR_data
+ *
+ *      Reads [begin, end] into malloc()ed arrays, reduced to min/max of
+ *      about historySize/4 bins (see StripHistory_binwidth), which keeps
+ *      the result within historySize samples.
+ */
 extern "C" u_long get_CAR_data(        StripHistory   the_shi,
 		     char           *nameP,
 		     struct timeval *begin,
@@ -220,55 +175,44 @@ extern "C" u_long get_CAR_data(        StripHistory   the_shi,
 		     struct timeval **timesP,
 		     short          **statusP,
 		     double         **dataP,
-		     u_long *count)
+		     u_long *count,
+		     StripHistoryDeadline *deadline)
 {
   StripHistoryInfo *shi = (StripHistoryInfo *)the_shi;
-  size_t samples;
-  int no_of_p;
+  StripHistoryBuffer buffer;
+  bool found;
   stdString name=nameP;
   osiTime t0 = osiTime(begin->tv_sec, (begin->tv_usec * 1000));
   osiTime t1 = osiTime(end->tv_sec, (end->tv_usec * 1000));
+
+  StripHistoryBuffer_init
+    (&buffer, StripHistory_binwidth
+     (time2dbl (end) - time2dbl (begin), historySize / 4));
   try
     {
-      ArchiveI* arI=(ArchiveI*) shi->archiverInfo; 
-      samples = CountSamples((ArchiveI*) shi->archiverInfo, name, t0, t1);
-      if(VERBOSE == true)
-	{  
-	  cout << "Requested Channel: " << name << " " << t0 << " - " << t1
-	       << " (" << samples << ")\n";
-	}
+      found = ReadChanArch
+	((ArchiveI*) shi->archiverInfo, name, t0, t1, &buffer, deadline);
     }
   catch (ArchiveException &e)
     {
-      cerr<<"get_CAR_data:CountSamples problem " << e.what() <<endl;
+      LOG_MSG ("BinChannel::getValueAfterTime caught: " << e.what());
+      StripHistoryBuffer_free (&buffer);
       return (1);
     }
-#if 1
-  if(samples<=2) {
+  if(VERBOSE == true)
+    {  
+      cout << "Requested Channel: " << name << " " << t0 << " - " << t1
+	   << " (" << buffer.n_points << ")\n";
+    }
+  if(!found || buffer.n_points < 1) {
     if(VERBOSE == true) cout <<name<<" -no data in ChannelArchiver"<<endl;
+    StripHistoryBuffer_free (&buffer);
     return (1);
   }
-#endif
-  struct timeval *times = new struct timeval[samples];
-  double *data   = new double[samples];
-  short  *status = new  short[samples];
-  try
-    {     
-      no_of_p=AccessChanArch
-	((ArchiveI*) shi->archiverInfo,name,t0,t1,data,status,times,samples);
-      *timesP=times;
-      *statusP=status;
-      *dataP=data;
-      *count=no_of_p;
-    }
-  catch (ArchiveException &e)
-    {
-      LOG_MSG ("BinChannel::getValueAfterTime caught: " << e.what());
-      if(times)  free(times) ;
-      if(data)   free(data)  ;
-      if(status) free(status);
-      return (1);
-    }
+  *timesP=buffer.times;
+  *statusP=buffer.status;
+  *dataP=buffer.data;
+  *count=buffer.n_points;
   return(0);
 }
 
@@ -0,0 +1,528 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Chunk list handling for StripHistoryResult, shared by all the
+ * history modules. */
+
+#include "StripHistory.h"
+#include "StripDataSource.h"
+#include "StripMinMax.h"
+#include <math.h>
+
+static void     renumber        (StripHistoryResult *);
+static void     chunk_release   (StripHistoryChunk *);
+static int      buffer_put      (StripHistoryBuffer *, StripHistoryBinSample *);
+static int      buffer_flush    (StripHistoryBuffer *);
+
+/* StripHistoryChunk_new
+ */
+StripHistoryChunk       *StripHistoryChunk_new
+                        (struct timeval *times,
+                         double         *data,
+                         short          *status,
+                         int            n_points,
+                         void           (*free_func)(StripHistoryChunk *))
+{
+  StripHistoryChunk     *c;
+
+  if ((c = (StripHistoryChunk *)malloc (sizeof (StripHistoryChunk))) != NULL)
+  {
+    c->next             = 0;
+    c->prev             = 0;
+    c->times            = times;
+    c->data             = data;
+    c->status           = status;
+    c->n_points         = n_points;
+    c->offset           = 0;
+    c->summary          = 0;
+    c->free_func        = free_func;
+    c->free_arg[0]      = times;
+    c->free_arg[1]      = data;
+    c->free_arg[2]      = status;
+  }
+  else fprintf (stderr, "StripHistoryChunk_new: can't allocate memory\n");
+
+  return c;
+}
+
+
+/* StripHistoryChunk_free
+ */
+void    StripHistoryChunk_free          (StripHistoryChunk *c)
+{
+  int   i;
+
+  for (i = 0; i < 3; i++)
+    if (c->free_arg[i]) free (c->free_arg[i]);
+}
+
+
+/* StripHistoryResult_append
+ */
+void    StripHistoryResult_append       (StripHistoryResult     *result,
+                                         StripHistoryChunk      *c)
+{
+  if (!c) return;
+
+  if (c->n_points <= 0)
+  {
+    chunk_release (c);
+    return;
+  }
+
+  if (!result->first) result->n_points = 0;
+
+  c->next = 0;
+  c->prev = result->last;
+  c->offset = (size_t)result->n_points;
+
+  if (result->last) result->last->next = c;
+  else result->first = c;
+  result->last = c;
+
+  result->n_points += c->n_points;
+}
+
+
+/* StripHistoryResult_clear
+ */
+void    StripHistoryResult_clear        (StripHistoryResult *result)
+{
+  StripHistoryChunk     *c, *next;
+
+  for (c = result->first; c; c = next)
+  {
+    next = c->next;
+    chunk_release (c);
+  }
+
+  result->first = 0;
+  result->last = 0;
+  result->n_points = 0;
+}
+
+
+/* StripHistoryResult_locate
+ */
+StripHistoryChunk       *StripHistoryResult_locate
+                        (StripHistoryResult     *result,
+                         size_t                 idx,
+                         size_t                 *local)
+{
+  StripHistoryChunk     *c;
+
+  if (!result->first || (idx >= (size_t)result->n_points)) return 0;
+
+  /* searches are mostly near either end, so start from the closer one */
+  if (idx >= (size_t)result->n_points / 2)
+  {
+    for (c = result->last; c && (c->offset > idx); c = c->prev);
+  }
+  else
+  {
+    for (c = result->first;
+         c && (idx >= c->offset + (size_t)c->n_points);
+         c = c->next);
+  }
+
+  if (c && local) *local = idx - c->offset;
+  return c;
+}
+
+
+/* StripHistoryResult_splice
+ */
+void    StripHistoryResult_splice       (StripHistoryResult     *result,
+                                         StripHistoryResult     *part)
+{
+  StripHistoryChunk     *c, *next, *head = 0, *tail = 0;
+  struct timeval        limit;
+  int                   before, i;
+
+  if (!part->first) return;
+
+  if (!result->first)
+  {
+    head = part->first;
+    tail = part->last;
+  }
+  else
+  {
+    /* does part come before the result's data? */
+    before = (compare_times (&part->first->times[0],
+                             &result->first->times[0]) < 0);
+    if (before) limit = result->first->times[0];
+    else limit = result->last->times[result->last->n_points-1];
+
+    for (c = part->first; c; c = next)
+    {
+      next = c->next;
+      if (before)       /* keep the samples before limit */
+      {
+        for (i = 0;
+             (i < c->n_points) && (compare_times (&c->times[i], &limit) < 0);
+             i++);
+        c->n_points = i;
+      }
+      else              /* keep the samples after limit */
+      {
+        for (i = 0;
+             (i < c->n_points) && (compare_times (&c->times[i], &limit) <= 0);
+             i++);
+        c->times += i;
+        c->data += i;
+        c->status += i;
+        c->n_points -= i;
+      }
+
+      if (c->n_points <= 0)
+      {
+        chunk_release (c);
+        continue;
+      }
+      c->prev = tail;
+      c->next = 0;
+      if (tail) tail->next = c;
+      else head = c;
+      tail = c;
+    }
+
+    if (head && before)
+    {
+      tail->next = result->first;
+      result->first->prev = tail;
+      tail = result->last;
+    }
+    else if (head)
+    {
+      head->prev = result->last;
+      result->last->next = head;
+      head = result->first;
+    }
+    else
+    {
+      head = result->first;
+      tail = result->last;
+    }
+  }
+
+  result->first = head;
+  result->last = tail;
+  renumber (result);
+
+  part->first = 0;
+  part->last = 0;
+  part->n_points = 0;
+}
+
+
+/* StripHistoryResult_drop
+ */
+void    StripHistoryResult_drop         (StripHistoryResult     *result,
+                                         struct timeval         *t0,
+                                         struct timeval         *t1)
+{
+  StripHistoryChunk     *c;
+
+  while ((c = result->first) &&
+         (compare_times (&c->times[c->n_points-1], t0) < 0))
+  {
+    result->first = c->next;
+    chunk_release (c);
+  }
+  if (result->first) result->first->prev = 0;
+  else result->last = 0;
+
+  while ((c = result->last) && (compare_times (&c->times[0], t1) > 0))
+  {
+    result->last = c->prev;
+    chunk_release (c);
+  }
+  if (result->last) result->last->next = 0;
+  else result->first = 0;
+
+  if (compare_times (&result->t0, t0) < 0) result->t0 = *t0;
+  if (compare_times (&result->t1, t1) > 0) result->t1 = *t1;
+  renumber (result);
+}
+
+
+/* StripHistoryResult_copy
+ */
+void    StripHistoryResult_copy         (StripHistoryResult     *result,
+                                         StripHistoryResult     *src,
+                                         struct timeval         *t0,
+                                         struct timeval         *t1)
+{
+  StripHistoryChunk     *c;
+  struct timeval        *times;
+  double                *data;
+  short                 *status;
+  int                   i, n;
+
+  for (n = 0, c = src->first; c; c = c->next)
+    for (i = 0; i < c->n_points; i++)
+      if ((compare_times (&c->times[i], t0) >= 0) &&
+          (compare_times (&c->times[i], t1) <= 0))
+        n++;
+  if (n == 0) return;
+
+  times = (struct timeval *)malloc (n * sizeof (struct timeval));
+  data = (double *)malloc (n * sizeof (double));
+  status = (short *)malloc (n * sizeof (short));
+  if (!times || !data || !status)
+  {
+    fprintf (stderr, "StripHistoryResult_copy: can't allocate memory\n");
+    if (times) free (times);
+    if (data) free (data);
+    if (status) free (status);
+    return;
+  }
+
+  for (n = 0, c = src->first; c; c = c->next)
+    for (i = 0; i < c->n_points; i++)
+      if ((compare_times (&c->times[i], t0) >= 0) &&
+          (compare_times (&c->times[i], t1) <= 0))
+      {
+        times[n] = c->times[i];
+        data[n] = c->data[i];
+        status[n] = c->status[i];
+        n++;
+      }
+
+  StripHistoryResult_append
+    (result, StripHistoryChunk_new
+     (times, data, status, n, StripHistoryChunk_free));
+}
+
+
+/* StripHistoryResult_min_max
+ */
+int     StripHistoryResult_min_max      (StripHistoryResult     *result,
+                                         size_t                 first,
+                                         size_t                 last,
+                                         double                 *min,
+                                         double                 *max)
+{
+  StripHistoryChunk     *c;
+  size_t                j, k;
+  int                   found = 0;
+
+  if (!(c = StripHistoryResult_locate (result, first, &j))) return 0;
+
+  for (; c && (c->offset <= last); c = c->next, j = 0)
+  {
+    if (!StripMinMax_valid (c->summary, c->data, c->n_points))
+    {
+      StripMinMax_delete (c->summary);
+      c->summary = StripMinMax_build (c->data, c->status, c->n_points);
+    }
+    k = min (last - c->offset, (size_t)c->n_points - 1);
+    if (c->summary)
+      found |= StripMinMax_range
+        (c->summary, c->data, c->status, (int)j, (int)k, -1, min, max);
+    else for (; j <= k; j++)
+      if (c->status[j] & DATASTAT_PLOTABLE)
+      {
+        if (c->data[j] < *min) *min = c->data[j];
+        if (c->data[j] > *max) *max = c->data[j];
+        found = 1;
+      }
+  }
+
+  return found;
+}
+
+
+/* StripHistoryBuffer_init
+ */
+void    StripHistoryBuffer_init         (StripHistoryBuffer     *b,
+                                         double                 bin_width)
+{
+  memset (b, 0, sizeof (StripHistoryBuffer));
+  b->bin_width = (bin_width > 0)? bin_width : 0;
+}
+
+
+/* StripHistoryBuffer_add
+ */
+int     StripHistoryBuffer_add          (StripHistoryBuffer     *b,
+                                         struct timeval         *t,
+                                         double                 value,
+                                         short                  status)
+{
+  StripHistoryBinSample x;
+  double                bin;
+
+  x.t = *t;
+  x.value = value;
+  x.status = status;
+  x.seq = b->seq++;
+
+  if ((b->bin_width <= 0) || !(status & DATASTAT_PLOTABLE))
+    return buffer_flush (b) && buffer_put (b, &x);
+
+  bin = floor (time2dbl (t) / b->bin_width);
+  if (b->in_bin && (bin != b->bin) && !buffer_flush (b)) return 0;
+
+  if (!b->in_bin)
+  {
+    b->bin = bin;
+    b->first = b->min = b->max = x;
+  }
+  else if (value < b->min.value) b->min = x;
+  else if (value > b->max.value) b->max = x;
+  b->last = x;
+  b->in_bin++;
+
+  return 1;
+}
+
+
+/* StripHistoryBuffer_chunk
+ */
+StripHistoryChunk       *StripHistoryBuffer_chunk       (StripHistoryBuffer *b)
+{
+  StripHistoryChunk     *c;
+
+  buffer_flush (b);
+  c = StripHistoryChunk_new
+    (b->times, b->data, b->status, b->n_points, StripHistoryChunk_free);
+  if (!c) StripHistoryBuffer_free (b);
+  StripHistoryBuffer_init (b, b->bin_width);
+  return c;
+}
+
+
+/* StripHistoryBuffer_free
+ */
+void    StripHistoryBuffer_free         (StripHistoryBuffer *b)
+{
+  if (b->times) free (b->times);
+  if (b->data) free (b->data);
+  if (b->status) free (b->status);
+  StripHistoryBuffer_init (b, b->bin_width);
+}
+
+
+/* StripHistory_binwidth
+ */
+double  StripHistory_binwidth           (double span, int n_bins)
+{
+  double        width = 1.0 / 1024;
+
+  if (n_bins <= 0) return 0;
+  while (width * n_bins < span) width *= 2;
+  return width;
+}
+
+
+/* buffer_put
+ *
+ *      Appends a sample to the arrays, doubling them when full.
+ */
+static int      buffer_put      (StripHistoryBuffer *b, StripHistoryBinSample *x)
+{
+  int           size;
+  void          *p;
+
+  if (b->n_points >= b->size)
+  {
+    size = b->size? 2 * b->size : 1024;
+    if (!(p = realloc (b->times, size * sizeof (struct timeval)))) goto nomem;
+    b->times = (struct timeval *)p;
+    if (!(p = realloc (b->data, size * sizeof (double)))) goto nomem;
+    b->data = (double *)p;
+    if (!(p = realloc (b->status, size * sizeof (short)))) goto nomem;
+    b->status = (short *)p;
+    b->size = size;
+  }
+
+  b->times[b->n_points] = x->t;
+  b->data[b->n_points] = x->value;
+  b->status[b->n_points] = x->status;
+  b->n_points++;
+  return 1;
+
+ nomem:
+  fprintf (stderr, "StripHistoryBuffer_add: can't allocate memory\n");
+  return 0;
+}
+
+
+/* buffer_flush
+ *
+ *      Writes out the samples kept for the current bin, in time order.
+ */
+static int      buffer_flush    (StripHistoryBuffer *b)
+{
+  StripHistoryBinSample *x[4], *tmp;
+  int                   i, j;
+
+  if (!b->in_bin) return 1;
+  b->in_bin = 0;
+
+  x[0] = &b->first;
+  x[1] = &b->min;
+  x[2] = &b->max;
+  x[3] = &b->last;
+  for (i = 1; i < 4; i++)
+    for (j = i; (j > 0) && (x[j-1]->seq > x[j]->seq); j--)
+    {
+      tmp = x[j]; x[j] = x[j-1]; x[j-1] = tmp;
+    }
+
+  for (i = 0; i < 4; i++)
+    if ((i == 0) || (x[i]->seq != x[i-1]->seq))
+      if (!buffer_put (b, x[i])) return 0;
+  return 1;
+}
+
+
+/* renumber
+ *
+ *      Recomputes the chunk offsets and the result's sample count.
+ */
+static void     renumber        (StripHistoryResult *result)
+{
+  StripHistoryChunk     *c;
+
+  result->n_points = 0;
+  for (c = result->first; c; c = c->next)
+  {
+    c->offset = (size_t)result->n_points;
+    result->n_points += c->n_points;
+  }
+}
+
+
+/* chunk_release
+ */
+static void     chunk_release   (StripHistoryChunk *c)
+{
+  if (c->free_func) c->free_func (c);
+  StripMinMax_delete (c->summary);
+  free (c);
+}
+
+
+/* **************************** Emacs Editing Sequences ***************** */
+/* Local Variables: */
+/* tab-width: 6 */
+/* c-basic-offset: 2 */
+/* c-comment-only-line-offset: 0 */
+/* c-indent-comments-syntactically-p: t */
+/* c-label-minimum-indentation: 1 */
+/* c-file-offsets: ((substatement-open . 0) (label . 2) */
+/* (brace-entry-open . 0) (label .2) (arglist-intro . +) */
+/* (arglist-cont-nonempty . c-lineup-arglist) ) */
+/* End: */
+
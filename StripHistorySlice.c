@@ -0,0 +1,407 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Request handling shared by the history modules: time limits, and
+ * progressive delivery of history data.
+ *
+ * A request is split into time slices which are fetched, newest first,
+ * from Xt timeouts.  The first slice covers 1/STRIP_HISTORY_SLICES of the
+ * range, and each following slice is twice as wide as the one before, so
+ * the newest data shows up almost at once while the whole range still
+ * takes only a few backend calls.  After each slice the client callback
+ * is invoked; the result remains FETCH_PENDING until the last slice is
+ * in.  Since slices are prepended, a client joining new data onto the
+ * data it has already drawn only needs to draw the new slice.
+ *
+ * Interactive navigation (dragging, zooming, the From/To dialog) issues
+ * a new request for every step.  So the first slice waits for a settle
+ * interval (STRIP_HISTORY_SETTLE), during which a request superseded by
+ * a newer one for the same result is dropped without ever reaching the
+ * archiver.  And when pending requests for the same channel (from other
+ * curves or windows) are due to fetch overlapping slices, the archiver is
+ * asked once, for the union, and each request gets a copy of its part.
+ *
+ * Blocking fetches may also come from the data export thread.  The
+ * history modules aren't reentrant, so the backend calls are serialized
+ * by a lock; a slice which finds it taken is tried again shortly, rather
+ * than holding up the Xt thread.  The export thread never touches the
+ * list of sliced requests: its results are never pending.
+ *
+ * A request which runs out of time, or whose slice fails, stops there.
+ * Its result is FETCH_PARTIAL, and starts at the oldest slice fetched in
+ * full, so that the client asks for the rest again.
+ */
+
+#include "StripHistory.h"
+
+#ifndef WIN32
+#include <pthread.h>
+
+static pthread_mutex_t  backend_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define BACKEND_LOCK()          pthread_mutex_lock (&backend_lock)
+#define BACKEND_TRYLOCK()       (pthread_mutex_trylock (&backend_lock) == 0)
+#define BACKEND_UNLOCK()        pthread_mutex_unlock (&backend_lock)
+#else
+#define BACKEND_LOCK()
+#define BACKEND_TRYLOCK()       1
+#define BACKEND_UNLOCK()
+#endif
+
+typedef struct _SliceRequest
+{
+  struct _SliceRequest  *next;
+  Strip                 strip;
+  StripHistory          shi;
+  StripHistorySyncFetch fetch;
+  char                  name[STRIP_MAX_NAME_CHAR+1];
+  struct timeval        begin;          /* start of the whole request */
+  struct timeval        cursor;         /* data is in on [cursor, end] */
+  double                width;          /* width of the next slice */
+  StripHistoryResult    *result;
+  StripHistoryCallback  callback;
+  void                  *call_data;
+  XtIntervalId          id;
+  StripHistoryDeadline  deadline;
+  struct timeval        t0;             /* start of the slice being fetched */
+}
+SliceRequest;
+
+/* at most this many requests share a fetch */
+#define SLICE_MERGE_MAX         16
+
+/* seconds before a slice tries again for the backend */
+#define SLICE_RETRY             0.1
+
+static SliceRequest     *pending = 0;
+static double           timeout = -1;   /* < 0: not initialized */
+static double           settle = -1;
+
+static void     slice_step      (XtPointer, XtIntervalId *);
+static void     slice_advance   (SliceRequest *, int);
+static void     slice_unlink    (SliceRequest *);
+static double   settle_time     (void);
+
+
+/* StripHistory_fetch_sliced
+ */
+FetchStatus     StripHistory_fetch_sliced       (Strip                  strip,
+                                                 StripHistory           shi,
+                                                 StripHistorySyncFetch  fetch,
+                                                 char                   *name,
+                                                 struct timeval         *begin,
+                                                 struct timeval         *end,
+                                                 StripHistoryResult     *result,
+                                                 StripHistoryCallback   callback,
+                                                 void                   *call_data)
+{
+  SliceRequest          *req;
+  StripHistoryDeadline  deadline;
+  FetchStatus           stat;
+
+  StripHistory_cancel_sliced (result);
+
+  if (!callback || !strip ||
+      !(req = (SliceRequest *)malloc (sizeof (SliceRequest))))
+  {
+    StripHistoryResult_clear (result);
+    StripHistoryDeadline_init (&deadline, StripHistory_gettimeout ());
+    deadline.span = time2dbl (end) - time2dbl (begin);
+    BACKEND_LOCK();
+    stat = fetch (shi, name, begin, end, result, &deadline);
+    BACKEND_UNLOCK();
+    return stat;
+  }
+
+  req->strip = strip;
+  req->shi = shi;
+  req->fetch = fetch;
+  strncpy (req->name, name, STRIP_MAX_NAME_CHAR);
+  req->name[STRIP_MAX_NAME_CHAR] = 0;
+  req->begin = *begin;
+  req->cursor = *end;
+  req->width = (time2dbl (end) - time2dbl (begin)) / STRIP_HISTORY_SLICES;
+  req->result = result;
+  req->callback = callback;
+  req->call_data = call_data;
+  StripHistoryDeadline_init (&req->deadline, StripHistory_gettimeout ());
+  req->deadline.span = time2dbl (end) - time2dbl (begin);
+
+  StripHistoryResult_clear (result);
+  result->t0 = *begin;
+  result->t1 = *end;
+  result->fetch_stat = FETCH_PENDING;
+
+  req->next = pending;
+  pending = req;
+  req->id = Strip_addtimeout (strip, settle_time (), slice_step, (XtPointer)req);
+
+  return FETCH_PENDING;
+}
+
+
+/* StripHistory_cancel_sliced
+ */
+void    StripHistory_cancel_sliced      (StripHistoryResult *result)
+{
+  SliceRequest  *req;
+
+  /* only pending results are on the list */
+  if (result->fetch_stat != FETCH_PENDING) return;
+
+  for (req = pending; req && (req->result != result); req = req->next);
+  if (!req) return;
+
+  req->deadline.cancelled = 1;
+  if (req->id) XtRemoveTimeOut (req->id);
+  slice_unlink (req);
+  free (req);
+
+  /* the range isn't covered, so make sure it gets requested again */
+  if (result->fetch_stat == FETCH_PENDING) result->fetch_stat = FETCH_IDLE;
+}
+
+
+/* slice_step
+ *
+ *      Fetches the next slice, along with the overlapping slices of other
+ *      requests for the channel, and passes them on to the clients.  Note
+ *      that a client callback may well cancel or restart any request, so
+ *      the requests must not be touched once the callbacks have started.
+ */
+static void     slice_step      (XtPointer arg, XtIntervalId *BOGUS(id))
+{
+  SliceRequest          *req = (SliceRequest *)arg;
+  SliceRequest          *group[SLICE_MERGE_MAX], *other;
+  StripHistoryResult    *results[SLICE_MERGE_MAX];
+  StripHistoryCallback  callbacks[SLICE_MERGE_MAX];
+  void                  *call_data[SLICE_MERGE_MAX];
+  StripHistoryResult    all, part;
+  struct timeval        lo, hi;
+  int                   i, n = 0, failed;
+
+  /* the export thread is using the backend */
+  if (!BACKEND_TRYLOCK())
+  {
+    req->id = Strip_addtimeout (req->strip, SLICE_RETRY, slice_step, arg);
+    return;
+  }
+
+  req->id = 0;
+  dbl2time (&req->t0, time2dbl (&req->cursor) - req->width);
+  if (compare_times (&req->t0, &req->begin) < 0) req->t0 = req->begin;
+  lo = req->t0;
+  hi = req->cursor;
+  group[n++] = req;
+
+  for (other = pending; other && (n < SLICE_MERGE_MAX); other = other->next)
+  {
+    if ((other == req) || !other->id || (other->fetch != req->fetch) ||
+        strcmp (other->name, req->name))
+      continue;
+
+    dbl2time (&other->t0, time2dbl (&other->cursor) - other->width);
+    if (compare_times (&other->t0, &other->begin) < 0)
+      other->t0 = other->begin;
+    if ((compare_times (&other->t0, &hi) > 0) ||
+        (compare_times (&other->cursor, &lo) < 0))
+      continue;
+
+    XtRemoveTimeOut (other->id);
+    other->id = 0;
+    if (compare_times (&other->t0, &lo) < 0) lo = other->t0;
+    if (compare_times (&other->cursor, &hi) > 0) hi = other->cursor;
+    group[n++] = other;
+  }
+
+  memset (&all, 0, sizeof (all));
+  failed = (req->fetch (req->shi, req->name, &lo, &hi, &all, &req->deadline)
+            == FETCH_PARTIAL);
+  BACKEND_UNLOCK();
+
+  /* of a failed fetch, only what it covers up to hi is of use */
+  if (failed)
+    lo = (compare_times (&all.t1, &hi) < 0)? hi : all.t0;
+
+  for (i = 0; i < n; i++)
+  {
+    /* whatever of the union a request still needs is its slice */
+    group[i]->t0 = (compare_times (&lo, &group[i]->begin) > 0)?
+      lo : group[i]->begin;
+    if (compare_times (&group[i]->t0, &group[i]->cursor) > 0)
+      group[i]->t0 = group[i]->cursor;
+
+    if ((n == 1) && !failed) StripHistoryResult_splice (req->result, &all);
+    else if (compare_times (&group[i]->t0, &group[i]->cursor) < 0)
+    {
+      memset (&part, 0, sizeof (part));
+      StripHistoryResult_copy (&part, &all, &group[i]->t0, &group[i]->cursor);
+      StripHistoryResult_splice (group[i]->result, &part);
+      StripHistoryResult_clear (&part);
+    }
+    results[i] = group[i]->result;
+    callbacks[i] = group[i]->callback;
+    call_data[i] = group[i]->call_data;
+    slice_advance (group[i], failed);
+  }
+  StripHistoryResult_clear (&all);
+
+  for (i = 0; i < n; i++) callbacks[i] (results[i], call_data[i]);
+}
+
+
+/* slice_advance
+ *
+ *      Moves the request on past the slice just fetched, and either
+ *      schedules the next slice or, if that was the last, or the slice
+ *      failed, or time is up, disposes of the request.
+ */
+static void     slice_advance   (SliceRequest *req, int failed)
+{
+  StripHistoryResult    *result = req->result;
+  int                   stop = 0;
+
+  req->cursor = req->t0;
+  req->width *= 2;
+
+  /* keep what we have, marked as covering [cursor, end] only */
+  if (compare_times (&req->cursor, &req->begin) > 0)
+  {
+    if (StripHistoryDeadline_left (&req->deadline) <= 0)
+    {
+      fprintf (stderr, "%s: history request timed out\n", req->name);
+      stop = 1;
+    }
+    else if (failed)
+    {
+      fprintf (stderr, "%s: history request failed\n", req->name);
+      stop = 1;
+    }
+  }
+
+  if (stop)
+  {
+    result->t0 = req->cursor;
+    result->fetch_stat = FETCH_PARTIAL;
+  }
+  else if (compare_times (&req->cursor, &req->begin) <= 0)      /* all done */
+    result->fetch_stat = (result->n_points > 0)? FETCH_DONE : FETCH_NODATA;
+  else
+  {
+    req->id = Strip_addtimeout (req->strip, 0, slice_step, (XtPointer)req);
+    return;
+  }
+
+  slice_unlink (req);
+  free (req);
+}
+
+
+/* StripHistoryDeadline_init
+ */
+void    StripHistoryDeadline_init       (StripHistoryDeadline   *d,
+                                         double                 seconds)
+{
+  struct timeval        now;
+
+  d->none = (seconds <= 0);
+  d->cancelled = 0;
+  d->span = 0;
+  get_current_time (&now);
+  dbl2time (&d->t, time2dbl (&now) + (d->none? 0 : seconds));
+}
+
+
+/* StripHistoryDeadline_left
+ */
+double  StripHistoryDeadline_left       (StripHistoryDeadline *d)
+{
+  struct timeval        now;
+  double                left;
+
+  if (!d) return STRIP_HISTORY_FOREVER;
+  if (d->cancelled) return 0;
+  if (d->none) return STRIP_HISTORY_FOREVER;
+
+  get_current_time (&now);
+  left = time2dbl (&d->t) - time2dbl (&now);
+  return (left > 0)? left : 0;
+}
+
+
+/* StripHistory_settimeout
+ */
+void    StripHistory_settimeout         (double seconds)
+{
+  timeout = (seconds > 0)? seconds : 0;
+}
+
+
+/* StripHistory_gettimeout
+ */
+double  StripHistory_gettimeout         (void)
+{
+  char  *env;
+
+  if (timeout < 0)
+  {
+    timeout = STRIP_HISTORY_TIMEOUT;
+    if ((env = getenv (STRIP_HISTORY_TIMEOUT_ENV)) && *env)
+      timeout = atof (env);
+    if (timeout < 0) timeout = 0;
+  }
+  return timeout;
+}
+
+
+/* settle_time
+ *
+ *      Seconds a new request waits before its first fetch; taken from
+ *      STRIP_HISTORY_SETTLE.
+ */
+static double   settle_time     (void)
+{
+  char  *env;
+
+  if (settle < 0)
+  {
+    settle = STRIP_HISTORY_SETTLE;
+    if ((env = getenv (STRIP_HISTORY_SETTLE_ENV)) && *env)
+      settle = atof (env);
+    if (settle < 0) settle = 0;
+  }
+  return settle;
+}
+
+
+static void     slice_unlink    (SliceRequest *req)
+{
+  SliceRequest  **p;
+
+  for (p = &pending; *p; p = &(*p)->next)
+    if (*p == req)
+    {
+      *p = req->next;
+      break;
+    }
+}
+
+/* **************************** Emacs Editing Sequences ***************** */
+/* Local Variables: */
+/* tab-width: 6 */
+/* c-basic-offset: 2 */
+/* c-comment-only-line-offset: 0 */
+/* c-indent-comments-syntactically-p: t */
+/* c-label-minimum-indentation: 1 */
+/* c-file-offsets: ((substatement-open . 0) (label . 2) */
+/* (brace-entry-open . 0) (label .2) (arglist-intro . +) */
+/* (arglist-cont-nonempty . c-lineup-arglist) ) */
+/* End: */
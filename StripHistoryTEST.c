@@ -6,13 +6,46 @@
 * Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
 * Gemelnschaft (DESY).
 * This file is distributed subject to a Software License Agreement found
-* in the file LICENSE that is included with this distribution. 
+* in the file LICENSE that is included with this distribution.
 \*************************************************************************/
 
+/* Synthetic archive for testing the history path without an archiver.
+ *
+ * Every channel is sampled on a fixed grid (multiples of the period
+ * since 1970), and the value at a grid time depends only on the channel
+ * name and that time, so any two fetches agree on the samples they have
+ * in common.  The following environment variables control the archive:
+ *
+ *   STRIP_HISTORY_TEST_PERIOD      seconds between samples (1)
+ *   STRIP_HISTORY_TEST_MAX_POINTS  if a range holds more samples, only
+ *                                  every n-th grid point is returned (0:
+ *                                  no limit)
+ *   STRIP_HISTORY_TEST_LATENCY     milliseconds each fetch takes (0)
+ *   STRIP_HISTORY_TEST_JITTER      random +/- milliseconds of latency (0)
+ *   STRIP_HISTORY_TEST_FAILURE     probability of a failed fetch (0)
+ *   STRIP_HISTORY_TEST_GAP_PERIOD, STRIP_HISTORY_TEST_GAP_LENGTH
+ *                                  there is no data during the first
+ *                                  GAP_LENGTH seconds of every GAP_PERIOD
+ *                                  (0: no gaps); the archive marks the
+ *                                  start of a gap with a non-plotable
+ *                                  sample
+ *   STRIP_HISTORY_TEST_SEED        seed for jitter and failures
+ */
+
 #include "StripHistory.h"
 #include "StripDataSource.h"
 #include <math.h>
 
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#define MY_PI           3.14159265358979323846
+
 /* StripHistoryInfo
  *
  *      Contains instance data for the archive service.
@@ -20,20 +53,50 @@
 typedef struct _StripHistoryInfo
 {
   Strip         strip;
+  double        period;
+  double        max_points;
+  double        latency;        /* seconds */
+  double        jitter;         /* seconds */
+  double        failure;
+  double        gap_period;
+  double        gap_length;
+  unsigned long seed;
 }
 StripHistoryInfo;
 
 
+static FetchStatus      fetch_range     (StripHistory, char *,
+                                         struct timeval *, struct timeval *,
+                                         StripHistoryResult *,
+                                         StripHistoryDeadline *);
+static double           env_value       (char *, double);
+static double           next_random     (StripHistoryInfo *);
+static void             delay           (double);
+static unsigned long    hash_name       (char *);
+static double           sample_value    (unsigned long, double, double);
+static int              in_gap          (StripHistoryInfo *, double);
+
+
 /* StripHistory_init
  */
 StripHistory    StripHistory_init       (Strip strip)
 {
   StripHistoryInfo      *shi = 0;
 
-  if (shi = (StripHistoryInfo *)malloc (sizeof(StripHistoryInfo)))
+  if ((shi = (StripHistoryInfo *)malloc (sizeof(StripHistoryInfo))))
   {
     shi->strip = strip;
+    shi->period = env_value (STRIP_HISTORY_TEST_PERIOD_ENV, 1.0);
+    if (shi->period <= 0) shi->period = 1.0;
+    shi->max_points = env_value (STRIP_HISTORY_TEST_MAX_POINTS_ENV, 0);
+    shi->latency = env_value (STRIP_HISTORY_TEST_LATENCY_ENV, 0) / 1000.0;
+    shi->jitter = env_value (STRIP_HISTORY_TEST_JITTER_ENV, 0) / 1000.0;
+    shi->failure = env_value (STRIP_HISTORY_TEST_FAILURE_ENV, 0);
+    shi->gap_period = env_value (STRIP_HISTORY_TEST_GAP_PERIOD_ENV, 0);
+    shi->gap_length = env_value (STRIP_HISTORY_TEST_GAP_LENGTH_ENV, 0);
+    shi->seed = (unsigned long)env_value (STRIP_HISTORY_TEST_SEED_ENV, 1);
   }
+  else fprintf (stderr, "StripHistory_init: can't allocate memory\n");
 
   return (StripHistory)shi;
 }
@@ -59,72 +122,194 @@ FetchStatus     StripHistory_fetch      (StripHistory           the_shi,
                                          StripHistoryCallback   callback,
                                          void                   *call_data)
 {
-#define MAX_ITEMS       1024
-#define MY_PI           3.14159265358979323846
+  StripHistoryInfo      *shi = (StripHistoryInfo *)the_shi;
 
-  static struct timeval times[MAX_ITEMS];
-  static double         data[MAX_ITEMS];
-  static short          status[MAX_ITEMS];
-  static int            init = 0;
+  return StripHistory_fetch_sliced
+    (shi->strip, the_shi, fetch_range, name, begin, end, result,
+     callback, call_data);
+}
 
-  struct timeval        tv;
-  double                x;
-  int                   i;
 
-  gettimeofday (&tv, 0);
-  fprintf (stdout, "sec: %d, usec: %u\n", tv.tv_sec, tv.tv_usec);
+/* fetch_range
+ *
+ *      Blocking fetch of [begin, end].  The latency is cut short at the
+ *      deadline, in which case, as for a failed fetch, nothing is
+ *      returned and nothing is covered.
+ */
+static FetchStatus      fetch_range     (StripHistory           the_shi,
+                                         char                   *name,
+                                         struct timeval         *begin,
+                                         struct timeval         *end,
+                                         StripHistoryResult     *result,
+                                         StripHistoryDeadline   *deadline)
+{
+  StripHistoryInfo      *shi = (StripHistoryInfo *)the_shi;
+  struct timeval        *times;
+  double                *data;
+  short                 *status;
+  double                k, k0, k1, stride, t, latency;
+  unsigned long         h;
+  int                   n, max_n;
+
+  /* remember the request range */
+  StripHistoryResult_clear (result);
+  result->t0 = *begin;
+  result->t1 = *end;
+  result->fetch_stat = FETCH_NODATA;
 
-  if (!init)
+  latency = shi->latency + shi->jitter * (2 * next_random (shi) - 1);
+  if (latency > StripHistoryDeadline_left (deadline))
   {
-    for (i = 0; i < MAX_ITEMS; i++)
-    {
-      x = i / (double)MAX_ITEMS;
-      x *= 10 * 2 * MY_PI;              /* 10 complete sine waves over range */
-      data[i] = sin (x) * 10;
-      status[i] = DATASTAT_PLOTABLE;
-
-      x = subtract_times (&times[i], begin, end);
-      x = i * (x / MAX_ITEMS);
-      x += time2dbl (begin);
-      dbl2time (&times[i], x);
-    }
+    delay (StripHistoryDeadline_left (deadline));
+    result->t0 = *end;
+    result->fetch_stat = FETCH_PARTIAL;
+    return result->fetch_stat;
+  }
+  delay (latency);
+
+  if (next_random (shi) < shi->failure)
+  {
+    result->t0 = *end;
+    result->fetch_stat = FETCH_PARTIAL;
+    return result->fetch_stat;
+  }
+  if (compare_times (begin, end) > 0) return result->fetch_stat;
+
+  /* grid points on [begin, end], thinned out to at most max_points */
+  k0 = ceil (time2dbl (begin) / shi->period);
+  k1 = floor (time2dbl (end) / shi->period);
+  if (k1 < k0) return result->fetch_stat;
 
-    init = 1;
+  stride = 1;
+  if ((shi->max_points > 0) && (k1 - k0 + 1 > shi->max_points))
+    stride = ceil ((k1 - k0 + 1) / shi->max_points);
+  k0 = ceil (k0 / stride) * stride;     /* same grid for every request */
+  if (k1 < k0) return result->fetch_stat;
+
+  max_n = (int)((k1 - k0) / stride) + 1;
+  times = (struct timeval *)malloc (max_n * sizeof (struct timeval));
+  data = (double *)malloc (max_n * sizeof (double));
+  status = (short *)malloc (max_n * sizeof (short));
+  if (!times || !data || !status)
+  {
+    fprintf (stderr, "StripHistory_fetch: can't allocate memory\n");
+    if (times) free (times);
+    if (data) free (data);
+    if (status) free (status);
+    return result->fetch_stat;
   }
 
-  /* remember the request range */
-  result->t0 = *begin;
-  result->t1 = *end;
-    
-  if ((compare_times (begin, &times[MAX_ITEMS-1]) <= 0) &&
-      (compare_times (end, &times[0]) >= 0) &&
-      (compare_times (begin, end) <= 0))
+  h = hash_name (name);
+  for (n = 0, k = k0; (k <= k1) && (n < max_n); k += stride)
   {
-    result->times = times;
-    result->data = data;
-    result->status = status;
-    result->n_points = MAX_ITEMS;
-    result->fetch_stat = FETCH_DONE;
+    t = k * shi->period;
+    if (in_gap (shi, t))
+    {
+      if (in_gap (shi, t - stride * shi->period)) continue;
+      data[n] = 0;
+      status[n] = 0;
+    }
+    else
+    {
+      data[n] = sample_value (h, k, t);
+      status[n] = DATASTAT_PLOTABLE;
+    }
+    dbl2time (&times[n], t);
+    n++;
   }
-  else result->fetch_stat = FETCH_NODATA;
+
+  StripHistoryResult_append
+    (result, StripHistoryChunk_new
+     (times, data, status, n, StripHistoryChunk_free));
+  if (result->n_points > 0) result->fetch_stat = FETCH_DONE;
 
   return result->fetch_stat;
-#undef MAX_ITEMS
 }
- 
+
 
 /* StripHistory_cancel
  */
-void    StripHistory_cancel     (StripHistory           the_shi,
+void    StripHistory_cancel     (StripHistory           BOGUS(the_shi),
                                  StripHistoryResult     *result)
 {
+  StripHistory_cancel_sliced (result);
 }
 
 
 
 /* StripHistoryResult_release
  */
-void  StripHistoryResult_release    (StripHistory           the_shi,
+void  StripHistoryResult_release    (StripHistory           BOGUS(the_shi),
                                      StripHistoryResult     *result)
 {
+  StripHistory_cancel_sliced (result);
+  StripHistoryResult_clear (result);
+}
+
+
+static double   env_value       (char *name, double dflt)
+{
+  char  *env = getenv (name);
+  return (env && *env)? atof (env) : dflt;
+}
+
+
+/* next_random
+ *
+ *      Uniform on [0, 1), from a private generator so that a given seed
+ *      always yields the same sequence of latencies and failures.
+ */
+static double   next_random     (StripHistoryInfo *shi)
+{
+  shi->seed = (shi->seed * 1103515245UL + 12345UL) & 0x7fffffffUL;
+  return shi->seed / 2147483648.0;
+}
+
+
+static void     delay           (double seconds)
+{
+  if (seconds <= 0) return;
+#ifdef WIN32
+  Sleep ((DWORD)(seconds * 1000));
+#else
+  {
+    struct timeval      tv;
+    dbl2time (&tv, seconds);
+    select (0, 0, 0, 0, &tv);
+  }
+#endif
+}
+
+
+static unsigned long    hash_name       (char *name)
+{
+  unsigned long h = 5381;
+  while (*name) h = ((h << 5) + h + (unsigned char)*name++) & 0xffffffffUL;
+  return h;
+}
+
+
+/* sample_value
+ *
+ *      A sine wave whose period (1 to 100 minutes) and phase depend on
+ *      the channel, plus a little noise depending on the grid index.
+ */
+static double   sample_value    (unsigned long h, double k, double t)
+{
+  double        period = 60.0 * (1 + h % 100);
+  double        phase = (h >> 8) % 360 * MY_PI / 180;
+  unsigned long x;
+
+  x = (unsigned long)fmod (k, 4294967296.0) ^ h;
+  x = (x * 2654435761UL) & 0xffffffffUL;
+  x ^= x >> 15;
+
+  return 10 * sin (2 * MY_PI * fmod (t, period) / period + phase) +
+    (x % 1000) / 1000.0 - 0.5;
+}
+
+
+static int      in_gap          (StripHistoryInfo *shi, double t)
+{
+  return (shi->gap_period > 0) && (fmod (t, shi->gap_period) < shi->gap_length);
 }
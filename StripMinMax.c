@@ -0,0 +1,243 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Block 0 of level 0 covers samples [0, FANOUT), block 0 of level 1
+ * covers blocks [0, FANOUT) of level 0, and so on, up to a level with no
+ * more than FANOUT blocks.  An empty block has min > max.
+ *
+ * In a ring buffer, only the blocks containing the head can be out of
+ * date.  So whenever the head leaves a block, that block is recomputed
+ * from the level below, which costs O(1) per write on average, and a
+ * range query descends into the head's blocks instead of using them.
+ */
+
+#include "StripMinMax.h"
+#include "StripDataSource.h"
+
+#include <float.h>
+
+#define FANOUT          32
+#define MAX_LEVELS      8
+
+typedef struct _MinMaxInfo
+{
+  double        *key;                   /* the data it was built for */
+  int           n;
+  int           n_levels;
+  int           size[MAX_LEVELS];       /* blocks per level */
+  int           span[MAX_LEVELS];       /* samples per block */
+  double        *min[MAX_LEVELS];
+  double        *max[MAX_LEVELS];
+}
+MinMaxInfo;
+
+static void     recompute       (MinMaxInfo *, double *, short *, int, int);
+static int      take            (MinMaxInfo *, double *, short *,
+                                 int, int, int, double *, double *);
+
+
+/* StripMinMax_build
+ */
+StripMinMax     StripMinMax_build       (double *data, short *status, int n)
+{
+  MinMaxInfo    *mm;
+  int           k, e, size, span;
+
+  if (!(mm = (MinMaxInfo *)calloc (1, sizeof (MinMaxInfo)))) return 0;
+  mm->key = data;
+  mm->n = n;
+
+  for (k = 0, size = n, span = 1;
+       (k < MAX_LEVELS) && (size > FANOUT);
+       k++)
+  {
+    size = (size + FANOUT - 1) / FANOUT;
+    span *= FANOUT;
+    mm->size[k] = size;
+    mm->span[k] = span;
+    mm->min[k] = (double *)malloc (size * sizeof (double));
+    mm->max[k] = (double *)malloc (size * sizeof (double));
+    if (!mm->min[k] || !mm->max[k])
+    {
+      mm->n_levels = k + 1;
+      StripMinMax_delete ((StripMinMax)mm);
+      return 0;
+    }
+    mm->n_levels = k + 1;
+    for (e = 0; e < size; e++) recompute (mm, data, status, k, e);
+  }
+
+  return (StripMinMax)mm;
+}
+
+
+/* StripMinMax_delete
+ */
+void            StripMinMax_delete      (StripMinMax the_mm)
+{
+  MinMaxInfo    *mm = (MinMaxInfo *)the_mm;
+  int           k;
+
+  if (!mm) return;
+  for (k = 0; k < mm->n_levels; k++)
+  {
+    if (mm->min[k]) free (mm->min[k]);
+    if (mm->max[k]) free (mm->max[k]);
+  }
+  free (mm);
+}
+
+
+/* StripMinMax_valid
+ */
+int             StripMinMax_valid       (StripMinMax the_mm, double *data, int n)
+{
+  MinMaxInfo    *mm = (MinMaxInfo *)the_mm;
+
+  return mm && (mm->key == data) && (mm->n == n);
+}
+
+
+/* StripMinMax_update
+ */
+void            StripMinMax_update      (StripMinMax    the_mm,
+                                         double         *data,
+                                         short          *status,
+                                         int            i)
+{
+  MinMaxInfo    *mm = (MinMaxInfo *)the_mm;
+  int           k, prev;
+
+  if (!mm || (i < 0) || (i >= mm->n)) return;
+
+  prev = (i > 0)? i - 1 : mm->n - 1;
+  for (k = 0; k < mm->n_levels; k++)
+  {
+    if (prev / mm->span[k] == i / mm->span[k]) break;
+    recompute (mm, data, status, k, prev / mm->span[k]);
+  }
+}
+
+
+/* StripMinMax_range
+ */
+int             StripMinMax_range       (StripMinMax    the_mm,
+                                         double         *data,
+                                         short          *status,
+                                         int            a,
+                                         int            b,
+                                         int            head,
+                                         double         *min,
+                                         double         *max)
+{
+  MinMaxInfo    *mm = (MinMaxInfo *)the_mm;
+  int           k, found = 0;
+
+  if (!mm) return 0;
+  if (a < 0) a = 0;
+  if (b >= mm->n) b = mm->n - 1;
+
+  /* level -1 are the samples themselves */
+  for (k = -1; a <= b; k++)
+  {
+    if (k + 1 >= mm->n_levels)
+    {
+      for (; a <= b; a++)
+        found |= take (mm, data, status, k, a, head, min, max);
+      break;
+    }
+    for (; (a <= b) && (a % FANOUT); a++)
+      found |= take (mm, data, status, k, a, head, min, max);
+    for (; (a <= b) && ((b + 1) % FANOUT); b--)
+      found |= take (mm, data, status, k, b, head, min, max);
+    a /= FANOUT;
+    b = (b + 1) / FANOUT - 1;
+  }
+
+  return found;
+}
+
+
+/* recompute
+ *
+ *      Sets block e of level k from the level below.
+ */
+static void     recompute       (MinMaxInfo     *mm,
+                                 double         *data,
+                                 short          *status,
+                                 int            k,
+                                 int            e)
+{
+  double        lo = DBL_MAX, hi = -DBL_MAX;
+  int           i, n;
+
+  if (k == 0)
+  {
+    n = mm->n;
+    for (i = e * FANOUT; (i < (e + 1) * FANOUT) && (i < n); i++)
+      if (status[i] & DATASTAT_PLOTABLE)
+      {
+        if (data[i] < lo) lo = data[i];
+        if (data[i] > hi) hi = data[i];
+      }
+  }
+  else
+  {
+    n = mm->size[k-1];
+    for (i = e * FANOUT; (i < (e + 1) * FANOUT) && (i < n); i++)
+    {
+      if (mm->min[k-1][i] < lo) lo = mm->min[k-1][i];
+      if (mm->max[k-1][i] > hi) hi = mm->max[k-1][i];
+    }
+  }
+
+  mm->min[k][e] = lo;
+  mm->max[k][e] = hi;
+}
+
+
+/* take
+ *
+ *      Adds block e of level k (or sample e, for k < 0) to [*min, *max],
+ *      descending into it if it holds the head.
+ */
+static int      take            (MinMaxInfo     *mm,
+                                 double         *data,
+                                 short          *status,
+                                 int            k,
+                                 int            e,
+                                 int            head,
+                                 double         *min,
+                                 double         *max)
+{
+  int           i, n, found = 0;
+
+  if (k < 0)
+  {
+    if (!(status[e] & DATASTAT_PLOTABLE)) return 0;
+    if (data[e] < *min) *min = data[e];
+    if (data[e] > *max) *max = data[e];
+    return 1;
+  }
+
+  if ((head >= 0) && (head / mm->span[k] == e))
+  {
+    n = (k > 0)? mm->size[k-1] : mm->n;
+    for (i = e * FANOUT; (i < (e + 1) * FANOUT) && (i < n); i++)
+      found |= take (mm, data, status, k - 1, i, head, min, max);
+    return found;
+  }
+
+  if (mm->min[k][e] > mm->max[k][e]) return 0;         /* empty */
+  if (mm->min[k][e] < *min) *min = mm->min[k][e];
+  if (mm->max[k][e] > *max) *max = mm->max[k][e];
+  return 1;
+}
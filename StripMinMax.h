@@ -0,0 +1,79 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#ifndef _StripMinMax
+#define _StripMinMax
+
+/* StripMinMax
+ *
+ *      Min/max summary of an array of samples, used for autoscaling.
+ *      It is a pyramid of blocks: each block of a level holds the
+ *      minimum and maximum of the plotable samples it covers, and each
+ *      level combines a fixed number of blocks of the level below, so
+ *      the extrema of any index range are found in time logarithmic in
+ *      the size of the array.
+ *
+ *      The summary may belong to a ring buffer which is written at a
+ *      moving head: after each write it is told about it, and the blocks
+ *      which contain the head are not relied upon.
+ */
+typedef void *  StripMinMax;
+
+
+/* StripMinMax_build
+ *
+ *      Returns the summary of the n samples, or 0 if there is no memory.
+ */
+StripMinMax     StripMinMax_build       (double *,              /* data */
+                                         short *,               /* status */
+                                         int);                  /* n */
+
+
+/* StripMinMax_delete
+ */
+void            StripMinMax_delete      (StripMinMax);
+
+
+/* StripMinMax_valid
+ *
+ *      True if the summary was built for these arrays.
+ */
+int             StripMinMax_valid       (StripMinMax,
+                                         double *,              /* data */
+                                         int);                  /* n */
+
+
+/* StripMinMax_update
+ *
+ *      Sample i of the ring buffer has just been written.
+ */
+void            StripMinMax_update      (StripMinMax,
+                                         double *,              /* data */
+                                         short *,               /* status */
+                                         int);                  /* i */
+
+
+/* StripMinMax_range
+ *
+ *      Widens [*min, *max] to include the plotable samples on [a, b],
+ *      and returns 1 if there are any.  head is the ring buffer's write
+ *      position, or -1.
+ */
+int             StripMinMax_range       (StripMinMax,
+                                         double *,              /* data */
+                                         short *,               /* status */
+                                         int,                   /* a */
+                                         int,                   /* b */
+                                         int,                   /* head */
+                                         double *,              /* min */
+                                         double *);             /* max */
+
+#endif  /* _StripMinMax */
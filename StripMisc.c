@@ -598,8 +598,26 @@ char    *basename_st       (char *path)
 
 /* Albert */
 extern Widget history_topShell;
+
+#define MAX_DEFERRED_POPUPS 4
+static int historyPopupsDeferred = 0;
+static int historyPopupCount = 0;
+static char *historyPopups[MAX_DEFERRED_POPUPS][3];
+
 void History_MessageBox_popup(char *title,char *btn_txt,char *str)
 {
+  int i;
+
+  if (historyPopupsDeferred) {
+    if (historyPopupCount < MAX_DEFERRED_POPUPS) {
+      i = historyPopupCount++;
+      historyPopups[i][0] = strdup(title);
+      historyPopups[i][1] = strdup(btn_txt);
+      historyPopups[i][2] = strdup(str);
+    }
+    return;
+  }
+
           MessageBox_popup
             (history_topShell,
              (Widget *)XmCreateMessageDialog(history_topShell,"Oops",NULL,0), 
@@ -610,6 +628,26 @@ void History_MessageBox_popup(char *title,char *btn_txt,char *str)
 #endif
 }
 
+void History_MessageBox_defer(int on)
+{
+  int i, j;
+
+  if (on) {
+    historyPopupsDeferred++;
+    return;
+  }
+  if ((historyPopupsDeferred > 0) && (--historyPopupsDeferred > 0)) return;
+
+  for (i = 0; i < historyPopupCount; i++) {
+    if (historyPopups[i][0] && historyPopups[i][1] && historyPopups[i][2])
+      History_MessageBox_popup
+        (historyPopups[i][0], historyPopups[i][1], historyPopups[i][2]);
+    for (j = 0; j < 3; j++)
+      if (historyPopups[i][j]) free(historyPopups[i][j]);
+  }
+  historyPopupCount = 0;
+}
+
 
 
 /* General purpose output routine
@@ -242,6 +242,14 @@ char    *int2str        (int x, char buf[], int n);
 char    *basename_st    (char *);
 void History_MessageBox_popup(char *title,char *btn_txt,char *str);
 
+/* History_MessageBox_defer
+ *
+ *      While deferred, history popups are only queued (they may then be
+ *      raised from a fetch thread).  Deferrals nest; ending the outermost
+ *      one shows the queued popups, so it must be on the main thread.
+ */
+void History_MessageBox_defer(int on);
+
 /* General purpose output routine
  * Works with both UNIX and WIN32
  * Uses sprintf to avoid problem with lprintf not handling %f, etc.
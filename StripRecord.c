@@ -0,0 +1,732 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Notes
+ *
+ *      The sample loop formats records into fixed size blocks, and hands
+ *      a block over to the writer thread when it is full, or when it is
+ *      REC_FLUSH seconds old and the writer has nothing else to do.  Only
+ *      the block queue is shared, so the loop takes the lock about once a
+ *      second.
+ *
+ *      File rotation is decided by the sample loop too: the first block
+ *      of a file is flagged, and starts with the file header and the
+ *      curve records.  If the writer falls REC_MAX_QUEUED blocks behind,
+ *      the loop drops its current block and starts a new file, so that
+ *      each file remains self-contained.
+ *
+ *      Sampled values and updates are held as entries until they are
+ *      flushed, as updates of several curves arrive together, some time
+ *      after they were received.  A flush sorts them by time, and formats
+ *      the entries of equal time and kind into one row.  A slot's change
+ *      of curve is an entry too, so that its curve record comes before
+ *      the new curve's rows, and after any rows left of the old one.
+ */
+
+#include "StripRecord.h"
+#include "StripDefines.h"
+
+#include <string.h>
+#include <errno.h>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#ifdef __APPLE__
+#define fdatasync       fsync
+#endif
+
+#define REC_MAGIC       "STRIPREC"
+#define REC_VERSION     2
+#define REC_HEADER      16
+#define REC_SUFFIX      ".srec"
+#define REC_PATH_MAX    1024
+#define REC_BLOCK       65536           /* bytes */
+#define REC_MAX_QUEUED  64              /* blocks waiting for the writer */
+#define REC_FLUSH       1.0             /* seconds */
+#define REC_ROW_HEADER  10
+#define REC_VALUE       11
+#define REC_UPDATE      19
+#define REC_CURVE_MAX   (4 + STRIP_MAX_NAME_CHAR)
+
+typedef struct _RecBlock
+{
+  struct _RecBlock      *next;
+  int                   new_file;       /* start a new file with it */
+  time_t                t0;             /* names the new file */
+  size_t                n;
+  unsigned char         data[REC_BLOCK];
+}
+RecBlock;
+
+typedef struct _RecEntry
+{
+  struct timeval        t;              /* of the row */
+  unsigned long         seq;            /* order of arrival */
+  char                  kind;           /* of record: 'C', 'S' or 'U' */
+  int                   slot;
+  short                 status;
+  double                value;
+  struct timeval        stamp;          /* of an update */
+  char                  *name;          /* of a curve record */
+}
+RecEntry;
+
+typedef struct _StripRecordInfo
+{
+  char                  dir[REC_PATH_MAX];
+  double                max_bytes;      /* per file */
+  double                period;         /* seconds per file */
+  double                sync;           /* seconds between syncs */
+
+  /* sample loop */
+  RecBlock              *cur;           /* being filled, or 0 */
+  double                cur_t;          /* time of its first record */
+  unsigned long         cur_rows;
+  double                file_bytes;
+  double                file_t0;
+  char                  names[STRIP_MAX_CURVES][STRIP_MAX_NAME_CHAR+1];
+  char                  queued[STRIP_MAX_CURVES][STRIP_MAX_NAME_CHAR+1];
+  RecEntry              *entries;       /* not yet flushed */
+  size_t                n_entries, max_entries;
+  unsigned long         seq;
+  struct timeval        row_t;
+  unsigned char         row[REC_ROW_HEADER + STRIP_MAX_CURVES*REC_UPDATE];
+
+  /* writer thread */
+  int                   fd;
+  double                synced;
+  int                   failed;         /* error has been reported */
+
+  /* shared */
+  pthread_mutex_t       lock;
+  pthread_cond_t        cond;
+  pthread_t             thread;
+  RecBlock              *head, *tail;   /* written in this order */
+  RecBlock              *free;
+  int                   n_queued;
+  int                   busy;           /* the writer has blocks */
+  int                   stop;
+}
+StripRecordInfo;
+
+static void     rec_enter       (StripRecordInfo *, int, int, char *,
+                                 struct timeval *, struct timeval *,
+                                 double, short);
+static RecEntry *rec_entry      (StripRecordInfo *);
+static int      rec_compare     (const void *, const void *);
+static void     rec_row         (StripRecordInfo *, RecEntry *, int);
+static void     rec_queue       (StripRecordInfo *, int);
+static void     rec_append      (StripRecordInfo *, unsigned char *, int);
+static int      rec_curve       (StripRecordInfo *, int, unsigned char *);
+static void     *rec_thread     (void *);
+static void     rec_open        (StripRecordInfo *, time_t);
+static void     rec_close       (StripRecordInfo *);
+static void     rec_write       (StripRecordInfo *, unsigned char *, size_t);
+static void     rec_put         (unsigned char *, double, int);
+static void     rec_put_double  (unsigned char *, double);
+static double   rec_now         (void);
+
+
+/* StripRecord_init
+ */
+StripRecord     StripRecord_init        (void)
+{
+  StripRecordInfo       *rec;
+  struct stat           st;
+  char                  *env;
+
+  if (!(env = getenv (STRIP_RECORD_DIR_ENV)) || !*env)
+    return 0;
+
+  if ((stat (env, &st) != 0) && (mkdir (env, 0775) != 0))
+  {
+    fprintf (stderr, "StripRecord_init: can't create %s: %s\n",
+             env, strerror (errno));
+    return 0;
+  }
+
+  if (!(rec = (StripRecordInfo *)calloc (1, sizeof (StripRecordInfo))))
+  {
+    fprintf (stderr, "StripRecord_init: can't allocate memory\n");
+    return 0;
+  }
+
+  strncpy (rec->dir, env, REC_PATH_MAX - 1);
+  rec->max_bytes = STRIP_RECORD_FILE_SIZE;
+  if ((env = getenv (STRIP_RECORD_FILE_SIZE_ENV)) && (atof (env) > 0))
+    rec->max_bytes = atof (env);
+  rec->max_bytes *= 1024.0 * 1024.0;
+  rec->period = STRIP_RECORD_FILE_TIME;
+  if ((env = getenv (STRIP_RECORD_FILE_TIME_ENV)) && (atof (env) > 0))
+    rec->period = atof (env);
+  rec->sync = STRIP_RECORD_SYNC;
+  if ((env = getenv (STRIP_RECORD_SYNC_ENV)) && (atof (env) >= 0))
+    rec->sync = atof (env);
+  rec->fd = -1;
+
+  pthread_mutex_init (&rec->lock, 0);
+  pthread_cond_init (&rec->cond, 0);
+  if (pthread_create (&rec->thread, 0, rec_thread, rec) != 0)
+  {
+    fprintf (stderr, "StripRecord_init: can't start the writer thread\n");
+    pthread_cond_destroy (&rec->cond);
+    pthread_mutex_destroy (&rec->lock);
+    free (rec);
+    return 0;
+  }
+
+  return (StripRecord)rec;
+}
+
+
+/* StripRecord_delete
+ */
+void            StripRecord_delete      (StripRecord the_rec)
+{
+  StripRecordInfo       *rec = (StripRecordInfo *)the_rec;
+  RecBlock              *b;
+
+  if (!rec) return;
+
+  StripRecord_flush (rec, 0);
+  pthread_mutex_lock (&rec->lock);
+  if (rec->cur && (rec->cur->n > 0))
+  {
+    rec->cur->next = 0;
+    if (rec->tail) rec->tail->next = rec->cur;
+    else rec->head = rec->cur;
+    rec->tail = rec->cur;
+    rec->cur = 0;
+  }
+  rec->stop = 1;
+  pthread_cond_signal (&rec->cond);
+  pthread_mutex_unlock (&rec->lock);
+  pthread_join (rec->thread, 0);
+
+  if (rec->cur) free (rec->cur);
+  if (rec->entries) free (rec->entries);
+  while ((b = rec->free))
+  {
+    rec->free = b->next;
+    free (b);
+  }
+  pthread_cond_destroy (&rec->cond);
+  pthread_mutex_destroy (&rec->lock);
+  free (rec);
+}
+
+
+/* StripRecord_value
+ */
+void            StripRecord_value       (StripRecord    the_rec,
+                                         int            slot,
+                                         char           *name,
+                                         struct timeval *t,
+                                         double         value,
+                                         short          status)
+{
+  rec_enter
+    ((StripRecordInfo *)the_rec, 'S', slot, name, t, 0, value, status);
+}
+
+
+/* StripRecord_update
+ */
+void            StripRecord_update      (StripRecord    the_rec,
+                                         int            slot,
+                                         char           *name,
+                                         struct timeval *t,
+                                         struct timeval *stamp,
+                                         double         value,
+                                         short          status)
+{
+  rec_enter
+    ((StripRecordInfo *)the_rec, 'U', slot, name, t, stamp, value, status);
+}
+
+
+/* StripRecord_flush
+ */
+void            StripRecord_flush       (StripRecord the_rec, struct timeval *t)
+{
+  StripRecordInfo       *rec = (StripRecordInfo *)the_rec;
+  RecEntry              *e;
+  size_t                i, j, n;
+  int                   idle;
+
+  if (!rec || (rec->n_entries == 0)) return;
+
+  qsort (rec->entries, rec->n_entries, sizeof (RecEntry), rec_compare);
+  for (n = 0; n < rec->n_entries; n++)
+    if (t && (time2dbl (&rec->entries[n].t) > time2dbl (t))) break;
+  if (n == 0) return;
+
+  for (i = 0; i < n; i = j)
+  {
+    e = &rec->entries[i];
+    for (j = i + 1; (j < n) && (e->kind != 'C') && (j - i < STRIP_MAX_CURVES);
+         j++)
+      if ((rec->entries[j].kind != e->kind) ||
+          (rec->entries[j].t.tv_sec != e->t.tv_sec) ||
+          (rec->entries[j].t.tv_usec != e->t.tv_usec))
+        break;
+    rec_row (rec, e, (int)(j - i));
+  }
+  rec->n_entries -= n;
+  memmove (rec->entries, rec->entries + n, rec->n_entries * sizeof (RecEntry));
+
+  /* a partly filled block only goes to an idle writer */
+  if (rec->cur && (time2dbl (&rec->row_t) - rec->cur_t >= REC_FLUSH))
+  {
+    pthread_mutex_lock (&rec->lock);
+    idle = !rec->head && !rec->busy;
+    pthread_mutex_unlock (&rec->lock);
+    if (idle) rec_queue (rec, 0);
+  }
+}
+
+
+/* rec_enter
+ *
+ *      Holds a sampled value or an update until it is flushed, preceded
+ *      by a curve record if the slot has changed its curve.
+ */
+static void     rec_enter       (StripRecordInfo        *rec,
+                                 int                    kind,
+                                 int                    slot,
+                                 char                   *name,
+                                 struct timeval         *t,
+                                 struct timeval         *stamp,
+                                 double                 value,
+                                 short                  status)
+{
+  RecEntry              *e;
+
+  if (!rec || (slot < 0) || (slot >= STRIP_MAX_CURVES)) return;
+
+  if (strcmp (name, rec->queued[slot]) != 0)
+  {
+    if (!(e = rec_entry (rec))) return;
+    if (!(e->name = (char *)malloc (strlen (name) + 1)))
+    {
+      rec->n_entries--;
+      return;
+    }
+    strcpy (e->name, name);
+    e->kind = 'C';
+    e->slot = slot;
+    e->t = *t;
+    strncpy (rec->queued[slot], name, STRIP_MAX_NAME_CHAR);
+  }
+
+  if (!(e = rec_entry (rec))) return;
+  e->kind = (char)kind;
+  e->slot = slot;
+  e->t = *t;
+  if (stamp) e->stamp = *stamp;
+  e->value = value;
+  e->status = status;
+}
+
+
+/* rec_entry
+ *
+ *      Appends a new entry, returning 0 if out of memory.
+ */
+static RecEntry *rec_entry      (StripRecordInfo *rec)
+{
+  RecEntry      *e;
+  size_t        n;
+
+  if (rec->n_entries == rec->max_entries)
+  {
+    n = rec->max_entries? 2 * rec->max_entries : 256;
+    if (!(e = (RecEntry *)realloc (rec->entries, n * sizeof (RecEntry))))
+    {
+      fprintf (stderr, "StripRecord: can't allocate memory\n");
+      return 0;
+    }
+    rec->entries = e;
+    rec->max_entries = n;
+  }
+
+  e = &rec->entries[rec->n_entries++];
+  memset (e, 0, sizeof (RecEntry));
+  e->seq = rec->seq++;
+  return e;
+}
+
+
+/* rec_compare
+ *
+ *      Orders entries by time, and then as they arrived.
+ */
+static int      rec_compare     (const void *a, const void *b)
+{
+  const RecEntry        *x = (const RecEntry *)a;
+  const RecEntry        *y = (const RecEntry *)b;
+
+  if (x->t.tv_sec != y->t.tv_sec) return (x->t.tv_sec < y->t.tv_sec)? -1 : 1;
+  if (x->t.tv_usec != y->t.tv_usec)
+    return (x->t.tv_usec < y->t.tv_usec)? -1 : 1;
+  if (x->seq != y->seq) return (x->seq < y->seq)? -1 : 1;
+  return 0;
+}
+
+
+/* rec_row
+ *
+ *      Appends the record of n entries of equal time and kind, starting
+ *      a new file first if the current one is full or old.
+ */
+static void     rec_row         (StripRecordInfo *rec, RecEntry *e, int n)
+{
+  unsigned char         buf[REC_CURVE_MAX];
+  unsigned char         *p;
+  int                   i;
+
+  rec->row_t = e->t;
+  if (!rec->cur || (rec->file_bytes >= rec->max_bytes) ||
+      (time2dbl (&e->t) - rec->file_t0 >= rec->period))
+    rec_queue (rec, 1);
+
+  if (e->kind == 'C')
+  {
+    strncpy (rec->names[e->slot], e->name, STRIP_MAX_NAME_CHAR);
+    free (e->name);
+    rec_append (rec, buf, rec_curve (rec, e->slot, buf));
+    return;
+  }
+
+  p = rec->row + REC_ROW_HEADER;
+  for (i = 0; i < n; i++, e++)
+  {
+    p[0] = (unsigned char)e->slot;
+    rec_put (p + 1, (unsigned short)e->status, 2);
+    rec_put_double (p + 3, e->value);
+    if (e->kind == 'U')
+    {
+      rec_put (p + REC_VALUE, e->stamp.tv_sec * 1e6 + e->stamp.tv_usec, 8);
+      p += REC_UPDATE;
+    }
+    else p += REC_VALUE;
+  }
+  rec->row[0] = (unsigned char)e[-1].kind;
+  rec->row[1] = (unsigned char)n;
+  rec_put (rec->row + 2, rec->row_t.tv_sec * 1e6 + rec->row_t.tv_usec, 8);
+  rec_append (rec, rec->row, (int)(p - rec->row));
+  rec->cur_rows++;
+}
+
+
+/* rec_queue
+ *
+ *      Hands the current block to the writer, and starts a new one,
+ *      which begins a new file if new_file is set.
+ */
+static void     rec_queue       (StripRecordInfo *rec, int new_file)
+{
+  RecBlock      *b = rec->cur;
+  int           i;
+
+  pthread_mutex_lock (&rec->lock);
+  if (b && (b->n > 0))
+  {
+    if (rec->n_queued < REC_MAX_QUEUED)
+    {
+      b->next = 0;
+      if (rec->tail) rec->tail->next = b;
+      else rec->head = b;
+      rec->tail = b;
+      rec->n_queued++;
+      pthread_cond_signal (&rec->cond);
+      if ((b = rec->free)) rec->free = b->next;
+    }
+    else
+    {
+      fprintf (stderr, "StripRecord: the writer is behind, %lu rows lost\n",
+               rec->cur_rows);
+      new_file = 1;
+    }
+  }
+  pthread_mutex_unlock (&rec->lock);
+
+  if (!b && !(b = (RecBlock *)malloc (sizeof (RecBlock))))
+  {
+    fprintf (stderr, "StripRecord: can't allocate memory\n");
+    rec->cur = 0;
+    return;
+  }
+
+  rec->cur = b;
+  rec->cur_t = time2dbl (&rec->row_t);
+  rec->cur_rows = 0;
+  b->n = 0;
+  b->new_file = new_file;
+  b->t0 = rec->row_t.tv_sec;
+
+  if (new_file)
+  {
+    memcpy (b->data, REC_MAGIC, 8);
+    rec_put (b->data + 8, REC_VERSION, 4);
+    rec_put (b->data + 12, 0, 4);
+    b->n = REC_HEADER;
+    rec->file_t0 = rec->cur_t;
+    for (i = 0; i < STRIP_MAX_CURVES; i++)
+      if (rec->names[i][0]) b->n += rec_curve (rec, i, b->data + b->n);
+    rec->file_bytes = b->n;
+  }
+}
+
+
+/* rec_append
+ */
+static void     rec_append      (StripRecordInfo *rec, unsigned char *p, int n)
+{
+  if (rec->cur && (rec->cur->n + n > REC_BLOCK)) rec_queue (rec, 0);
+  if (!rec->cur) return;                /* no memory: drop it */
+
+  memcpy (rec->cur->data + rec->cur->n, p, n);
+  rec->cur->n += n;
+  rec->file_bytes += n;
+}
+
+
+/* rec_curve
+ *
+ *      Formats the curve record of a slot, returning its length.
+ */
+static int      rec_curve       (StripRecordInfo *rec, int slot,
+                                 unsigned char *p)
+{
+  int   n = (int)strlen (rec->names[slot]);
+
+  p[0] = 'C';
+  p[1] = (unsigned char)slot;
+  rec_put (p + 2, n, 2);
+  memcpy (p + 4, rec->names[slot], n);
+  return 4 + n;
+}
+
+
+/* rec_thread
+ */
+static void     *rec_thread     (void *arg)
+{
+  StripRecordInfo       *rec = (StripRecordInfo *)arg;
+  RecBlock              *list, *b, *last;
+  int                   stop;
+
+  for (;;)
+  {
+    pthread_mutex_lock (&rec->lock);
+    while (!rec->head && !rec->stop)
+      pthread_cond_wait (&rec->cond, &rec->lock);
+    list = rec->head;
+    rec->head = rec->tail = 0;
+    rec->n_queued = 0;
+    rec->busy = (list != 0);
+    stop = rec->stop;
+    pthread_mutex_unlock (&rec->lock);
+
+    for (b = last = list; b; last = b, b = b->next)
+    {
+      if (b->new_file) rec_open (rec, b->t0);
+      rec_write (rec, b->data, b->n);
+    }
+
+    if ((rec->fd >= 0) && list && (rec_now () - rec->synced >= rec->sync))
+    {
+      fdatasync (rec->fd);
+      rec->synced = rec_now ();
+    }
+
+    pthread_mutex_lock (&rec->lock);
+    if (list)
+    {
+      last->next = rec->free;
+      rec->free = list;
+    }
+    rec->busy = 0;
+    pthread_mutex_unlock (&rec->lock);
+
+    if (stop) break;
+  }
+
+  rec_close (rec);
+  return 0;
+}
+
+
+/* rec_open
+ *
+ *      Closes the current file and creates a new one, named after t0.
+ */
+static void     rec_open        (StripRecordInfo *rec, time_t t0)
+{
+  char          name[64];
+  char          path[REC_PATH_MAX + 80];
+  struct tm     tm;
+  int           i;
+
+  rec_close (rec);
+
+  localtime_r (&t0, &tm);
+  strftime (name, sizeof (name), "strip_%Y%m%d_%H%M%S", &tm);
+  for (i = 0; i < 100; i++)
+  {
+    if (i == 0) sprintf (path, "%s/%s%s", rec->dir, name, REC_SUFFIX);
+    else sprintf (path, "%s/%s_%d%s", rec->dir, name, i, REC_SUFFIX);
+    rec->fd = open (path, O_WRONLY | O_CREAT | O_EXCL | O_APPEND, 0664);
+    if ((rec->fd >= 0) || (errno != EEXIST)) break;
+  }
+
+  if (rec->fd < 0)
+    fprintf (stderr, "StripRecord: can't create %s: %s\n",
+             path, strerror (errno));
+  rec->failed = 0;
+  rec->synced = rec_now ();
+}
+
+
+/* rec_close
+ */
+static void     rec_close       (StripRecordInfo *rec)
+{
+  if (rec->fd < 0) return;
+  fdatasync (rec->fd);
+  close (rec->fd);
+  rec->fd = -1;
+}
+
+
+/* rec_write
+ */
+static void     rec_write       (StripRecordInfo *rec, unsigned char *p,
+                                 size_t n)
+{
+  ssize_t       k;
+
+  while ((rec->fd >= 0) && (n > 0))
+  {
+    if ((k = write (rec->fd, p, n)) < 0)
+    {
+      if (errno == EINTR) continue;
+      if (!rec->failed)
+        fprintf (stderr, "StripRecord: write failed: %s\n", strerror (errno));
+      rec->failed = 1;
+      return;
+    }
+    p += k;
+    n -= k;
+  }
+}
+
+
+/* rec_put
+ *
+ *      Stores a non-negative integral value as an n-byte little-endian
+ *      integer.
+ */
+static void     rec_put         (unsigned char *p, double v, int n)
+{
+  int   i;
+
+  for (i = 0; i < n; i++)
+  {
+    p[i] = (unsigned char)fmod (v, 256.0);
+    v = floor (v / 256.0);
+  }
+}
+
+
+/* rec_put_double
+ */
+static void     rec_put_double  (unsigned char *p, double v)
+{
+  static int    one = 1;
+  unsigned char x;
+  int           i;
+
+  memcpy (p, &v, 8);
+  if (!*(char *)&one)
+    for (i = 0; i < 4; i++)
+    {
+      x = p[i];
+      p[i] = p[7 - i];
+      p[7 - i] = x;
+    }
+}
+
+
+/* rec_now
+ */
+static double   rec_now         (void)
+{
+  struct timeval        t;
+
+  get_current_time (&t);
+  return time2dbl (&t);
+}
+
+#else   /* WIN32: no recording */
+
+StripRecord     StripRecord_init        (void)
+{
+  return 0;
+}
+
+void            StripRecord_delete      (StripRecord BOGUS(1))
+{
+}
+
+void            StripRecord_value       (StripRecord    BOGUS(1),
+                                         int            BOGUS(2),
+                                         char           *BOGUS(3),
+                                         struct timeval *BOGUS(4),
+                                         double         BOGUS(5),
+                                         short          BOGUS(6))
+{
+}
+
+void            StripRecord_update      (StripRecord    BOGUS(1),
+                                         int            BOGUS(2),
+                                         char           *BOGUS(3),
+                                         struct timeval *BOGUS(4),
+                                         struct timeval *BOGUS(5),
+                                         double         BOGUS(6),
+                                         short          BOGUS(7))
+{
+}
+
+void            StripRecord_flush       (StripRecord            BOGUS(1),
+                                         struct timeval         *BOGUS(2))
+{
+}
+
+#endif  /* WIN32 */
+
+/* **************************** Emacs Editing Sequences ***************** */
+/* Local Variables: */
+/* tab-width: 6 */
+/* c-basic-offset: 2 */
+/* c-comment-only-line-offset: 0 */
+/* c-indent-comments-syntactically-p: t */
+/* c-label-minimum-indentation: 1 */
+/* c-file-offsets: ((substatement-open . 0) (label . 2) */
+/* (brace-entry-open . 0) (label .2) (arglist-intro . +) */
+/* (arglist-cont-nonempty . c-lineup-arglist) ) */
+/* End: */
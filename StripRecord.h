@@ -0,0 +1,93 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#ifndef _StripRecord
+#define _StripRecord
+
+#include "StripMisc.h"
+
+/* StripRecord
+ *
+ *      Continuous recording of every sample to append-only binary log
+ *      files.  Rows are collected in memory by the sample loop and
+ *      written by a thread of its own, which syncs the file to disk
+ *      every STRIP_RECORD_SYNC seconds.  A new file is started when
+ *      the current one exceeds STRIP_RECORD_FILE_SIZE (Mbytes) or
+ *      STRIP_RECORD_FILE_TIME (seconds).
+ *
+ *      Recording is enabled by setting STRIP_RECORD_DIR, where the files
+ *      are created as strip_<yyyymmdd>_<hhmmss>.srec.  A file holds a
+ *      16 byte header ("STRIPREC", version, 0) and then records, all
+ *      numbers being little-endian and times in microseconds since 1970:
+ *
+ *        curve:  'C', slot (1), name length (2), name
+ *        sample: 'S', number of values (1), time (8), and per value:
+ *                slot (1), status (2), value (8, IEEE double)
+ *        update: 'U', number of values (1), time received (8), and per
+ *                value: slot (1), status (2), value (8), time stamped
+ *                by the data source (8)
+ *
+ *      Row times are all taken from the local clock, and rows follow
+ *      each other in time order, across curves.  Each file starts with
+ *      the curve records of all slots in use, and a curve record also
+ *      precedes the first row after a slot changes its curve.
+ */
+typedef void *  StripRecord;
+
+
+/* StripRecord_init
+ *
+ *      Returns a handle to the recorder, or 0 if recording is disabled
+ *      or its directory is unusable.
+ */
+StripRecord     StripRecord_init        (void);
+
+
+/* StripRecord_delete
+ *
+ *      Writes out what is left, and closes the file.
+ */
+void            StripRecord_delete      (StripRecord);
+
+
+/* StripRecord_value
+ *
+ *      Adds a curve's sampled value to the row of the given time.
+ */
+void            StripRecord_value       (StripRecord,
+                                         int,                   /* slot */
+                                         char *,                /* name */
+                                         struct timeval *,      /* time */
+                                         double,                /* value */
+                                         short);                /* status */
+
+
+/* StripRecord_update
+ *
+ *      Adds an update of a curve, received at the given time.
+ */
+void            StripRecord_update      (StripRecord,
+                                         int,                   /* slot */
+                                         char *,                /* name */
+                                         struct timeval *,      /* received */
+                                         struct timeval *,      /* stamp */
+                                         double,                /* value */
+                                         short);                /* status */
+
+
+/* StripRecord_flush
+ *
+ *      Appends the rows up to the given time to the log, in time order.
+ *      Nothing from before that time may be added afterwards.
+ */
+void            StripRecord_flush       (StripRecord, struct timeval *);
+
+#endif  /* _StripRecord */
@@ -0,0 +1,188 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Times are kept as seconds after the origin, which leaves plenty of
+ * precision for microseconds.  The grid points between two samples are
+ * filled by one loop with no branches, which the compiler can vectorize.
+ */
+
+#include "StripResample.h"
+#include "StripDataSource.h"
+
+#include <string.h>
+
+#define RESAMPLE_REL(rs, tv) \
+((double)((tv)->tv_sec - (rs)->origin.tv_sec) + \
+ ((double)(tv)->tv_usec - (double)(rs)->origin.tv_usec) * 1e-6)
+
+static long     resample_before (StripResample *, double);
+static void     resample_fill   (StripResample *, long, long,
+                                 double *, char *, double, double, int);
+
+
+/* StripResample_init
+ */
+void    StripResample_init      (StripResample          *rs,
+                                 StripResampleMethod    method,
+                                 struct timeval         *origin,
+                                 double                 step)
+{
+  rs->method = method;
+  rs->origin = *origin;
+  rs->step = step;
+  rs->k = 0;
+  rs->have = 0;
+  rs->t = rs->v = 0;
+  rs->ok = 0;
+}
+
+
+/* StripResample_time
+ */
+void    StripResample_time      (StripResample *rs, long k, struct timeval *t)
+{
+  double        x = k * rs->step + rs->origin.tv_usec * 1e-6;
+  double        s = floor (x);
+
+  t->tv_sec = rs->origin.tv_sec + (long)s;
+  t->tv_usec = (long)((x - s) * ONE_MILLION + 0.5);
+  if (t->tv_usec >= ONE_MILLION)
+  {
+    t->tv_sec++;
+    t->tv_usec -= ONE_MILLION;
+  }
+}
+
+
+/* StripResample_before
+ */
+long    StripResample_before    (StripResample *rs, struct timeval *t)
+{
+  return resample_before (rs, RESAMPLE_REL (rs, t));
+}
+
+
+/* StripResample_count
+ */
+long    StripResample_count     (StripResample *rs, struct timeval *end)
+{
+  double        x = RESAMPLE_REL (rs, end);
+  long          k = resample_before (rs, x);
+
+  return (k * rs->step <= x)? k + 1 : k;
+}
+
+
+/* StripResample_feed
+ */
+long    StripResample_feed      (StripResample  *rs,
+                                 struct timeval *times,
+                                 double         *values,
+                                 short          *status,
+                                 long           n,
+                                 long           base,
+                                 long           limit,
+                                 double         *out,
+                                 char           *flags)
+{
+  double        ts;
+  long          i, kn;
+  int           ok;
+
+  for (i = 0; i < n; i++)
+  {
+    ts = RESAMPLE_REL (rs, &times[i]);
+    ok = (status[i] & DATASTAT_PLOTABLE) != 0;
+
+    kn = resample_before (rs, ts);
+    if (kn > limit)
+    {
+      resample_fill (rs, base, limit, out, flags, ts, values[i], ok);
+      return i;
+    }
+    resample_fill (rs, base, kn, out, flags, ts, values[i], ok);
+
+    rs->t = ts;
+    rs->v = values[i];
+    rs->ok = ok;
+    rs->have = 1;
+  }
+
+  return n;
+}
+
+
+/* StripResample_hold
+ */
+void    StripResample_hold      (StripResample  *rs,
+                                 long           base,
+                                 long           limit,
+                                 double         *out,
+                                 char           *flags)
+{
+  resample_fill (rs, base, limit, out, flags, 0, 0, 0);
+}
+
+
+/* resample_before
+ *
+ *      The number of grid points before x seconds after the origin.
+ */
+static long     resample_before (StripResample *rs, double x)
+{
+  long  k;
+
+  if (x <= 0) return 0;
+  k = (long)ceil (x / rs->step);
+  while ((k > 0) && (k * rs->step >= x)) k--;
+  while (k * rs->step < x) k++;
+  return k;
+}
+
+
+/* resample_fill
+ *
+ *      Fills the grid points from rs->k up to (not including) limit,
+ *      between the latest sample and the next one, (t1, v1, ok1).
+ */
+static void     resample_fill   (StripResample  *rs,
+                                 long           base,
+                                 long           limit,
+                                 double         *out,
+                                 char           *flags,
+                                 double         t1,
+                                 double         v1,
+                                 int            ok1)
+{
+  double        *o = out + (rs->k - base);
+  double        step = rs->step, t0 = rs->t, v0 = rs->v, slope;
+  long          k;
+
+  if (limit <= rs->k) return;
+
+  if (!rs->have)
+    memset (flags + (rs->k - base), STRIP_RESAMPLE_NA, limit - rs->k);
+  else if (!rs->ok)
+    memset (flags + (rs->k - base), STRIP_RESAMPLE_BAD, limit - rs->k);
+  else
+  {
+    memset (flags + (rs->k - base), STRIP_RESAMPLE_OK, limit - rs->k);
+    if ((rs->method == STRIP_RESAMPLE_LINEAR) && ok1 && (t1 > t0))
+    {
+      slope = (v1 - v0) / (t1 - t0);
+      for (k = rs->k; k < limit; k++)
+        *o++ = v0 + slope * ((double)k * step - t0);
+    }
+    else for (k = rs->k; k < limit; k++) *o++ = v0;
+  }
+
+  rs->k = limit;
+}
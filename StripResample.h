@@ -0,0 +1,117 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#ifndef _StripResample
+#define _StripResample
+
+#include "StripMisc.h"
+
+/* StripResample
+ *
+ *      Projects one curve's samples onto the uniform time grid
+ *      origin + k * step, k = 0, 1, ..., so that several curves can be
+ *      lined up point by point.  The samples are fed in time order, in
+ *      runs of any length, and each run fills the grid points before its
+ *      samples into the caller's arrays, whose element 0 is grid point
+ *      base.  A grid point takes the value of the latest sample at or
+ *      before it (sample and hold), or the value interpolated between
+ *      that sample and the next one (linear); a grid point after the
+ *      last sample is only filled by StripResample_hold().
+ *
+ *      The grid point flags tell whether there is no sample yet, a
+ *      sample which is not plotable, or a value.
+ */
+typedef enum
+{
+  STRIP_RESAMPLE_OFF = 0,
+  STRIP_RESAMPLE_HOLD,
+  STRIP_RESAMPLE_LINEAR
+}
+StripResampleMethod;
+
+#define STRIP_RESAMPLE_NA       0
+#define STRIP_RESAMPLE_BAD      1
+#define STRIP_RESAMPLE_OK       2
+
+typedef struct _StripResample
+{
+  StripResampleMethod   method;
+  struct timeval        origin;
+  double                step;
+  long                  k;              /* next grid point to fill */
+  int                   have;           /* t, v, ok hold a sample */
+  double                t;              /* seconds after origin */
+  double                v;
+  int                   ok;             /* plotable */
+}
+StripResample;
+
+
+/* StripResample_init
+ */
+void    StripResample_init      (StripResample *,
+                                 StripResampleMethod,
+                                 struct timeval *,      /* origin */
+                                 double);               /* step */
+
+
+/* StripResample_time
+ *
+ *      The time of grid point k.
+ */
+void    StripResample_time      (StripResample *,
+                                 long,                  /* k */
+                                 struct timeval *);
+
+
+/* StripResample_before
+ *
+ *      The number of grid points before t.
+ */
+long    StripResample_before    (StripResample *, struct timeval *);
+
+
+/* StripResample_count
+ *
+ *      The number of grid points on [origin, end].
+ */
+long    StripResample_count     (StripResample *, struct timeval *);
+
+
+/* StripResample_feed
+ *
+ *      Feeds n samples, filling grid points up to (not including) limit,
+ *      and returns the number of samples used: fewer than n if the grid
+ *      points before the next one would go past limit.
+ */
+long    StripResample_feed      (StripResample *,
+                                 struct timeval *,      /* times */
+                                 double *,              /* values */
+                                 short *,               /* status */
+                                 long,                  /* n */
+                                 long,                  /* base */
+                                 long,                  /* limit */
+                                 double *,              /* out values */
+                                 char *);               /* out flags */
+
+
+/* StripResample_hold
+ *
+ *      Fills the grid points up to (not including) limit with the latest
+ *      sample, as if the next one came after them.
+ */
+void    StripResample_hold      (StripResample *,
+                                 long,                  /* base */
+                                 long,                  /* limit */
+                                 double *,              /* out values */
+                                 char *);               /* out flags */
+
+#endif  /* _StripResample */
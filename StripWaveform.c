@@ -0,0 +1,263 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#include "StripWaveform.h"
+#include "StripMisc.h"
+
+#include <X11/Xlib.h>
+#include <X11/Shell.h>
+#include <Xm/DrawingA.h>
+
+#define WAVEFORM_WIDTH  500
+#define WAVEFORM_HEIGHT 300
+
+typedef struct _StripWaveformInfo
+{
+  Display               *display;
+  StripConfig           *config;
+  Widget                shell, canvas;
+  GC                    gc;
+  int                   mapped;
+  XtIntervalId          timer;          /* pending redraw, or 0 */
+
+  /* drawing buffers, sized to the window width */
+  int                   width;
+  XSegment              *segs;
+  XPoint                *points;
+
+  /* the curves of the latest update */
+  StripCurveInfo        *curves;
+  int                   n_curves;
+}
+StripWaveformInfo;
+
+static void     waveform_draw   (StripWaveformInfo *);
+static void     waveform_timeout        (XtPointer, XtIntervalId *);
+static int      waveform_size   (StripWaveformInfo *, int);
+static void     waveform_expose (Widget, XtPointer, XtPointer);
+static void     waveform_map    (Widget, XtPointer, XEvent *, Boolean *);
+
+
+/* StripWaveform_init
+ */
+StripWaveform   StripWaveform_init      (Widget parent, StripConfig *config)
+{
+  StripWaveformInfo     *wf;
+
+  if (!(wf = (StripWaveformInfo *)calloc (1, sizeof (StripWaveformInfo))))
+    return 0;
+
+  wf->display = XtDisplay (parent);
+  wf->config = config;
+
+  wf->shell = XtVaCreatePopupShell
+    ("StripWaveform",
+     topLevelShellWidgetClass,          parent,
+     XmNdeleteResponse,                 XmUNMAP,
+     XmNtitle,                          "Waveforms",
+     XmNvisual,                         config->xvi.visual,
+     XmNcolormap,                       cColorManager_getcmap (config->scm),
+     NULL);
+  XtAddEventHandler
+    (wf->shell, StructureNotifyMask, False, waveform_map, (XtPointer)wf);
+
+  wf->canvas = XtVaCreateManagedWidget
+    ("waveformCanvas",
+     xmDrawingAreaWidgetClass,          wf->shell,
+     XmNwidth,                          WAVEFORM_WIDTH,
+     XmNheight,                         WAVEFORM_HEIGHT,
+     XmNbackground,                     config->Color.background.xcolor.pixel,
+     NULL);
+  XtAddCallback (wf->canvas, XmNexposeCallback, waveform_expose, wf);
+  XtAddCallback (wf->canvas, XmNresizeCallback, waveform_expose, wf);
+
+  return (StripWaveform)wf;
+}
+
+
+/* StripWaveform_delete
+ */
+void            StripWaveform_delete    (StripWaveform the_wf)
+{
+  StripWaveformInfo     *wf = (StripWaveformInfo *)the_wf;
+
+  if (wf->timer) XtRemoveTimeOut (wf->timer);
+  XtDestroyWidget (wf->shell);
+  if (wf->gc) XFreeGC (wf->display, wf->gc);
+  if (wf->segs) free (wf->segs);
+  if (wf->points) free (wf->points);
+  free (wf);
+}
+
+
+/* StripWaveform_popup
+ */
+void            StripWaveform_popup     (StripWaveform the_wf)
+{
+  StripWaveformInfo     *wf = (StripWaveformInfo *)the_wf;
+
+  XtPopup (wf->shell, XtGrabNone);
+  XMapRaised (wf->display, XtWindow (wf->shell));
+}
+
+
+/* StripWaveform_update
+ *
+ *      Updates come with every sample, but the window is redrawn at
+ *      most once per graph refresh interval.
+ */
+void            StripWaveform_update    (StripWaveform          the_wf,
+                                         StripCurveInfo         *curves,
+                                         int                    n)
+{
+  StripWaveformInfo     *wf = (StripWaveformInfo *)the_wf;
+
+  wf->curves = curves;
+  wf->n_curves = n;
+  if (!wf->mapped || wf->timer) return;
+
+  wf->timer = XtAppAddTimeOut
+    (XtWidgetToApplicationContext (wf->shell),
+     (unsigned long)(wf->config->Time.refresh_interval * 1000),
+     waveform_timeout, (XtPointer)wf);
+}
+
+
+static void     waveform_timeout        (XtPointer      data,
+                                         XtIntervalId   *BOGUS(id))
+{
+  StripWaveformInfo     *wf = (StripWaveformInfo *)data;
+
+  wf->timer = 0;
+  if (wf->mapped) waveform_draw (wf);
+}
+
+
+static void     waveform_draw   (StripWaveformInfo *wf)
+{
+  Window                win = XtWindow (wf->canvas);
+  StripCurveInfo        *c;
+  Dimension             width, height;
+  double                *v, lo, hi, a, b;
+  int                   i, k, n, x, i0, i1;
+
+  XtVaGetValues (wf->canvas, XmNwidth, &width, XmNheight, &height, NULL);
+  if ((width < 2) || (height < 2) || !waveform_size (wf, width)) return;
+
+  if (!wf->gc) wf->gc = XCreateGC (wf->display, win, 0, 0);
+  XClearWindow (wf->display, win);
+
+  for (k = 0; k < wf->n_curves; k++)
+  {
+    c = &wf->curves[k];
+    if (!c->details || !c->get_waveform || !c->details->plotstat ||
+        !(c->status & STRIPCURVE_CONNECTED))
+      continue;
+    if ((n = c->get_waveform (c->func_data, &v)) <= 0) continue;
+
+    /* y = a * value + b, with min at the bottom and max at the top;
+     * lo and hi are then reused for each pixel column's range */
+    lo = c->details->min;
+    hi = c->details->max;
+    if (hi <= lo) hi = lo + 1;
+    a = -(height - 1) / (hi - lo);
+    b = (height - 1) - a * lo;
+
+    XSetForeground (wf->display, wf->gc, c->details->color->xcolor.pixel);
+
+    if (n < width)
+    {
+      for (i = 0; i < n; i++)
+      {
+        wf->points[i].x = (short)((n > 1)? i * (width - 1) / (n - 1) : 0);
+        wf->points[i].y = (short)max (-1, min (height, a * v[i] + b));
+      }
+      if (n > 1)
+        XDrawLines
+          (wf->display, win, wf->gc, wf->points, n, CoordModeOrigin);
+      else XDrawPoint
+             (wf->display, win, wf->gc, wf->points[0].x, wf->points[0].y);
+    }
+    else
+    {
+      for (x = 0; x < width; x++)
+      {
+        i0 = (int)((double)x * n / width);
+        i1 = (int)((double)(x + 1) * n / width);
+        for (lo = hi = v[i0], i = i0 + 1; i < i1; i++)
+          if (v[i] < lo) lo = v[i];
+          else if (v[i] > hi) hi = v[i];
+        wf->segs[x].x1 = wf->segs[x].x2 = (short)x;
+        wf->segs[x].y1 = (short)max (-1, min (height, a * lo + b));
+        wf->segs[x].y2 = (short)max (-1, min (height, a * hi + b));
+      }
+      XDrawSegments (wf->display, win, wf->gc, wf->segs, width);
+    }
+  }
+}
+
+
+/* waveform_size
+ *
+ *      Makes the drawing buffers fit the width.
+ */
+static int      waveform_size   (StripWaveformInfo *wf, int width)
+{
+  if (width <= wf->width) return 1;
+
+  if (wf->segs) free (wf->segs);
+  if (wf->points) free (wf->points);
+  wf->segs = (XSegment *)malloc (width * sizeof (XSegment));
+  wf->points = (XPoint *)malloc (width * sizeof (XPoint));
+  if (!wf->segs || !wf->points)
+  {
+    fprintf (stderr, "StripWaveform: can't allocate memory\n");
+    if (wf->segs) free (wf->segs);
+    if (wf->points) free (wf->points);
+    wf->segs = 0;
+    wf->points = 0;
+    wf->width = 0;
+    return 0;
+  }
+  wf->width = width;
+  return 1;
+}
+
+
+static void     waveform_expose (Widget         BOGUS(w),
+                                 XtPointer      data,
+                                 XtPointer      BOGUS(call))
+{
+  StripWaveformInfo     *wf = (StripWaveformInfo *)data;
+
+  if (XtIsRealized (wf->canvas) && wf->mapped) waveform_draw (wf);
+}
+
+
+static void     waveform_map    (Widget         BOGUS(w),
+                                 XtPointer      data,
+                                 XEvent         *event,
+                                 Boolean        *BOGUS(cont))
+{
+  StripWaveformInfo     *wf = (StripWaveformInfo *)data;
+
+  if (event->type == MapNotify) wf->mapped = 1;
+  else if (event->type == UnmapNotify) wf->mapped = 0;
+}
+
+/* **************************** Emacs Editing Sequences ***************** */
+/* Local Variables: */
+/* tab-width: 6 */
+/* c-basic-offset: 2 */
+/* c-comment-only-line-offset: 0 */
+/* c-indent-comments-syntactically-p: t */
+/* c-label-minimum-indentation: 1 */
+/* End: */
@@ -0,0 +1,44 @@
+/*************************************************************************\
+* Copyright (c) 1994-2004 The University of Chicago, as Operator of Argonne
+* National Laboratory.
+* Copyright (c) 1997-2003 Southeastern Universities Research Association,
+* as Operator of Thomas Jefferson National Accelerator Facility.
+* Copyright (c) 1997-2002 Deutches Elektronen-Synchrotron in der Helmholtz-
+* Gemelnschaft (DESY).
+* This file is distributed subject to a Software License Agreement found
+* in the file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#ifndef _StripWaveform
+#define _StripWaveform
+
+#include "StripConfig.h"
+#include "StripCurve.h"
+
+#include <Xm/Xm.h>
+
+/* StripWaveform
+ *
+ *      A window showing the latest waveform of each plotted array curve
+ *      against its element index, scaled by the curve's min and max.
+ *      Waveforms longer than the window is wide are drawn as one
+ *      min-max line per pixel column.
+ */
+typedef void *  StripWaveform;
+
+StripWaveform   StripWaveform_init      (Widget,                /* parent */
+                                         StripConfig *);
+void            StripWaveform_delete    (StripWaveform);
+void            StripWaveform_popup     (StripWaveform);
+
+
+/* StripWaveform_update
+ *
+ *      Has the window redrawn from the given curves, if it is showing,
+ *      once the graph refresh interval is up.
+ */
+void            StripWaveform_update    (StripWaveform,
+                                         StripCurveInfo *,      /* curves */
+                                         int);                  /* count */
+
+#endif  /* _StripWaveform */
@@ -27,14 +27,18 @@
  *     getArchiveData () routine prepares some arrays of value and time
  *      existed in archive record.
  *
+ *      getChannelIds()
+ *          get IDs of 'record_name.NVAL'
+ *                     'record_name.TIM'
+ *                     'record_name.VAL'
+ *          and keep them in a pool; pooled records are monitored, so
+ *          that the latest arrays are at hand without CA round trips.
+ *
  *      getRawDataFromRecord() 
- *          1. get IDs of 'record_name.NVAL'
- *                        'record_name.TIM'
- *                        'record_name.VAL'
- *          2. get arrays of time and data
+ *          get arrays of time and data
  *      
- *      orderArrays()
- *          sort the arrays of time and data according to time
+ *      ringStart()
+ *          find the oldest element of the ring buffer
  */
 
 #include <dirent.h>
@@ -48,6 +52,7 @@
 #include <caerr.h>
 #include <db_access.h>
 #include <tsDefs.h>
+#include <epicsMutex.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdlib.h>
@@ -62,12 +67,26 @@
 #define READ_VALUE_DELAY        2.0 /* 0.7 */
 #define NAME_SIZE               64
 
+/* The current request's deadline, which bounds every ca_pend_io.
+ * (ca_pend_io(0) would wait forever, so never pend on an expired one.)
+ */
+static StripHistoryDeadline *requestDeadline = NULL;
+
+static double pendDelay(void)
+{
+  double left = StripHistoryDeadline_left(requestDeadline);
+  return (left < READ_VALUE_DELAY)? left : READ_VALUE_DELAY;
+}
+
 /*----------------------------------------------------------*/ 
 #define CA_PEND(messg)                                       \
   {                                                          \
-    int my_status = ca_pend_io(READ_VALUE_DELAY);            \
+    int my_status;                                           \
+    if (pendDelay() <= 0) {RETURN_ERROR;}                    \
+    my_status = ca_pend_io(pendDelay());                     \
     if (my_status == ECA_TIMEOUT) {                          \
-       if (ca_pend_io(READ_VALUE_DELAY) != ECA_NORMAL) {     \
+       if ((pendDelay() <= 0) ||                             \
+           (ca_pend_io(pendDelay()) != ECA_NORMAL)) {        \
          SEVCHK (my_status,messg)                            \
          RETURN_ERROR;                                       \
        }                                                     \
@@ -82,7 +101,9 @@
 /*-------------------------------------------------------*/ 
 #define _CA_PEND(messg)                                    \
   {                                                       \
-    int my_status = ca_pend_io(READ_VALUE_DELAY);         \
+    int my_status;                                        \
+    if (pendDelay() <= 0) {RETURN_ERROR;}                 \
+    my_status = ca_pend_io(pendDelay());                  \
     if (my_status != ECA_NORMAL) {                        \
        if(my_status <50) {SEVCHK (my_status,messg)}       \
        else fprintf(stderr,"my_staus =%d\n",my_status); \
@@ -98,16 +119,33 @@
 
 #define PRINTF(messg) fprintf(stderr,"%s:%d\n%s\n",__FILE__, __LINE__, messg)
  
+#define MAX_RECORD_SIZE 10240
+#define POOL_SIZE       127     /* hash buckets */
+
+#define MONITOR_NVAL    1
+#define MONITOR_TIM     2
+#define MONITOR_VAL     4
+#define MONITOR_ALL     (MONITOR_NVAL | MONITOR_TIM | MONITOR_VAL)
+
 typedef struct _channelIds {
-    struct _channelIds *next;
+    struct _channelIds *next;   /* hash chain */
     char               *name;
     chid               nvalId;
     chid               timId;
     chid               valId;   
     chid               flushId; 
+    /* copies of the record's arrays, kept current by monitors; the
+     * three belong to the same update when their time stamps agree */
+    epicsMutexId       lock;
+    unsigned long      size;
+    long               nval;
+    long               *tim;
+    double             *val;
+    epicsTimeStamp     stamp[3];        /* NVAL, TIM, VAL */
+    int                have;    /* MONITOR_ bits received so far */
 }ChannelIds;
 
-static ChannelIds * listChannelIds;
+static ChannelIds * channelPool[POOL_SIZE];
 
 /* forward declaration
  */
@@ -125,13 +163,22 @@ static int getRawDataFromRecord (
       long        **statusData,
       long        *count);    /* how much elements are in array */
 
-static int orderArrays (
+static int ringStart (
       long  *timeData,
       double *valData,
       long  *statusData,
       long  count,
       char *name);   
 
+static void addMonitors (ChannelIds *ids);
+static void arrayMonitor (struct event_handler_args args);
+static int copyMonitored (
+      ChannelIds  *IDs,
+      long        **timeData,
+      double      **valData,
+      long        **statusData,
+      long        *count);
+
 /*
  *********************************************************************
  * let's start hard coding routines in C..
@@ -146,10 +193,32 @@ static void destroyChannelId (ChannelIds  *IDs)
     ca_clear_channel(IDs->timId);
     ca_clear_channel(IDs->valId);
     ca_clear_channel(IDs->flushId); 
+    if (IDs->tim) free((char*)IDs->tim);
+    if (IDs->val) free((char*)IDs->val);
+    if (IDs->lock) epicsMutexDestroy(IDs->lock);
     free((char*)IDs);
   }    
 }
 
+static unsigned hashName (char *name)
+{
+  unsigned h = 0;
+  while (*name) h = h * 31 + (unsigned char)*name++;
+  return h % POOL_SIZE;
+}
+
+/* monitored
+ *
+ *      True if the record's arrays can be taken from the monitor copies.
+ */
+static int monitored (ChannelIds *ids)
+{
+  return (ids->have == MONITOR_ALL) &&
+    (ca_state(ids->nvalId) == cs_conn) &&
+    (ca_state(ids->timId) == cs_conn) &&
+    (ca_state(ids->valId) == cs_conn);
+}
+
 int getArchiveRecord(
       char   *name,
       struct timeval   *from,
@@ -159,7 +228,8 @@ int getArchiveRecord(
       double **returnedData,
       short  **returnedStatus,
       long   *returnedCount,
-      short *needMoreData)
+      short *needMoreData,
+      StripHistoryDeadline *deadline)
 {
 
   long   fromTime =from->tv_sec ;
@@ -170,9 +240,10 @@ int getArchiveRecord(
   double       * valData;
   long         *statusData;
   ChannelIds  * IDs;
-  int           i;
-  char        * archName;
+  int           i, j;
+  char          archName[NAME_SIZE];
   int           len;
+  long          start;
   
   long          tmp_time;
   struct tm *tm;
@@ -182,52 +253,35 @@ int getArchiveRecord(
   u_long  leftFit;
 
   *needMoreData=1;
+  requestDeadline = deadline;
 
   if (name == NULL) {
     PRINTF("invalid parameters");
     return ERROR;
   }
-  archName = name;
 
   /* let's check whether cnannel name has ``.VAL'' like sufix
    */
   for (len = strlen(name); len >=0; len--)
     if (name[len] == '.')
       break;
-  if (len <= 0) {
-    /* if not, than check for ``_h'' sufix 
-     */
-    len = strlen(name);    
-    if (name[len-2] != '_' || name[len-1] != 'h')
-      {
-	archName = (char*) malloc (sizeof(char) *(len + 3));
-	if (archName == NULL) {
-	  PRINTF("cannot allocate memory");
-	  return ERROR;
-	}	
-	strncpy(archName, name,len);
-	archName[len++] = '_';
-	archName[len++] = 'h';
-	archName[len] = '\0';
-      }
-  } 
-  else {
-    /* if ``.VAL'' sufix exists than do not take it in to acount
-     */
-    if (name[len-2] == '_' && name[len-1] == 'h')
-      len -= 2;    
-    archName = (char*) malloc (sizeof(char) * (len + 3));
-    if (archName == NULL) {
-      PRINTF("cannot allocate memory");
-      return ERROR;
-    }
-    strncpy(archName, name,len);
-    archName[len++] = '_';
-    archName[len++] = 'h';
-    archName[len]   = '\0';
+  if (len <= 0)
+    len = strlen(name);
+  /* ``_h'' sufix is added below
+   */
+  if (len >= 2 && name[len-2] == '_' && name[len-1] == 'h')
+    len -= 2;
+  if (len + 3 > NAME_SIZE) {
+    PRINTF("name is very long");
+    *needMoreData=0;
+    return ERROR;
   }
+  strncpy(archName, name,len);
+  archName[len++] = '_';
+  archName[len++] = 'h';
+  archName[len]   = '\0';
+
   if (getChannelIds(archName, requestMode, &IDs)) {
-    if (archName != name) free(archName);
     if(DEBUG1) printf("%s: getChannelIds error\n",name); 
     *needMoreData=0;
     return ERROR;
@@ -241,23 +295,19 @@ int getArchiveRecord(
       if (requestMode == REQUEST_MODE_ONE_SHOT) {
 	destroyChannelId (IDs);
       }
-      if (archName != name) free(archName);
       if(DEBUG1) printf("%s: getRawDataFromRecord error\n",name); 
       return ERROR;
     } 
-  
-  if (orderArrays (timeData, valData,statusData, count,name)== ERROR) {
-    if (requestMode == REQUEST_MODE_ONE_SHOT) {
-      destroyChannelId (IDs);
-    }    
-    if(DEBUG1) printf("%s:  orderArrays  error\n",name); 
-    if (archName != name) free(archName);
-    if (timeData)   free ((char*)timeData);    
-    if (valData)    free ((char*)valData);     
-    if (statusData) free ((char*)statusData); 
-    return ERROR;
+
+  if (requestMode == REQUEST_MODE_ONE_SHOT) {
+    destroyChannelId (IDs);
   }
   
+  /* the arrays are read in ring order, from element start on
+   */
+  start = ringStart (timeData, valData,statusData, count,name);
+#define RING(i) (((i) + start < (long)count)? (i) + start : (i) + start - (long)count)
+  
   for(i=0;i<count;i++)  timeData[i]+=TS_EPOCH_SEC_PAST_1970; 
   
 #ifdef IOC_SUMMER_WINTER_TIME 
@@ -312,7 +362,6 @@ int getArchiveRecord(
    if(DEBUG) printf("tmpCount=%ld\n",tmpCount);
 
     if(tmpCount==0) {
-    if (archName != name) free(archName);
     if (timeData)   free ((char*)timeData);    
     if (valData)    free ((char*)valData);     
     if (statusData) free ((char*)statusData);
@@ -323,8 +372,7 @@ int getArchiveRecord(
     if( (*returnedData=(double *)calloc(tmpCount,sizeof(double)))==NULL) 
       {
       fprintf(stderr,"can't alloc %ld double\n",tmpCount);
-      if (archName != name) free(archName);
-      if (timeData)   free ((char*)timeData);    
+        if (timeData)   free ((char*)timeData);    
       if (valData)    free ((char*)valData);     
       if (statusData) free ((char*)statusData);
       return (ERROR);
@@ -335,8 +383,7 @@ int getArchiveRecord(
       {
       fprintf(stderr,"can't alloc %ld timeval\n",tmpCount);
       if(*returnedData) free((char*) *returnedData);
-      if (archName != name) free(archName);
-      if (timeData)   free ((char*)timeData);    
+        if (timeData)   free ((char*)timeData);    
       if (valData)    free ((char*)valData);     
       if (statusData) free ((char*)statusData);
       return (ERROR);
@@ -347,8 +394,7 @@ int getArchiveRecord(
       fprintf(stderr,"can't alloc %ld long\n",tmpCount);
       if(*returnedData) free((char*) *returnedData);
       if(*returnedTime) free((char*) *returnedTime);
-      if (archName != name) free(archName);
-      if (timeData)   free ((char*)timeData);    
+        if (timeData)   free ((char*)timeData);    
       if (valData)    free ((char*)valData);     
       if (statusData) free ((char*)statusData);
       return (ERROR);
@@ -360,9 +406,10 @@ int getArchiveRecord(
     if(leftFit) {
       for (i=0;i<count;i++)   
 	{ 
-	  if(timeData[i]<fromTime) {
-	    (*returnedData)  [tmpCount]=valData[i];
-	    (*returnedStatus)[tmpCount]=statusData[i];
+	  j=RING(i);
+	  if(timeData[j]<fromTime) {
+	    (*returnedData)  [tmpCount]=valData[j];
+	    (*returnedStatus)[tmpCount]=statusData[j];
 	    ((*returnedTime)  [tmpCount]).tv_sec= from->tv_sec;
 	    ((*returnedTime)  [tmpCount]).tv_usec=from->tv_usec;; 
 	  }
@@ -373,21 +420,22 @@ int getArchiveRecord(
 
     for (i=0;i<count;i++)   
       {
-	if ( (timeData[i]>fromTime) && (timeData[i]<toTime) ) 
+	j=RING(i);
+	if ( (timeData[j]>fromTime) && (timeData[j]<toTime) ) 
 	  {
-	    (*returnedData)  [tmpCount]=valData[i];
-	    (*returnedStatus)[tmpCount]=statusData[i];
-	   ((*returnedTime)  [tmpCount]).tv_sec=timeData[i];
+	    (*returnedData)  [tmpCount]=valData[j];
+	    (*returnedStatus)[tmpCount]=statusData[j];
+	   ((*returnedTime)  [tmpCount]).tv_sec=timeData[j];
 	   ((*returnedTime)  [tmpCount]).tv_usec=0;
 	    tmpCount++;
 	  }
       }
 
-   if (archName != name) free(archName);
    if (timeData)   free ((char*)timeData);    
    if (valData)    free ((char*)valData);     
    if (statusData) free ((char*)statusData);
    return OK;
+#undef RING
 }
 
 
@@ -397,6 +445,8 @@ static int getChannelIds(
       ChannelIds ** IDs)
 {
   register ChannelIds * ids = NULL;
+  ChannelIds         ** p;
+  ChannelIds         ** bucket;
   char                  string[NAME_SIZE];
   int                   status;
 
@@ -405,42 +455,21 @@ static int getChannelIds(
     return ERROR;
   }
 
-  /* check static list of preexeisted ChannelIds for the name
+  /* check the pool for the name.  A one-shot request takes the
+   * node out of the pool; it is destroyed after use.
    */
-  if (requestMode == REQUEST_MODE_ONE_SHOT && listChannelIds) 
-  {
-    /* remove node from static list
-     */
-   if (strcmp(name, listChannelIds->name) == 0) 
-   {
-     *IDs = listChannelIds;
-     listChannelIds = listChannelIds->next;
-     return OK;
-   }
-   else 
-   {
-     register ChannelIds *p, *n;
-     for (p = listChannelIds, n = p->next; n != NULL; p = n, n = n->next) {
-       if (strcmp(name, n->name) == 0) {
-	 p->next = n->next;
-	 *IDs = n;
-	 return OK;
-       }
-     }
-   }
-  }
-  /* if the node is exists in the list, return it.
-   */
-  for (ids = listChannelIds; ids != NULL; ids = ids->next) {
-    if (strcmp(name, ids->name) == 0){
-     *IDs = ids;
+  bucket = &channelPool[hashName(name)];
+  for (p = bucket; *p != NULL; p = &(*p)->next) {
+    if (strcmp(name, (*p)->name) == 0) {
+      *IDs = *p;
+      if (requestMode == REQUEST_MODE_ONE_SHOT) *p = (*p)->next;
       return OK;
     }
   }
 
   /* make a new ChannelIds
    */
-  ids = (ChannelIds *) malloc (sizeof (ChannelIds));
+  ids = (ChannelIds *) calloc (1, sizeof (ChannelIds));
   if (ids == NULL) {
     PRINTF("cannot allocate memory");
     return ERROR;
@@ -567,8 +596,9 @@ static int getChannelIds(
 #undef RETURN_ERROR  
 
   if (requestMode == REQUEST_MODE_CONTINUE) {
-    ids->next = listChannelIds;
-    listChannelIds = ids;
+    ids->next = *bucket;
+    *bucket = ids;
+    addMonitors(ids);
   }
 
   if (IDs) *IDs = ids;
@@ -597,6 +627,20 @@ static int getRawDataFromRecord (
   *timeData = NULL;
   *valData  = NULL;
   *statusData  = NULL;
+
+  if (monitored(IDs)) {
+    /* The monitors hold the arrays already.  Still ask the record to
+     * post what it has buffered, but don't wait for it: it arrives
+     * with the next monitor update.
+     */
+    status = ca_put (DBF_LONG, IDs->flushId, &true);
+    ca_flush_io();
+    ca_poll();
+    if (copyMonitored(IDs, timeData, valData, statusData, count) == OK)
+      goto got_arrays;
+  }
+
+  /* no monitors, or they are in the middle of an update: ask */
   status = ca_put (DBF_LONG, IDs->flushId, &true);
   if (status != ECA_NORMAL) {
     RETURN_ERROR;
@@ -615,12 +659,11 @@ static int getRawDataFromRecord (
 
   if (*count < 1) {
     *count = 0;
-    ca_clear_channel(IDs->nvalId);
     PRINTF("archive record has 0 size arraries");
     return ERROR;
   }
 
-  if (*count > 10240){
+  if (*count > MAX_RECORD_SIZE){
     fprintf(stderr,"size=%ld(dec) %lx (hex) %d\n", *count,*count,*count);
     PRINTF("archive record has so big size arraries");
     *count=0;
@@ -641,8 +684,6 @@ static int getRawDataFromRecord (
    */
   if ( (*valData == NULL) || (*timeData == NULL) ||(*statusData ==NULL)  ) 
     {
-      ca_clear_channel(IDs->nvalId);
- 
       if (*valData)    free ((char*)valData);
       if (*timeData)   free ((char*)timeData);
       if (*statusData) free ((char*)statusData);
@@ -660,7 +701,8 @@ static int getRawDataFromRecord (
   CA_PEND("ca_pend_io failure");
   ca_array_get(DBF_DOUBLE,(unsigned long)*count, IDs->valId, *valData);
   CA_PEND("ca_pend_io failure");
-  
+
+ got_arrays:
   for(i=0;i < *count; i++) {
     (*statusData)[i]=0L;  /* Now we don't handle status. Albert. */
   }
@@ -686,7 +728,13 @@ static int getRawDataFromRecord (
 }
 
 
-static int orderArrays (
+/* ringStart
+ *
+ *      The record's arrays are a ring buffer: returns the index of the
+ *      oldest element, from which on the arrays are in time order
+ *      (wrapping around at count).
+ */
+static int ringStart (
       long   *timeData,
       double  *valData,
       long    *statusData,
@@ -749,54 +797,126 @@ static int orderArrays (
   if(start != 0) fprintf(stderr,
 		 "Waring:%s-history buffer is really ring buffer\n",name); 
 
-  /* if start element is not the first in array, reordering arrays
-   */
-  if (start) 
-    {
-      /* allocate tmp arrays 
-       */
-      long  * tmpTime = (long*) calloc (count, sizeof(long));
-      double * tmpVal = (double*) calloc (count, sizeof(double));
-      long  * tmpStatus = (long*) calloc (count, sizeof(long));
-      if((tmpTime == NULL)||(tmpVal == NULL)|| (tmpStatus == NULL)) 
-	{
-	  if (tmpTime) free ((char*)tmpTime);
-	  if (tmpVal)  free ((char*)tmpVal);
-	  if (tmpStatus)  free ((char*)tmpStatus);
-	  PRINTF("cannot allocate memory");
-	  return ERROR;
-	}
-      
-      /* copy parts from original to tmp
-       */
-      memcpy ((char*)tmpTime, (char*)&timeData[start], 
-	      (count - start) * sizeof (long));
-      memcpy ((char*)tmpVal,  (char*)&valData[start], 
-	      (count - start) * sizeof (double));
-      memcpy ((char*)tmpStatus, (char*)&statusData[start], 
-	      (count - start) * sizeof (long));
-      
-      memcpy ((char*)&(tmpTime[count - start]), (char*)timeData, 
-	      start * sizeof (long)); 
-      memcpy ((char*)&(tmpVal[count - start]),  (char*)valData, 
-	      start * sizeof (double)); 
-      memcpy ((char*)&(tmpStatus[count - start]), (char*)statusData, 
-	      start * sizeof (long)); 
-      
-      /* copy back
-       */
-      memcpy((char*)timeData, (char*)tmpTime, count * sizeof (long));
-      memcpy((char*)valData, (char*)tmpVal, count * sizeof (double));
-      memcpy((char*)statusData, (char*)tmpStatus, count * sizeof (long));
-      
-      /* free and bye
-       */
-      free ((char*) tmpVal);
-      free ((char*) tmpTime);
-      free ((char*) tmpStatus);
+  return start;
+}
+
+
+/* addMonitors
+ *
+ *      Subscribes to the arrays of a pooled record.  If anything fails
+ *      the record is just read with ca_array_get, as before.
+ */
+static void addMonitors (ChannelIds *ids)
+{
+  unsigned long size = ca_element_count(ids->timId);
+
+  if (size < 1 || size > MAX_RECORD_SIZE ||
+      ca_element_count(ids->valId) < size)
+    return;
+
+  ids->tim = (long*) calloc (size, sizeof (long));
+  ids->val = (double*) calloc (size, sizeof (double));
+  if (ids->tim == NULL || ids->val == NULL) {
+    if (ids->tim) free((char*)ids->tim);
+    if (ids->val) free((char*)ids->val);
+    ids->tim = NULL;
+    ids->val = NULL;
+    return;
+  }
+  if (!(ids->lock = epicsMutexCreate())) {
+    free((char*)ids->tim);
+    free((char*)ids->val);
+    ids->tim = NULL;
+    ids->val = NULL;
+    return;
+  }
+  ids->size = size;
+
+  if (ca_add_event(DBR_TIME_LONG, ids->nvalId, arrayMonitor, ids, NULL)
+      != ECA_NORMAL ||
+      ca_add_array_event(DBR_TIME_LONG, size, ids->timId, arrayMonitor, ids,
+			 0.0, 0.0, 0.0, NULL) != ECA_NORMAL ||
+      ca_add_array_event(DBR_TIME_DOUBLE, size, ids->valId, arrayMonitor,
+			 ids, 0.0, 0.0, 0.0, NULL) != ECA_NORMAL)
+    fprintf(stderr,"%s: can't monitor archive record\n",ids->name);
+  ca_flush_io();
+}
+
+
+static void arrayMonitor (struct event_handler_args args)
+{
+  ChannelIds *ids = (ChannelIds *)args.usr;
+  struct dbr_time_long *tl = (struct dbr_time_long *)args.dbr;
+  struct dbr_time_double *td = (struct dbr_time_double *)args.dbr;
+  long i, n;
+
+  if (args.status != ECA_NORMAL || args.dbr == NULL) return;
+  n = (args.count < (long)ids->size)? args.count : (long)ids->size;
+
+  epicsMutexLock(ids->lock);
+  if (args.chid == ids->nvalId) {
+    ids->nval = tl->value;
+    ids->stamp[0] = tl->stamp;
+    ids->have |= MONITOR_NVAL;
+  }
+  else if (args.chid == ids->timId) {
+    for (i = 0; i < n; i++) ids->tim[i] = (&tl->value)[i];
+    ids->stamp[1] = tl->stamp;
+    ids->have |= MONITOR_TIM;
+  }
+  else if (args.chid == ids->valId) {
+    memcpy((char*)ids->val, (char*)&td->value, n * sizeof (double));
+    ids->stamp[2] = td->stamp;
+    ids->have |= MONITOR_VAL;
+  }
+  epicsMutexUnlock(ids->lock);
+}
+
+
+/* copyMonitored
+ *
+ *      Copies the monitored arrays, if they all come from the same
+ *      update of the record.  Otherwise (some of the three monitors
+ *      are still on their way) returns ERROR, and the record is read
+ *      with ca_array_get instead.
+ */
+static int copyMonitored (
+      ChannelIds  *IDs,
+      long        **timeData,
+      double      **valData,
+      long        **statusData,
+      long        *count)
+{
+  long n;
+  int ok = ERROR;
+
+  epicsMutexLock(IDs->lock);
+  n = (IDs->nval < (long)IDs->size)? IDs->nval : (long)IDs->size;
+  if ((n > 0) &&
+      (IDs->stamp[0].secPastEpoch == IDs->stamp[1].secPastEpoch) &&
+      (IDs->stamp[0].nsec == IDs->stamp[1].nsec) &&
+      (IDs->stamp[0].secPastEpoch == IDs->stamp[2].secPastEpoch) &&
+      (IDs->stamp[0].nsec == IDs->stamp[2].nsec)) {
+    *timeData =   (long*)    calloc (n, sizeof (long));
+    *valData =    (double*)  calloc (n, sizeof (double));
+    *statusData = (long*)    calloc (n, sizeof (long));
+    if (*timeData && *valData && *statusData) {
+      memcpy((char*)*timeData, (char*)IDs->tim, n * sizeof (long));
+      memcpy((char*)*valData, (char*)IDs->val, n * sizeof (double));
+      *count = n;
+      ok = OK;
     }
-  
-  return OK;
+    else {
+      if (*timeData) free((char*)*timeData);
+      if (*valData) free((char*)*valData);
+      if (*statusData) free((char*)*statusData);
+      *timeData = NULL;
+      *valData = NULL;
+      *statusData = NULL;
+    }
+  }
+  epicsMutexUnlock(IDs->lock);
+  return ok;
 }
 
 
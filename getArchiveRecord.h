@@ -17,6 +17,7 @@
 #define ERROR 1
 #define OK 0
 #include <tsDefs.h>
+#include "StripHistory.h"
 
 int getArchiveRecord(
       char            *name,            /* channal name */
@@ -27,5 +28,6 @@ int getArchiveRecord(
       double         **returnedData,    /* data */
       short          **returnedStatus,  /* status */  
       long            *returnedCount,   /* real count of data */
-      short *needMoreData);
+      short *needMoreData,
+      StripHistoryDeadline *deadline);  /* give up at */
 #endif  /* _getArchiveRecord_h */
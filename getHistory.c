@@ -23,30 +23,180 @@
 #define DEBUG1 0
 #define DEBUG2 0
 
+/* The archiver is asked in a thread of its own while the archive record
+ * is read, so a fetch costs the slower of the two rather than the sum. */
+#if defined(USE_ARCHIVE_RECORD) && (defined(USE_AAPI) || defined(USE_CAR))
+#ifndef WIN32
+#define PARALLEL_FETCH
+#include <pthread.h>
+#endif
+#endif
+
+#if defined(USE_AAPI) || defined(USE_CAR)
+/* ArchiverRequest
+ *
+ *      An archiver fetch and its result.  It has its own copy of the
+ *      deadline, so that it can be called off once the IOC data is
+ *      known to cover the range.  A fetch which fails, or runs into the
+ *      deadline, is marked failed: its data may not cover the range.
+ */
+typedef struct _ArchiverRequest
+{
+  StripHistory          shi;
+  char                  *name;
+  struct timeval        begin;
+  struct timeval        end;
+  StripHistoryDeadline  deadline;
+  struct timeval        *times;
+  double                *data;
+  short                 *status;
+  long                  count;
+  int                   failed;
+}
+ArchiverRequest;
+
+static void archiver_fetch (ArchiverRequest *req)
+{
+  if (compare_times(&req->begin, &req->end) >= 0)
+    {
+      if(DEBUG1) printf("don't need history req\n");
+      return;
+    }
+  if (StripHistoryDeadline_left(&req->deadline) <= 0)
+    {
+      req->failed = 1;
+      return;
+    }
+
+  if(DEBUG1) printf("history req is here\n");
+#ifdef USE_AAPI
+  if(get_AAPI_data(req->name,&req->begin,&req->end,
+		   &req->times, 
+		   &req->status, &req->data,
+		   &req->count) != 0)
+#endif
+#ifdef USE_CAR
+  if(get_CAR_data(req->shi,req->name,&req->begin,&req->end,
+		  &req->times, 
+		  &req->status, &req->data,
+		  &req->count,&req->deadline) != 0)
+#endif
+    { 
+      if(DEBUG) fprintf(stderr,"%s:getArchiveAPI Error\n",req->name);
+      req->count=0; /* ???? return (-1); */
+      req->failed=1;
+    }
+  else if (StripHistoryDeadline_left(&req->deadline) <= 0)
+    req->failed=1;
+}
+
+#ifdef PARALLEL_FETCH
+static void *archiver_thread (void *arg)
+{
+  archiver_fetch ((ArchiverRequest *)arg);
+  return NULL;
+}
+#endif
+
+/* samples_before
+ *
+ *      Number of leading samples earlier than t.
+ */
+static long samples_before (struct timeval *times, long count,
+			    struct timeval *t)
+{
+  long lo = 0, hi = count, mid;
+
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (compare_times(&times[mid], t) < 0) lo = mid + 1;
+      else hi = mid;
+    }
+  return lo;
+}
+#endif  /* USE_AAPI || USE_CAR */
+
+/* plotable
+ *
+ *      Strip status is no CA status: mark the samples of a freshly
+ *      received chunk as plotable, in place.
+ */
+static void plotable (short *status, long count)
+{
+  long i;
+  for (i = 0; i < count; i++) status[i] |= DATASTAT_PLOTABLE;
+}
+
+/* append_chunk
+ *
+ *      Hands the arrays over to the result, or frees them if no chunk
+ *      can be made of them.
+ */
+static void append_chunk (StripHistoryResult *result, struct timeval *times,
+			  double *data, short *status, long count)
+{
+  StripHistoryChunk *c;
+
+  if (count > 0) plotable(status,count);
+  c = StripHistoryChunk_new
+    (times, data, status, (int)count, StripHistoryChunk_free);
+  if (!c)
+    {
+      free(times);
+      if (data) free(data);
+      if (status) free(status);
+      return;
+    }
+  StripHistoryResult_append(result, c);
+}
+
 unsigned long getHistory(StripHistory     the_shi,
 		  char*            name,
 		  struct timeval*  begin,
 		  struct timeval*  end,
-		  struct timeval** times,
-		  short**          status,
-		  double**         data,
-		  unsigned long *  count)
+		  StripHistoryResult *result,
+		  StripHistoryDeadline *deadline)
 {
-  struct timeval right_endpoint;   /* right end for AAPI request */
-  unsigned long commonCount=0;
+  struct timeval right_endpoint;   /* IOC data starts here */
+#if defined(USE_ARCHIVE_RECORD) || defined(USE_AAPI) || defined(USE_CAR)
+  short needMoreData = 1;
   int i;
+#endif
 
   double *returnedDataIOC =NULL;
   struct timeval *returnedTimeIOC=NULL;
   short *returnedStatusIOC=NULL;
   long returnedCountIOC=0;
+  unsigned long ret = 0;
+
+#if defined(USE_AAPI) || defined(USE_CAR)
+  ArchiverRequest arch;
+  int threaded = 0;
+#ifdef PARALLEL_FETCH
+  pthread_t thread;
+#endif
+
+  arch.shi = the_shi;
+  arch.name = name;
+  arch.begin = *begin;
+  arch.end = *end;
+  if (deadline) arch.deadline = *deadline;
+  else StripHistoryDeadline_init(&arch.deadline, 0);
+  arch.times = NULL;
+  arch.data = NULL;
+  arch.status = NULL;
+  arch.count = 0;
+  arch.failed = 0;
 
-  double *returnedDataAAPI=NULL;
-  struct timeval *returnedTimeAAPI=NULL;
-  short *returnedStatusAAPI=NULL;
-  long returnedCountAAPI=0;
+#ifdef PARALLEL_FETCH
+  /* speculatively ask for the whole range; trimmed below */
+  History_MessageBox_defer(1);
+  threaded = (pthread_create(&thread, NULL, archiver_thread, &arch) == 0);
+  if (!threaded) History_MessageBox_defer(0);
+#endif
+#endif  /* USE_AAPI || USE_CAR */
 
-  *count=0;
   right_endpoint.tv_sec = end->tv_sec;
   right_endpoint.tv_usec = end->tv_usec;
 
@@ -54,10 +204,11 @@ unsigned long getHistory(StripHistory     the_shi,
   if(getArchiveRecord(name,begin,end,
 		     REQUEST_MODE_CONTINUE ,&returnedTimeIOC, 
 		     &returnedDataIOC, &returnedStatusIOC,
-		     &returnedCountIOC,&needMoreData) != 0)
+		     &returnedCountIOC,&needMoreData,deadline) != 0)
     { 
       if(DEBUG1) fprintf(stderr,"%s:getArchiveRecord Error\n",name);
       returnedCountIOC=0;/*????      return (-1);  */
+      ret = 1;
     }
 
   if(returnedCountIOC>0) 
@@ -66,7 +217,6 @@ unsigned long getHistory(StripHistory     the_shi,
 	{
 	  right_endpoint.tv_sec = returnedTimeIOC[0].tv_sec;
 	  right_endpoint.tv_usec= returnedTimeIOC[0].tv_usec;
-	  commonCount=returnedCountIOC;
 	}
     }
 
@@ -79,98 +229,59 @@ unsigned long getHistory(StripHistory     the_shi,
   }
 #endif
 #if defined(USE_AAPI) || defined(USE_CAR)
-  if((needMoreData)&&(begin->tv_sec < right_endpoint.tv_sec)) 
-    { 
-if(DEBUG1) printf("history req is here\n");
-#ifdef USE_AAPI
-      if(get_AAPI_data(name,begin ,&right_endpoint,
-		       &returnedTimeAAPI, 
-		       &returnedStatusAAPI, &returnedDataAAPI,
-		       &returnedCountAAPI) != 0)
-#endif
-#ifdef USE_CAR
-      if(get_CAR_data(the_shi,name,begin ,&right_endpoint,
-		       &returnedTimeAAPI, 
-		       &returnedStatusAAPI, &returnedDataAAPI,
-		       &returnedCountAAPI) != 0)
+  if (threaded)
+    {
+#ifdef PARALLEL_FETCH
+      /* the IOC has it all: no point in waiting for the rest */
+      if (!needMoreData || (compare_times(&right_endpoint, begin) <= 0))
+	arch.deadline.cancelled = 1;
+      pthread_join(thread, NULL);
+      History_MessageBox_defer(0);
 #endif
-	{ 
-	  if(DEBUG) fprintf(stderr,"%s:getArchiveAPI Error\n",name);
-	  returnedCountAAPI=0; /* ???? return (-1); */
-	}
-      
-      if(DEBUG1) {
-	printf("returnedCountAAPI=%ld\n",returnedCountAAPI);
-	printf("AAPI FROM=%s",ctime(&(begin->tv_sec)));
-	printf("AAPI TO  =%s",ctime(&(right_endpoint.tv_sec)));    
-	if(DEBUG2) for(i=0;i<returnedCountAAPI;i++)  
-	  printf("AAPI=%s",ctime(&((returnedTimeAAPI)[i].tv_sec)));
-      }
-      
-      commonCount += returnedCountAAPI;
     }
-  else { if(DEBUG1) printf("don't need history req\n");}
-#endif  /* USE_AAPI || USE_CAR */
-
-  if(commonCount>0) 
+  else if (needMoreData)
     {
-      *data  =(double *)calloc(commonCount,sizeof(double));
-      *status=(short *)  calloc(commonCount,sizeof(short));
-      *times =(struct timeval *)calloc(commonCount,sizeof(struct timeval));
-      if((*data == NULL) ||(*times == NULL) ||  (*status == NULL))
-      {
-	fprintf(stderr,"can't alloc %ld answers\n",commonCount);
-	if(*data)   free (*data);
-	if(*times)   free (*times);
-	if(*status) free (*status);
-	if (returnedDataAAPI)   free (returnedDataAAPI);
-	if (returnedStatusAAPI) free (returnedStatusAAPI);
-	if (returnedTimeAAPI)   free (returnedTimeAAPI);
-	if (returnedDataIOC)    free (returnedDataIOC);
-	if (returnedStatusIOC)  free (returnedStatusIOC);
-	if (returnedTimeIOC)    free (returnedTimeIOC);
-	return (-1);
-      }
-
-      if(returnedCountAAPI>0) 
-	{
-	  memcpy(*data,  returnedDataAAPI,  returnedCountAAPI*(sizeof(double)));
-	  memcpy(*status,returnedStatusAAPI,returnedCountAAPI*(sizeof(short)));
-	  memcpy(*times,  returnedTimeAAPI,  returnedCountAAPI*(sizeof(struct timeval)));
-	}
+      arch.end = right_endpoint;
+      archiver_fetch(&arch);
+    }
+
+  /* the IOC data is preferred where both sources have samples */
+  if ((arch.count > 0) && (returnedCountIOC > 0))
+    arch.count = samples_before(arch.times, arch.count, &right_endpoint);
+      
+  if(DEBUG1) {
+    printf("returnedCountAAPI=%ld\n",arch.count);
+    printf("AAPI FROM=%s",ctime(&(begin->tv_sec)));
+    printf("AAPI TO  =%s",ctime(&(right_endpoint.tv_sec)));    
+    if(DEBUG2) for(i=0;i<arch.count;i++)  
+      printf("AAPI=%s",ctime(&((arch.times)[i].tv_sec)));
+  }
 
-      if(returnedCountIOC>0) {
-	memcpy(&((*data)  [returnedCountAAPI]),  returnedDataIOC,
-	       returnedCountIOC*(sizeof(double)));
-	memcpy(&((*status)[returnedCountAAPI]),returnedStatusIOC,
-	       returnedCountIOC*(sizeof(short)));
-	memcpy(&((*times)  [returnedCountAAPI]),  returnedTimeIOC,
-	       returnedCountIOC*(sizeof(struct timeval)));
+  /* The archiver data ends where the IOC data begins, so both arrays
+   * are handed over as they are: one chunk each, in time order.  Empty
+   * chunks are released by StripHistoryResult_append(). */
+  if(arch.times) 
+    append_chunk(result, arch.times, arch.data, arch.status, arch.count);
+#endif  /* USE_AAPI || USE_CAR */
 
-      }
-      /* ATTENTION: Strip status is no CA status! */
-      for(i=0;i<(int)commonCount;i++) (*status)[i] |= DATASTAT_PLOTABLE;
+  if(returnedTimeIOC) 
+    append_chunk(result, returnedTimeIOC, returnedDataIOC,
+		 returnedStatusIOC, returnedCountIOC);
 
-    }
+#if defined(USE_AAPI) || defined(USE_CAR)
+  /* the archiver was needed for what the IOC data doesn't cover */
+  if (arch.failed && needMoreData &&
+      (compare_times(&right_endpoint, begin) > 0))
+    ret = 1;
+#endif
+  /* then only the IOC data, if any, is known to be complete */
+  if (ret) result->t0 = (returnedCountIOC > 0)? right_endpoint : *end;
 
   if(DEBUG1) {
-    printf("commonCount=%ld\n",commonCount);
+    printf("commonCount=%d\n",result->n_points);
     printf("COM FROM=%s",ctime((const time_t *)&(begin->tv_sec)));
     printf("COM TO  =%s",ctime((const time_t *)&(end->tv_sec)));    
-    if(DEBUG2) for(i=0;i<(int)commonCount;i++)  
-      printf("TIME=%s",ctime((const time_t *)&((*times)[i].tv_sec)));
   }
   
-  if (returnedDataAAPI)   free (returnedDataAAPI);
-  if (returnedStatusAAPI) free (returnedStatusAAPI);
-  if (returnedTimeAAPI)   free (returnedTimeAAPI);
-  if (returnedDataIOC)    free (returnedDataIOC);
-  if (returnedStatusIOC)  free (returnedStatusIOC);
-  if (returnedTimeIOC)    free (returnedTimeIOC);
-  *count=commonCount;
-  
-  return (0);
+  return (ret);
 }
-
-
-
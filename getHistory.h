@@ -12,6 +12,8 @@
 #ifndef _getHistory_h
 #define _getHistory_h
 
+#include "StripHistoryCache.h"
+
 /* StripHistoryInfo
  *
  *      Contains instance data for the archive service.
@@ -20,16 +22,25 @@ typedef struct _StripHistoryInfo
 {
   Strip         strip;
   char          *archiverInfo;
+  StripHistoryCache     cache;
 }
 StripHistoryInfo;
 
 
+/* getHistory
+ *
+ *      Fetches the history of the named channel on [begin, end] and
+ *      appends it to the result: archiver data first, then the newer
+ *      data from the IOC archive record.  Sources not queried before the
+ *      deadline are left out.  Returns 0 on success.  Otherwise a source
+ *      which was needed failed or ran into the deadline, and result->t0
+ *      is moved up to where the IOC data begins, or to end if there is
+ *      none, as only that part of the range is known to be complete.
+ */
 unsigned long getHistory(StripHistory     the_shi,
                   char                   *name,
 		  struct timeval         *begin,  
 		  struct timeval         *end,
-		  struct timeval        **times,
-		  short                 **status,
-		  double                **data,
-		  unsigned long          *count);
+		  StripHistoryResult     *result,
+		  StripHistoryDeadline   *deadline);
 #endif  /* _getHistory_h */
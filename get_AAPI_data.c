@@ -168,14 +168,6 @@ static void tryFreeData(answerData *ans_data,char *serverErrorString)
   if(serverErrorString) free (serverErrorString);
 }
 
-void  AAPI_Result_release (StripHistoryResult     *result)
-{
-
- if(result->data)    free (result->data);
- if(result->times)   free (result->times);
- if(result->status)  free (result->status);
-}
-
 #define MAX_FILTER_LIST 100
 
 int extractAAPIfilterList(char ***list, int *len)